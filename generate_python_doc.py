@@ -47,7 +47,7 @@ def substitute(istr, ostr, docstrings):
         print(line, file=ostr)
 
 if __name__ == '__main__':
-    cpp_files = ['Witness.h', 'Client.h', 'Transaction.h', 'Collection.h', 'IsolationLevel.h']
+    cpp_files = ['Witness.h', 'Client.h', 'Transaction.h', 'Collection.h', 'Cursor.h', 'IsolationLevel.h']
     sourcefile = "src/client/python_api.cpp.in"
 
     path = sys.argv[1]
@@ -6,6 +6,7 @@
 #include <json/Document.h>
 #include <vector>
 
+#include "Cursor.h"
 #include "Witness.h"
 #include "event_id.h"
 
@@ -35,12 +36,32 @@ public:
      * Create a secondary index for this collection
      * This index will cover all objects containing the paths specified.
      *
+     * The index is populated in the background, so this call returns before the collection has been fully indexed.
+     * Queries will start using the index once it is complete. Progress is reported by Client::get_statistics().
+     *
      * @param name
      *      The identifier of the index. Must be unique for this collection
      * @param paths
      *      The paths the index will cover
+     * @param include
+     *      Additional paths whose values will be stored in the index.
+     *      If set, queries with a projection that only needs the indexed and included paths are answered directly from the index.
+     */
+    virtual bool create_index(const std::string &name,
+                              const std::vector<std::string> &paths,
+                              const std::vector<std::string> &include = {}) = 0;
+
+    /**
+     * @label{Collection_create_ordered_index}
+     *
+     * Keep the keys of this collection in lexicographic order, so that scan() and scan_prefix() don't need to look at every key
+     *
+     * Existing keys are added in the background. The index only supports collections with up to 100,000 objects
+     * and is disabled if the collection grows beyond that.
+     *
+     * @return false if the collection already has an ordered index or is too large
      */
-    virtual bool create_index(const std::string &name, const std::vector<std::string> &paths) = 0;
+    virtual bool create_ordered_index() = 0;
 
     /**
      * @label{Collection_call}
@@ -128,6 +149,31 @@ public:
      */
     virtual event_id_t put(const std::string &key, const json::Document &doc) = 0;
 
+    /**
+     * @label{Collection_put_many}
+     * @brief Insert or update several objects with a single request
+     *
+     * @param objects
+     *      Pairs of key and value. If a key appears more than once, the later value becomes the latest version.
+     * @return the event id of every write, in the same order as objects. Rejected writes have an invalid event id.
+     */
+    virtual std::vector<event_id_t> put_many(const std::vector<std::pair<std::string, json::Document>> &objects) = 0;
+
+    /**
+     * @label{Collection_bulk_load}
+     * @brief Insert a large number of new objects into a collection
+     *
+     * Meant for importing data. Some other writes have to wait until the load is done.
+     * Large imports can be split into several calls.
+     * If the collection was empty, secondary indexes are built in the background afterwards.
+     *
+     * @param objects
+     *      Pairs of key and value. The keys must not exist in the collection yet. Must not contain the collection policy.
+     * @return the event id of every object, in the same order as objects
+     * @throw std::runtime_error if the collection has a policy, a key already exists or any of the objects is invalid (nothing is written then)
+     */
+    virtual std::vector<event_id_t> bulk_load(const std::vector<std::pair<std::string, json::Document>> &objects) = 0;
+
     /**
      * @label{Collection_put_code}
      * @brief Create a new object holding executable code
@@ -184,6 +230,17 @@ public:
      */
     virtual std::pair<json::Document, event_id_t> get_with_eid(const std::string &key) = 0;
 
+    /**
+     * @label{Collection_get_many}
+     * @brief Get the values of several objects with a single request
+     *
+     * @param keys
+     *      The primary keys of the objects
+     * @return the value and event id of every object, in the same order as keys.
+     *      Objects that don't exist (or can't be accessed) have an empty value and an invalid event id.
+     */
+    virtual std::vector<std::pair<json::Document, event_id_t>> get_many(const std::vector<std::string> &keys) = 0;
+
     /**
      * @brief Check whether an object exists
      * @param key
@@ -234,16 +291,148 @@ public:
      *
      * @param predicates [optional]
      *     the object has to match all specified predicates. if no predicate is specified all objects in the collection are returned.
+     *     {"path": {"$contains": value}} matches objects where path is an array containing value. Indexes on path are used for such predicates.
      * @param projection [optional]
      *     only return the fields specified
      * @param limit [optional]
      *     only return up to a certain number of objects
+     * @param sort [optional]
+     *     return the objects ordered by the value at this path. Prefix the path with '-' for descending order or use "$key" to order by key.
+     *     Objects that lack the path come first. Together with a limit, only the first objects in that order are returned.
      */
     virtual std::vector<std::tuple<std::string, json::Document>>
     find(const json::Document &predicates = json::Document(""),
+         const std::vector<std::string> &projection = {},
+         int32_t limit = -1,
+         const std::string &sort = "") = 0;
+
+    /**
+     * @label{Collection_aggregate}
+     * @brief Compute aggregates over all objects that fit a predicate, without transferring the objects
+     *
+     * @param aggregates
+     *     maps the name of each result to an aggregate function and a path, e.g.
+     *     {"total": {"$sum": "price"}, "num": {"$count": ""}}. Supported functions are $count, $sum, $min, $max and $avg.
+     *     $count with an empty path counts all objects; otherwise it counts the objects that contain the path.
+     * @param predicates [optional]
+     *     only objects that match all predicates are considered
+     * @param group_by [optional]
+     *     if set, the result is a list with one entry per distinct value of this path.
+     *     The value itself is stored in the field "group" of each entry.
+     * @return a map from result names to values or, if group_by is set, a list of such maps
+     */
+    virtual json::Document aggregate(const json::Document &aggregates,
+                                     const json::Document &predicates = json::Document(""),
+                                     const std::string &group_by = "") = 0;
+
+    /**
+     * @label{Collection_lookup}
+     * @brief Find objects and attach the objects of another collection that they reference (a lookup join)
+     *
+     * This needs only one round trip, instead of a find followed by a get for every result.
+     *
+     * @param local_path
+     *     the path of each result that holds the reference
+     * @param foreign_collection
+     *     the collection that holds the referenced objects
+     * @param foreign_path [optional]
+     *     attach all objects of foreign_collection whose value at this path equals the reference.
+     *     If empty, the reference is the key of the object to attach.
+     * @param into [optional]
+     *     the field of each result that will hold the list of attached objects. Defaults to the name of the foreign collection.
+     * @param predicates [optional]
+     *     the object has to match all specified predicates
+     * @param projection [optional]
+     *     only return the fields specified (the references are read before the projection is applied)
+     * @param limit [optional]
+     *     only return up to a certain number of objects
+     */
+    virtual std::vector<std::tuple<std::string, json::Document>>
+    lookup(const std::string &local_path,
+           const std::string &foreign_collection,
+           const std::string &foreign_path = "",
+           const std::string &into = "",
+           const json::Document &predicates = json::Document(""),
+           const std::vector<std::string> &projection = {},
+           int32_t limit = -1) = 0;
+
+    /**
+     * @label{Collection_find_cursor}
+     * @brief Like find, but returns the objects in batches instead of all at once
+     *
+     * Use this for queries with large results.
+     *
+     * @param predicates [optional]
+     *     the object has to match all specified predicates
+     * @param projection [optional]
+     *     only return the fields specified
+     * @param limit [optional]
+     *     only return up to a certain number of objects
+     * @param batch_size [optional]
+     *     the number of objects fetched from the server at a time
+     */
+    virtual CursorPtr find_cursor(const json::Document &predicates = json::Document(""),
+                                  const std::vector<std::string> &projection = {},
+                                  int32_t limit = -1,
+                                  uint32_t batch_size = DEFAULT_CURSOR_BATCH_SIZE) = 0;
+
+    /**
+     * @label{Collection_scan}
+     * @brief Get all objects with start_key <= key < end_key, ordered by key
+     *
+     * Keys are compared lexicographically, so hierarchical keys like tenant/user/item are grouped together.
+     * This is fast if the collection has an ordered index (see create_ordered_index) and needs to look at all keys otherwise.
+     *
+     * @param start_key
+     *     the smallest key to return
+     * @param end_key [optional]
+     *     the first key that is not returned. if empty there is no upper bound.
+     * @param projection [optional]
+     *     only return the fields specified
+     * @param limit [optional]
+     *     only return up to a certain number of objects
+     */
+    virtual std::vector<std::tuple<std::string, json::Document>>
+    scan(const std::string &start_key,
+         const std::string &end_key = "",
          const std::vector<std::string> &projection = {},
          int32_t limit = -1) = 0;
 
+    /**
+     * @label{Collection_scan_prefix}
+     * @brief Get all objects whose key starts with prefix, ordered by key
+     *
+     * @param prefix
+     *     e.g. "tenant/" to list all objects of a tenant
+     * @param projection [optional]
+     *     only return the fields specified
+     * @param limit [optional]
+     *     only return up to a certain number of objects
+     */
+    virtual std::vector<std::tuple<std::string, json::Document>>
+    scan_prefix(const std::string &prefix,
+                const std::vector<std::string> &projection = {},
+                int32_t limit = -1) = 0;
+
+    /**
+     * @label{Collection_explain}
+     * @brief Describe how the server would answer a query, without running it
+     *
+     * The result contains the chosen strategy (index lookup, index intersection or linear scan),
+     * the indexes and their statistics, the predicates that are not covered by any index,
+     * and the estimated number of results and cost.
+     *
+     * @param predicates [optional]
+     *     the predicates of the query
+     * @param projection [optional]
+     *     the fields the query would return
+     * @param limit [optional]
+     *     the maximum number of objects the query would return
+     */
+    virtual json::Document explain(const json::Document &predicates = json::Document(""),
+                                   const std::vector<std::string> &projection = {},
+                                   int32_t limit = -1) = 0;
+
     /**
      * @label{Collection_get}
      * @brief Get a value of an object
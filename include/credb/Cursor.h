@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <json/Document.h>
+
+namespace credb
+{
+
+/// Number of objects a cursor fetches from the server at a time (unless specified otherwise)
+constexpr uint32_t DEFAULT_CURSOR_BATCH_SIZE = 100;
+
+/**
+ * @label{Cursor}
+ * @brief Iterates over the result of a query
+ *
+ * Objects are fetched from the server in batches, so only one batch has to be kept in memory at a time.
+ * The server closes cursors that have not been used for a while.
+ */
+class Cursor
+{
+public:
+    virtual ~Cursor() = default;
+
+    /**
+     * @label{Cursor_has_next}
+     * @brief Are there any objects left? This might fetch the next batch from the server
+     */
+    virtual bool has_next() = 0;
+
+    /**
+     * @label{Cursor_next}
+     * @brief Get the next object as (key, value)
+     *
+     * @throws std::runtime_error if there are no objects left or the cursor expired on the server
+     */
+    virtual std::tuple<std::string, json::Document> next() = 0;
+
+    /**
+     * @label{Cursor_close}
+     * @brief Discard the remaining objects
+     *
+     * This happens automatically once the cursor is destroyed
+     */
+    virtual void close() = 0;
+};
+
+using CursorPtr = std::shared_ptr<Cursor>;
+
+} // namespace credb
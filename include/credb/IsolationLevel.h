@@ -14,6 +14,9 @@ enum class IsolationLevel : uint8_t
     ReadCommitted,
     RepeatableRead,
     Serializable,
+
+    /// Read-only. All reads see the state of the database when the transaction began, and commits need no validation.
+    Snapshot,
 };
 
 #ifndef IS_ENCLAVE
@@ -33,6 +36,9 @@ inline std::ostream& operator<<(std::ostream &stream, const IsolationLevel &leve
     case IsolationLevel::Serializable:
         stream << "Serializable";
         break;
+    case IsolationLevel::Snapshot:
+        stream << "Snapshot";
+        break;
     default:
         throw std::runtime_error("Invalid isolation level");
     }
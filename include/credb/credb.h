@@ -2,4 +2,5 @@
 
 #include "Client.h"
 #include "Collection.h"
+#include "Cursor.h"
 #include "Transaction.h"
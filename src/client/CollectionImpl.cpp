@@ -3,17 +3,24 @@
 
 #include "CollectionImpl.h"
 #include "ClientImpl.h"
+#include "CursorImpl.h"
 #include "DocParser.h"
 
 #include "util/defines.h"
 #include "util/Identity.h"
 
+#include "PendingAggregateResponse.h"
 #include "PendingPutWithoutKeyResponse.h"
 #include "PendingCallResponse.h"
 #include "PendingBitstreamResponse.h"
 #include "PendingResponse.h"
+#include "PendingDocumentResponse.h"
 #include "PendingGetResponse.h"
+#include "PendingGetManyResponse.h"
+#include "PendingPutManyResponse.h"
+#include "PendingBulkLoadResponse.h"
 #include "PendingEventIdResponse.h"
+#include "PendingCursorResponse.h"
 #include "PendingFindResponse.h"
 #include "PendingListResponse.h"
 #include "PendingSizeResponse.h"
@@ -154,6 +161,38 @@ std::pair<json::Document, event_id_t> CollectionImpl::get_with_eid(const std::st
         {resp.document(), resp.event_id()};
 }
 
+std::vector<std::pair<json::Document, event_id_t>> CollectionImpl::get_many(const std::vector<std::string> &keys)
+{
+    return internal_get_many(keys, nullptr);
+}
+
+std::vector<std::pair<json::Document, event_id_t>>
+CollectionImpl::internal_get_many(const std::vector<std::string> &keys, const uint32_t *snapshot_id)
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, snapshot_id ? OperationType::GetObjectsAtSnapshot : OperationType::GetObjects);
+    req << m_name << keys;
+
+    if(snapshot_id)
+    {
+        req << *snapshot_id;
+    }
+
+    m_client.send_encrypted(req);
+
+    PendingGetManyResponse resp(op_id, m_client);
+    resp.wait();
+
+    auto result = resp.result();
+
+    if(result.size() != keys.size())
+    {
+        throw std::runtime_error("Snapshot expired or does not exist");
+    }
+
+    return result;
+}
+
 json::Document CollectionImpl::get_with_witness(const std::string &key, event_id_t &event_id, Witness &witness)
 {
     auto op_id = m_client.get_next_operation_id();
@@ -209,11 +248,26 @@ std::vector<json::Document> CollectionImpl::get_history(const std::string &key)
     return resp.result();
 }
 
-bool CollectionImpl::create_index(const std::string &index_name, const std::vector<std::string> &paths)
+bool CollectionImpl::create_ordered_index()
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::CreateOrderedIndex);
+    req << m_name;
+
+    m_client.send_encrypted(req);
+
+    PendingBooleanResponse resp(op_id, m_client);
+    resp.wait();
+    return resp.result();
+}
+
+bool CollectionImpl::create_index(const std::string &index_name,
+                                  const std::vector<std::string> &paths,
+                                  const std::vector<std::string> &include)
 {
     auto op_id = m_client.get_next_operation_id();
     auto req = m_client.generate_op_request(op_id, OperationType::CreateIndex);
-    req << m_name << index_name << paths;
+    req << m_name << index_name << paths << include;
 
     m_client.send_encrypted(req);
 
@@ -346,7 +400,7 @@ CollectionImpl::find_one(const json::Document &predicates, const std::vector<std
 }
 
 std::vector<std::tuple<std::string, event_id_t, json::Document>>
-CollectionImpl::internal_find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit)
+CollectionImpl::internal_find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit, const std::string &sort)
 {
     auto op_id = m_client.get_next_operation_id();
     auto req = m_client.generate_op_request(op_id, OperationType::FindObjects);
@@ -354,6 +408,7 @@ CollectionImpl::internal_find(const json::Document &predicates, const std::vecto
     req << predicates;
     req << projection;
     req << limit;
+    req << sort;
 
     m_client.send_encrypted(req);
 
@@ -364,7 +419,7 @@ CollectionImpl::internal_find(const json::Document &predicates, const std::vecto
 }
 
 std::vector<std::tuple<std::string, json::Document>>
-CollectionImpl::find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit)
+CollectionImpl::find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit, const std::string &sort)
 {
     auto op_id = m_client.get_next_operation_id();
     auto req = m_client.generate_op_request(op_id, OperationType::FindObjects);
@@ -372,6 +427,7 @@ CollectionImpl::find(const json::Document &predicates, const std::vector<std::st
     req << predicates;
     req << projection;
     req << limit;
+    req << sort;
 
     m_client.send_encrypted(req);
 
@@ -381,6 +437,129 @@ CollectionImpl::find(const json::Document &predicates, const std::vector<std::st
     return resp.result();
 }
 
+json::Document CollectionImpl::aggregate(const json::Document &aggregates,
+                                         const json::Document &predicates,
+                                         const std::string &group_by)
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::Aggregate);
+    req << m_name;
+    req << predicates << aggregates << group_by;
+
+    m_client.send_encrypted(req);
+
+    PendingAggregateResponse resp(op_id, m_client);
+    resp.wait();
+
+    if(!resp.success())
+    {
+        throw std::runtime_error("Aggregation failed: " + resp.error());
+    }
+
+    return resp.result();
+}
+
+std::vector<std::tuple<std::string, json::Document>>
+CollectionImpl::lookup(const std::string &local_path,
+                       const std::string &foreign_collection,
+                       const std::string &foreign_path,
+                       const std::string &into,
+                       const json::Document &predicates,
+                       const std::vector<std::string> &projection,
+                       int32_t limit)
+{
+    if(local_path.empty() || foreign_collection.empty())
+    {
+        throw std::runtime_error("Lookup needs a local path and a foreign collection");
+    }
+
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::LookupObjects);
+    req << m_name;
+    req << predicates;
+    req << projection;
+    req << limit;
+    req << local_path << foreign_collection << foreign_path << (into.empty() ? foreign_collection : into);
+
+    m_client.send_encrypted(req);
+
+    PendingFindResponse resp(op_id, m_client);
+    resp.wait();
+
+    return resp.result();
+}
+
+CursorPtr CollectionImpl::find_cursor(const json::Document &predicates,
+                                     const std::vector<std::string> &projection,
+                                     int32_t limit,
+                                     uint32_t batch_size)
+{
+    if(batch_size == 0)
+    {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::OpenCursor);
+    req << m_name;
+    req << predicates;
+    req << projection;
+    req << limit << batch_size;
+
+    m_client.send_encrypted(req);
+
+    PendingCursorResponse resp(op_id, m_client);
+    resp.wait();
+
+    if(!resp.success())
+    {
+        throw std::runtime_error("Failed to open cursor");
+    }
+
+    return std::make_shared<CursorImpl>(m_client, resp.cursor_id(), batch_size, std::move(resp.batch()), resp.has_more());
+}
+
+std::vector<std::tuple<std::string, json::Document>>
+CollectionImpl::scan(const std::string &start_key, const std::string &end_key, const std::vector<std::string> &projection, int32_t limit)
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::ScanObjects);
+    req << m_name;
+    req << start_key << end_key;
+    req << projection;
+    req << limit;
+
+    m_client.send_encrypted(req);
+
+    PendingFindResponse resp(op_id, m_client);
+    resp.wait();
+
+    return resp.result();
+}
+
+std::vector<std::tuple<std::string, json::Document>>
+CollectionImpl::scan_prefix(const std::string &prefix, const std::vector<std::string> &projection, int32_t limit)
+{
+    return scan(prefix, prefix_end(prefix), projection, limit);
+}
+
+json::Document CollectionImpl::explain(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit)
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::ExplainQuery);
+    req << m_name;
+    req << predicates;
+    req << projection;
+    req << limit;
+
+    m_client.send_encrypted(req);
+
+    PendingDocumentResponse resp(op_id, m_client);
+    resp.wait();
+
+    return resp.document();
+}
+
 event_id_t CollectionImpl::add(const std::string &key, const json::Document &value)
 {
     auto op_id = m_client.get_next_operation_id();
@@ -409,4 +588,47 @@ event_id_t CollectionImpl::put(const std::string &key, const json::Document &doc
     return resp.event_id();
 }
 
+std::vector<event_id_t> CollectionImpl::put_many(const std::vector<std::pair<std::string, json::Document>> &objects)
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::PutObjects);
+    req << m_name << static_cast<uint32_t>(objects.size());
+
+    for(auto &[key, document] : objects)
+    {
+        req << key << document;
+    }
+
+    m_client.send_encrypted(req);
+
+    PendingPutManyResponse resp(op_id, m_client);
+    resp.wait();
+
+    return resp.result();
+}
+
+std::vector<event_id_t> CollectionImpl::bulk_load(const std::vector<std::pair<std::string, json::Document>> &objects)
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::BulkLoad);
+    req << m_name << static_cast<uint32_t>(objects.size());
+
+    for(auto &[key, document] : objects)
+    {
+        req << key << document;
+    }
+
+    m_client.send_encrypted(req);
+
+    PendingBulkLoadResponse resp(op_id, m_client);
+    resp.wait();
+
+    if(!resp.success())
+    {
+        throw std::runtime_error("Bulk load failed: " + resp.error());
+    }
+
+    return resp.result();
+}
+
 } // namespace credb
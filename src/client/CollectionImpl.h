@@ -35,7 +35,11 @@ public:
 
     virtual std::tuple<std::string, event_id_t> put_and_generate_key(const json::Document &document) override;
  
-    virtual bool create_index(const std::string &index_name, const std::vector<std::string> &paths) override;
+    virtual bool create_ordered_index() override;
+
+    virtual bool create_index(const std::string &index_name,
+                              const std::vector<std::string> &paths,
+                              const std::vector<std::string> &include = {}) override;
 
     bool drop_index(const std::string &index_name) override;
 
@@ -43,6 +47,9 @@ public:
     virtual bool check(const std::string &key, const json::Document &predicate) override;
 
     virtual std::pair<json::Document, event_id_t> get_with_eid(const std::string &key) override;
+    virtual std::vector<std::pair<json::Document, event_id_t>> get_many(const std::vector<std::string> &keys) override;
+    virtual std::vector<event_id_t> put_many(const std::vector<std::pair<std::string, json::Document>> &objects) override;
+    virtual std::vector<event_id_t> bulk_load(const std::vector<std::pair<std::string, json::Document>> &objects) override;
     virtual json::Document get_with_witness(const std::string &key, event_id_t &event_id, Witness &witness) override;
 
     virtual std::vector<json::Document> get_history(const std::string &key) override;
@@ -52,12 +59,49 @@ public:
     std::tuple<std::string, event_id_t, json::Document>
     internal_find_one(const json::Document &predicates, const std::vector<std::string> &projection);
     std::vector<std::tuple<std::string, event_id_t, json::Document>>
-    internal_find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit = -1);
+    internal_find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit = -1, const std::string &sort = "");
+
+    /**
+     * @param snapshot_id
+     *      If set, read the versions at this snapshot held by the server (see Transaction with IsolationLevel::Snapshot)
+     */
+    std::vector<std::pair<json::Document, event_id_t>>
+    internal_get_many(const std::vector<std::string> &keys, const uint32_t *snapshot_id);
 
     virtual std::tuple<std::string, json::Document>
     find_one(const json::Document &predicates, const std::vector<std::string> &projection) override;
     virtual std::vector<std::tuple<std::string, json::Document>>
-    find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit = -1) override;
+    find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit = -1, const std::string &sort = "") override;
+
+    virtual json::Document aggregate(const json::Document &aggregates,
+                                     const json::Document &predicates = json::Document(""),
+                                     const std::string &group_by = "") override;
+
+    virtual std::vector<std::tuple<std::string, json::Document>>
+    lookup(const std::string &local_path,
+           const std::string &foreign_collection,
+           const std::string &foreign_path = "",
+           const std::string &into = "",
+           const json::Document &predicates = json::Document(""),
+           const std::vector<std::string> &projection = {},
+           int32_t limit = -1) override;
+
+    virtual CursorPtr find_cursor(const json::Document &predicates,
+                                  const std::vector<std::string> &projection = {},
+                                  int32_t limit = -1,
+                                  uint32_t batch_size = DEFAULT_CURSOR_BATCH_SIZE) override;
+
+    virtual std::vector<std::tuple<std::string, json::Document>>
+    scan(const std::string &start_key,
+         const std::string &end_key = "",
+         const std::vector<std::string> &projection = {},
+         int32_t limit = -1) override;
+
+    virtual std::vector<std::tuple<std::string, json::Document>>
+    scan_prefix(const std::string &prefix, const std::vector<std::string> &projection = {}, int32_t limit = -1) override;
+
+    virtual json::Document
+    explain(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit = -1) override;
 
     virtual std::vector<json::Document>
     diff(const std::string &key, version_number_t version1, version_number_t version2) override;
@@ -0,0 +1,95 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#include "CursorImpl.h"
+#include "ClientImpl.h"
+#include "PendingCursorResponse.h"
+#include "PendingResponse.h"
+
+namespace credb
+{
+
+CursorImpl::CursorImpl(ClientImpl &client, uint32_t cursor_id, uint32_t batch_size,
+                       std::deque<std::tuple<std::string, json::Document>> &&first_batch, bool has_more)
+    : m_client(client), m_cursor_id(cursor_id), m_batch_size(batch_size), m_batch(std::move(first_batch)), m_has_more(has_more)
+{
+}
+
+CursorImpl::~CursorImpl()
+{
+    try
+    {
+        close();
+    }
+    catch(std::exception &)
+    {
+        // the connection might already be closed
+    }
+}
+
+bool CursorImpl::has_next()
+{
+    // batches might be empty, e.g., if the last batch ended exactly with the last result
+    while(m_batch.empty() && m_has_more)
+    {
+        fetch_next_batch();
+    }
+
+    return !m_batch.empty();
+}
+
+std::tuple<std::string, json::Document> CursorImpl::next()
+{
+    if(!has_next())
+    {
+        throw std::runtime_error("No more objects");
+    }
+
+    auto res = std::move(m_batch.front());
+    m_batch.pop_front();
+    return res;
+}
+
+void CursorImpl::close()
+{
+    m_batch.clear();
+
+    if(!m_has_more)
+    {
+        return;
+    }
+
+    m_has_more = false;
+
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::CloseCursor);
+    req << m_cursor_id;
+
+    m_client.send_encrypted(req);
+
+    PendingBooleanResponse resp(op_id, m_client);
+    resp.wait();
+}
+
+void CursorImpl::fetch_next_batch()
+{
+    auto op_id = m_client.get_next_operation_id();
+    auto req = m_client.generate_op_request(op_id, OperationType::FetchCursor);
+    req << m_cursor_id << m_batch_size;
+
+    m_client.send_encrypted(req);
+
+    PendingCursorResponse resp(op_id, m_client);
+    resp.wait();
+
+    if(!resp.success())
+    {
+        m_has_more = false;
+        throw std::runtime_error("Cursor expired or does not exist");
+    }
+
+    m_batch = std::move(resp.batch());
+    m_has_more = resp.has_more();
+}
+
+} // namespace credb
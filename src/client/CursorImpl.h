@@ -0,0 +1,42 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#pragma once
+
+#include <deque>
+
+#include "credb/Cursor.h"
+
+namespace credb
+{
+
+class ClientImpl;
+
+class CursorImpl : public Cursor
+{
+public:
+    /**
+     * @param has_more
+     *      Does the server hold more objects for this cursor?
+     */
+    CursorImpl(ClientImpl &client, uint32_t cursor_id, uint32_t batch_size,
+               std::deque<std::tuple<std::string, json::Document>> &&first_batch, bool has_more);
+
+    ~CursorImpl();
+
+    bool has_next() override;
+    std::tuple<std::string, json::Document> next() override;
+    void close() override;
+
+private:
+    void fetch_next_batch();
+
+    ClientImpl &m_client;
+    const uint32_t m_cursor_id;
+    const uint32_t m_batch_size;
+
+    std::deque<std::tuple<std::string, json::Document>> m_batch;
+    bool m_has_more;
+};
+
+} // namespace credb
@@ -0,0 +1,46 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#pragma once
+
+#include <string>
+
+#include "PendingMessage.h"
+#include <json/json.h>
+
+namespace credb
+{
+
+class PendingAggregateResponse : public PendingMessage
+{
+public:
+    PendingAggregateResponse(operation_id_t id, ClientImpl &client) : PendingMessage(id, client) {}
+
+    bool success() const { return m_success; }
+
+    const std::string &error() const { return m_error; }
+
+    json::Document result() { return std::move(m_result); }
+
+protected:
+    void parse(bitstream &msg) override
+    {
+        msg >> m_success;
+
+        if(m_success)
+        {
+            msg >> m_result;
+        }
+        else
+        {
+            msg >> m_error;
+        }
+    }
+
+private:
+    bool m_success = false;
+    std::string m_error;
+    json::Document m_result;
+};
+
+} // namespace credb
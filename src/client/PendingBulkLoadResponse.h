@@ -0,0 +1,54 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PendingMessage.h"
+#include "credb/defines.h"
+
+namespace credb
+{
+
+class PendingBulkLoadResponse : public PendingMessage
+{
+public:
+    PendingBulkLoadResponse(operation_id_t id, ClientImpl &client) : PendingMessage(id, client) {}
+
+    bool success() const { return m_success; }
+
+    const std::string &error() const { return m_error; }
+
+    std::vector<event_id_t> result() { return std::move(m_result); }
+
+protected:
+    void parse(bitstream &msg) override
+    {
+        msg >> m_success;
+
+        if(!m_success)
+        {
+            msg >> m_error;
+            return;
+        }
+
+        uint32_t num_values = 0;
+        msg >> num_values;
+
+        for(uint32_t i = 0; i < num_values; ++i)
+        {
+            event_id_t eid;
+            msg >> eid;
+            m_result.push_back(eid);
+        }
+    }
+
+private:
+    bool m_success = false;
+    std::string m_error;
+    std::vector<event_id_t> m_result;
+};
+
+} // namespace credb
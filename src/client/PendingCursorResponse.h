@@ -0,0 +1,64 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <tuple>
+
+#include "PendingMessage.h"
+#include "credb/defines.h"
+#include <json/json.h>
+
+namespace credb
+{
+
+/**
+ * Response to opening a cursor or fetching its next batch
+ */
+class PendingCursorResponse : public PendingMessage
+{
+public:
+    PendingCursorResponse(operation_id_t id, ClientImpl &client) : PendingMessage(id, client) {}
+
+    bool success() const { return m_success; }
+
+    uint32_t cursor_id() const { return m_cursor_id; }
+
+    bool has_more() const { return m_has_more; }
+
+    std::deque<std::tuple<std::string, json::Document>> &batch() { return m_batch; }
+
+    void parse(bitstream &msg) override
+    {
+        msg >> m_success;
+
+        if(!m_success)
+        {
+            return;
+        }
+
+        uint32_t num_values = 0;
+        msg >> m_cursor_id >> num_values;
+
+        for(uint32_t i = 0; i < num_values; ++i)
+        {
+            std::string key;
+            event_id_t eid;
+            msg >> key >> eid;
+            (void)eid; // not used
+            m_batch.emplace_back(key, json::Document(msg));
+        }
+
+        msg >> m_has_more;
+    }
+
+private:
+    bool m_success = false;
+    uint32_t m_cursor_id = 0;
+    bool m_has_more = false;
+    std::deque<std::tuple<std::string, json::Document>> m_batch;
+};
+
+} // namespace credb
@@ -0,0 +1,48 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "PendingMessage.h"
+#include "credb/defines.h"
+#include <json/json.h>
+
+namespace credb
+{
+
+class PendingGetManyResponse : public PendingMessage
+{
+private:
+    std::vector<std::pair<json::Document, event_id_t>> m_result;
+
+public:
+    PendingGetManyResponse(operation_id_t id, ClientImpl &client) : PendingMessage(id, client) {}
+
+    auto result() -> decltype(m_result) && { return std::move(m_result); }
+
+    void parse(bitstream &msg) override
+    {
+        uint32_t num_values = 0;
+        msg >> num_values;
+
+        for(uint32_t i = 0; i < num_values; ++i)
+        {
+            event_id_t eid;
+            msg >> eid;
+
+            if(eid)
+            {
+                m_result.emplace_back(json::Document(msg), eid);
+            }
+            else
+            {
+                m_result.emplace_back(json::Document(""), eid);
+            }
+        }
+    }
+};
+
+} // namespace credb
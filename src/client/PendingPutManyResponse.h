@@ -0,0 +1,38 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#pragma once
+
+#include <vector>
+
+#include "PendingMessage.h"
+#include "credb/defines.h"
+
+namespace credb
+{
+
+class PendingPutManyResponse : public PendingMessage
+{
+private:
+    std::vector<event_id_t> m_result;
+
+public:
+    PendingPutManyResponse(operation_id_t id, ClientImpl &client) : PendingMessage(id, client) {}
+
+    auto result() -> decltype(m_result) && { return std::move(m_result); }
+
+    void parse(bitstream &msg) override
+    {
+        uint32_t num_values = 0;
+        msg >> num_values;
+
+        for(uint32_t i = 0; i < num_values; ++i)
+        {
+            event_id_t eid;
+            msg >> eid;
+            m_result.push_back(eid);
+        }
+    }
+};
+
+} // namespace credb
@@ -0,0 +1,29 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information
+
+#pragma once
+
+#include "PendingMessage.h"
+#include "credb/defines.h"
+
+namespace credb
+{
+
+class PendingSnapshotResponse : public PendingMessage
+{
+private:
+    uint32_t m_snapshot_id = 0;
+
+public:
+    PendingSnapshotResponse(operation_id_t id, ClientImpl &client) : PendingMessage(id, client) {}
+
+    /// Identifies the snapshot the server took on our behalf
+    uint32_t result() const { return m_snapshot_id; }
+
+    void parse(bitstream &msg) override
+    {
+        msg >> m_snapshot_id;
+    }
+};
+
+} // namespace credb
@@ -5,6 +5,7 @@
 #include "TransactionImpl.h"
 
 #include "op_info.h"
+#include "util/keys.h"
 
 namespace credb
 {
@@ -12,13 +13,34 @@ namespace credb
 event_id_t TransactionCollectionImpl::put(const std::string &key, const json::Document &doc)
 {
     m_transaction.assert_not_committed();
+    m_transaction.assert_writable();
     m_transaction.queue_op(new put_info_t(name(), key, doc));
     return INVALID_EVENT;
 }
 
+std::vector<event_id_t> TransactionCollectionImpl::put_many(const std::vector<std::pair<std::string, json::Document>> &objects)
+{
+    m_transaction.assert_not_committed();
+    m_transaction.assert_writable();
+
+    for(auto &[key, doc] : objects)
+    {
+        m_transaction.queue_op(new put_info_t(name(), key, doc));
+    }
+
+    return std::vector<event_id_t>(objects.size(), INVALID_EVENT);
+}
+
+std::vector<event_id_t> TransactionCollectionImpl::bulk_load(const std::vector<std::pair<std::string, json::Document>> &objects)
+{
+    (void)objects;
+    throw std::runtime_error("Bulk loads are not supported inside transactions");
+}
+
 event_id_t TransactionCollectionImpl::add(const std::string &key, const json::Document &doc)
 {
     m_transaction.assert_not_committed();
+    m_transaction.assert_writable();
     m_transaction.queue_op(new add_info_t(name(), key, doc));
     return INVALID_EVENT;
 }
@@ -26,6 +48,7 @@ event_id_t TransactionCollectionImpl::add(const std::string &key, const json::Do
 event_id_t TransactionCollectionImpl::remove(const std::string &key)
 {
     m_transaction.assert_not_committed();
+    m_transaction.assert_writable();
     m_transaction.queue_op(new remove_info_t(name(), key));
     return INVALID_EVENT;
 }
@@ -33,6 +56,12 @@ event_id_t TransactionCollectionImpl::remove(const std::string &key)
 bool TransactionCollectionImpl::check(const std::string &key, const json::Document &predicates)
 {
     m_transaction.assert_not_committed();
+
+    if(m_transaction.is_snapshot())
+    {
+        throw std::runtime_error("Snapshot transactions do not support check");
+    }
+
     auto res = CollectionImpl::check(key, predicates);
     m_transaction.queue_op(new check_obj_info_t(name(), key, predicates, res));
     return res;
@@ -41,6 +70,12 @@ bool TransactionCollectionImpl::check(const std::string &key, const json::Docume
 bool TransactionCollectionImpl::has_object(const std::string &key)
 {
     m_transaction.assert_not_committed();
+
+    if(m_transaction.is_snapshot())
+    {
+        return get_with_eid(key).second.is_valid();
+    }
+
     auto res = CollectionImpl::has_object(key);
     m_transaction.queue_op(new has_obj_info_t(name(), key, res));
     return res;
@@ -50,6 +85,22 @@ std::pair<json::Document, event_id_t> TransactionCollectionImpl::get_with_eid(co
 {
     m_transaction.assert_not_committed();
 
+    if(m_transaction.is_snapshot())
+    {
+        auto [obj_key, path] = parse_path(key);
+        auto res = internal_get_many({obj_key}, &m_transaction.m_snapshot_id);
+        auto &[doc, event_id] = res.at(0);
+
+        if(path.empty() || !event_id)
+        {
+            return {std::move(doc), event_id};
+        }
+        else
+        {
+            return {json::Document(doc, path).duplicate(true), event_id};
+        }
+    }
+
     auto [doc, event_id] = CollectionImpl::get_with_eid(key);
 
     m_transaction.queue_op(new get_info_t(name(), key, event_id));
@@ -58,12 +109,47 @@ std::pair<json::Document, event_id_t> TransactionCollectionImpl::get_with_eid(co
             {std::move(doc), event_id};
 }
 
+std::vector<std::pair<json::Document, event_id_t>> TransactionCollectionImpl::get_many(const std::vector<std::string> &keys)
+{
+    m_transaction.assert_not_committed();
+
+    if(m_transaction.is_snapshot())
+    {
+        // Nothing to validate on commit
+        return internal_get_many(keys, &m_transaction.m_snapshot_id);
+    }
+
+    auto res = CollectionImpl::get_many(keys);
+
+    for(size_t i = 0; i < res.size(); ++i)
+    {
+        auto &event_id = res[i].second;
+
+        if(event_id)
+        {
+            m_transaction.queue_op(new get_info_t(name(), keys[i], event_id));
+        }
+        else
+        {
+            // Make sure the object still doesn't exist on commit
+            m_transaction.queue_op(new has_obj_info_t(name(), keys[i], false));
+        }
+    }
+
+    return res;
+}
+
 std::vector<std::tuple<std::string, json::Document>>
-TransactionCollectionImpl::find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit)
+TransactionCollectionImpl::find(const json::Document &predicates, const std::vector<std::string> &projection, int32_t limit, const std::string &sort)
 {
     m_transaction.assert_not_committed();
 
-    auto res = CollectionImpl::internal_find(predicates, projection, limit);
+    if(m_transaction.is_snapshot())
+    {
+        throw std::runtime_error("Snapshot transactions do not support queries");
+    }
+
+    auto res = CollectionImpl::internal_find(predicates, projection, limit, sort);
 
     std::vector<std::tuple<std::string, json::Document>> r;
     std::vector<std::pair<std::string, event_id_t>> v;
@@ -79,6 +165,39 @@ TransactionCollectionImpl::find(const json::Document &predicates, const std::vec
     return r;
 }
 
+CursorPtr TransactionCollectionImpl::find_cursor(const json::Document &predicates,
+                                                const std::vector<std::string> &projection,
+                                                int32_t limit,
+                                                uint32_t batch_size)
+{
+    (void)predicates;
+    (void)projection;
+    (void)limit;
+    (void)batch_size;
+
+    throw std::runtime_error("Cursors are not supported inside transactions");
+}
+
+std::vector<std::tuple<std::string, json::Document>>
+TransactionCollectionImpl::lookup(const std::string &local_path,
+                                  const std::string &foreign_collection,
+                                  const std::string &foreign_path,
+                                  const std::string &into,
+                                  const json::Document &predicates,
+                                  const std::vector<std::string> &projection,
+                                  int32_t limit)
+{
+    (void)local_path;
+    (void)foreign_collection;
+    (void)foreign_path;
+    (void)into;
+    (void)predicates;
+    (void)projection;
+    (void)limit;
+
+    throw std::runtime_error("Lookups are not supported inside transactions");
+}
+
 std::tuple<std::string, json::Document>
 TransactionCollectionImpl::find_one(const json::Document &predicates, const std::vector<std::string> &projection)
 {
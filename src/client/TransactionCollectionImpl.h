@@ -22,16 +22,39 @@ public:
     bool check(const std::string &key, const json::Document &predicates) override;
 
     event_id_t put(const std::string &key, const json::Document &doc) override;
+    std::vector<event_id_t> put_many(const std::vector<std::pair<std::string, json::Document>> &objects) override;
+
+    /// Not supported: bulk loads need exclusive access to the ledger
+    std::vector<event_id_t> bulk_load(const std::vector<std::pair<std::string, json::Document>> &objects) override;
+
     event_id_t add(const std::string &key, const json::Document &doc) override;
     std::pair<json::Document, event_id_t> get_with_eid(const std::string &key) override;
+    std::vector<std::pair<json::Document, event_id_t>> get_many(const std::vector<std::string> &keys) override;
     std::tuple<std::string, json::Document> find_one(const json::Document &predicates = json::Document(""),
                                                      const std::vector<std::string> &projection = {}) override;
     std::vector<std::tuple<std::string, json::Document>>
     find(const json::Document &predicates = json::Document(""),
          const std::vector<std::string> &projection = {},
-         int32_t limit = -1) override;
+         int32_t limit = -1,
+         const std::string &sort = "") override;
     event_id_t remove(const std::string &key) override;
 
+    /// Not supported: the objects read through a cursor can't be validated on commit
+    CursorPtr find_cursor(const json::Document &predicates = json::Document(""),
+                          const std::vector<std::string> &projection = {},
+                          int32_t limit = -1,
+                          uint32_t batch_size = DEFAULT_CURSOR_BATCH_SIZE) override;
+
+    /// Not supported: the referenced objects can't be validated on commit
+    std::vector<std::tuple<std::string, json::Document>>
+    lookup(const std::string &local_path,
+           const std::string &foreign_collection,
+           const std::string &foreign_path = "",
+           const std::string &into = "",
+           const json::Document &predicates = json::Document(""),
+           const std::vector<std::string> &projection = {},
+           int32_t limit = -1) override;
+
 private:
     TransactionImpl &m_transaction;
 };
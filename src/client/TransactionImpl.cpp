@@ -4,6 +4,8 @@
 #include "TransactionImpl.h"
 #include "ClientImpl.h"
 #include "PendingBitstreamResponse.h"
+#include "PendingResponse.h"
+#include "PendingSnapshotResponse.h"
 #include "TransactionCollectionImpl.h"
 
 namespace credb
@@ -12,6 +14,17 @@ namespace credb
 TransactionImpl::TransactionImpl(ClientImpl &client, IsolationLevel isolation)
 : Transaction(isolation), m_client(client), m_done(false)
 {
+    if(is_snapshot())
+    {
+        auto op_id = m_client.get_next_operation_id();
+        auto req = m_client.generate_op_request(op_id, OperationType::GetSnapshot);
+        m_client.send_encrypted(req);
+
+        PendingSnapshotResponse resp(op_id, m_client);
+        resp.wait();
+
+        m_snapshot_id = resp.result();
+    }
 }
 
 TransactionImpl::~TransactionImpl()
@@ -29,6 +42,30 @@ TransactionResult TransactionImpl::commit(bool generate_witness)
         throw std::runtime_error("Already committed this transaction!");
     }
 
+    if(is_snapshot())
+    {
+        // All reads were served from the same snapshot, so there is nothing to validate
+        m_done = true;
+
+        auto op_id = m_client.get_next_operation_id();
+        auto req = m_client.generate_op_request(op_id, OperationType::ReleaseSnapshot);
+        req << m_snapshot_id;
+        m_client.send_encrypted(req);
+
+        PendingBooleanResponse resp(op_id, m_client);
+        resp.wait();
+
+        TransactionResult res;
+        res.success = !generate_witness;
+
+        if(generate_witness)
+        {
+            res.error = "Snapshot transactions cannot generate witnesses";
+        }
+
+        return res;
+    }
+
     auto op_id = m_client.get_next_operation_id();
     auto req = m_client.generate_op_request(op_id, OperationType::ExecuteTransaction);
 
@@ -34,10 +34,16 @@ private:
 
     void queue_op(operation_info_t *info) { m_ops.push_back(info); }
     void assert_not_committed() const;
+    void assert_writable() const;
+
+    bool is_snapshot() const { return m_isolation == IsolationLevel::Snapshot; }
 
     ClientImpl &m_client;
     bool m_done;
     std::vector<operation_info_t *> m_ops;
+
+    /// Identifies the snapshot the server keeps for this transaction (only for snapshot transactions)
+    uint32_t m_snapshot_id = 0;
 };
 
 inline bool TransactionImpl::is_done() const { return m_done; }
@@ -48,5 +54,11 @@ inline void TransactionImpl::assert_not_committed() const
         throw std::runtime_error("The transaction has finished.");
 }
 
+inline void TransactionImpl::assert_writable() const
+{
+    if(is_snapshot())
+        throw std::runtime_error("Snapshot transactions are read-only.");
+}
+
 
 } // namespace credb
@@ -39,6 +39,20 @@ enum class OperationType : uint8_t
     TransactionCommit,
     TransactionAbort,
     GetStatistics,
+    ExplainQuery,
+    CreateOrderedIndex,
+    ScanObjects,
+    OpenCursor,
+    FetchCursor,
+    CloseCursor,
+    Aggregate,
+    LookupObjects,
+    GetObjects,
+    PutObjects,
+    BulkLoad,
+    GetSnapshot,
+    GetObjectsAtSnapshot,
+    ReleaseSnapshot,
     // debug purpose
     NOP,
     DumpEverything,
@@ -53,3 +53,29 @@ inline std::pair<std::string, std::string> parse_path(const std::string &full_pa
 }
 
  
+
+/**
+ * @brief Get the smallest key that is larger than all keys starting with prefix
+ *
+ * This allows expressing a prefix scan as a range scan [prefix, prefix_end(prefix)).
+ * The result is empty if there is no upper bound.
+ */
+inline std::string prefix_end(const std::string &prefix)
+{
+    std::string end = prefix;
+
+    while(!end.empty())
+    {
+        auto &c = end.back();
+
+        if(static_cast<unsigned char>(c) != 0xFF)
+        {
+            c = static_cast<char>(static_cast<unsigned char>(c) + 1);
+            return end;
+        }
+
+        end.pop_back();
+    }
+
+    return end;
+}
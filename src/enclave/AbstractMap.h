@@ -50,7 +50,14 @@ public:
         }
     }
 
-    void load_root(bitstream &in)
+    virtual ~AbstractMap() = default;
+
+    /**
+     * Replace the bucket roots with the ones written by serialize_root()
+     *
+     * Subclasses that keep state derived from the buckets override this to update it
+     */
+    virtual void load_root(bitstream &in)
     {
         for(auto &shard : m_shards)
         {
@@ -100,6 +107,16 @@ protected:
         std::condition_variable_any condition_var;
     };
 
+    /**
+     * Write the current state of a bucket so that it can be passed to apply_changes()
+     *
+     * @note you must hold at least a read lock to the bucket's shard
+     */
+    void write_changes(bitstream &out, bucketid_t bid)
+    {
+        out << bid << m_buckets[bid];
+    }
+
     /**
      * Get the successor a specific node
      *
@@ -175,6 +192,11 @@ protected:
         return m_shards[id % NUM_SHARDS];
     }
 
+    BufferManager& buffer_manager()
+    {
+        return m_buffer;
+    }
+
     std::atomic<size_t> m_size;
 
     AbstractMap(BufferManager &buffer, const std::string &name)
@@ -0,0 +1,339 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "Aggregation.h"
+
+#include <stdexcept>
+
+namespace credb::trusted
+{
+
+Aggregation::Aggregation(const json::Document &aggregates, std::string group_by)
+    : m_group_by(std::move(group_by))
+{
+    if(aggregates.empty() || aggregates.get_type() != json::ObjectType::Map)
+    {
+        throw std::runtime_error("Aggregates must be a map");
+    }
+
+    for(uint32_t pos = 0; pos < aggregates.get_size(); ++pos)
+    {
+        auto name = aggregates.get_key(pos);
+        json::Document spec(aggregates, name);
+
+        if(!m_group_by.empty() && name == GROUP_FIELD)
+        {
+            throw std::runtime_error("Aggregate name is reserved: " + name);
+        }
+
+        if(spec.get_type() != json::ObjectType::Map || spec.get_size() != 1)
+        {
+            throw std::runtime_error("Invalid aggregate: " + name);
+        }
+
+        auto op = spec.get_key(0);
+        json::Document path(spec, op);
+        Function function;
+
+        if(op == "$count")
+        {
+            function = Function::Count;
+        }
+        else if(op == "$sum")
+        {
+            function = Function::Sum;
+        }
+        else if(op == "$min")
+        {
+            function = Function::Min;
+        }
+        else if(op == "$max")
+        {
+            function = Function::Max;
+        }
+        else if(op == "$avg")
+        {
+            function = Function::Avg;
+        }
+        else
+        {
+            throw std::runtime_error("Unknown aggregate function: " + op);
+        }
+
+        auto path_value = ScalarValue::read(path);
+
+        if(path_value.type != ScalarValue::Type::String)
+        {
+            throw std::runtime_error("Path of aggregate must be a string: " + name);
+        }
+
+        auto &path_str = path_value.string;
+
+        if(path_str.empty() && function != Function::Count)
+        {
+            throw std::runtime_error("Aggregate needs a path: " + name);
+        }
+
+        m_aggregates.push_back(aggregate_t{name, function, path_str});
+    }
+}
+
+std::vector<std::string> Aggregation::paths() const
+{
+    std::vector<std::string> result;
+
+    if(!m_group_by.empty())
+    {
+        result.push_back(m_group_by);
+    }
+
+    for(auto &aggregate : m_aggregates)
+    {
+        if(!aggregate.path.empty())
+        {
+            result.push_back(aggregate.path);
+        }
+    }
+
+    return result;
+}
+
+bool Aggregation::counts_only() const
+{
+    return m_group_by.empty() && paths().empty();
+}
+
+void Aggregation::add(const json::Document &object)
+{
+    std::string group_key;
+
+    if(!m_group_by.empty())
+    {
+        json::Document group_value(object, m_group_by);
+
+        if(!group_value.empty())
+        {
+            group_key = group_value.str();
+        }
+    }
+
+    auto it = m_groups.find(group_key);
+
+    if(it == m_groups.end())
+    {
+        it = m_groups.emplace(group_key, group_t(m_aggregates.size())).first;
+    }
+
+    auto &group = it->second;
+
+    for(size_t i = 0; i < m_aggregates.size(); ++i)
+    {
+        update(group[i], m_aggregates[i], object);
+    }
+}
+
+void Aggregation::add_count(size_t num_objects)
+{
+    if(!counts_only())
+    {
+        throw std::runtime_error("Aggregation needs to look at the objects");
+    }
+
+    auto it = m_groups.find("");
+
+    if(it == m_groups.end())
+    {
+        it = m_groups.emplace("", group_t(m_aggregates.size())).first;
+    }
+
+    for(auto &state : it->second)
+    {
+        state.count += num_objects;
+    }
+}
+
+void Aggregation::update(state_t &state, const aggregate_t &aggregate, const json::Document &object) const
+{
+    if(aggregate.path.empty())
+    {
+        // unconditional count
+        state.count += 1;
+        return;
+    }
+
+    json::Document view(object, aggregate.path);
+
+    if(view.empty())
+    {
+        return;
+    }
+
+    if(aggregate.function == Function::Count)
+    {
+        state.count += 1;
+        return;
+    }
+
+    auto value = ScalarValue::read(view);
+
+    switch(aggregate.function)
+    {
+    case Function::Sum:
+    case Function::Avg:
+        // non-numeric values are ignored
+        if(value.type == ScalarValue::Type::Integer)
+        {
+            state.count += 1;
+            state.integer_sum += value.integer;
+            state.float_sum += static_cast<json::float_t>(value.integer);
+        }
+        else if(value.type == ScalarValue::Type::Float)
+        {
+            state.count += 1;
+            state.is_float = true;
+            state.float_sum += value.floating;
+        }
+        break;
+    case Function::Min:
+        if(value.type != ScalarValue::Type::None && (state.extreme.type == ScalarValue::Type::None || value < state.extreme))
+        {
+            state.extreme = std::move(value);
+        }
+        break;
+    case Function::Max:
+        if(value.type != ScalarValue::Type::None && (state.extreme.type == ScalarValue::Type::None || state.extreme < value))
+        {
+            state.extreme = std::move(value);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void Aggregation::merge(const Aggregation &other)
+{
+    for(auto &[key, other_group] : other.m_groups)
+    {
+        auto it = m_groups.find(key);
+
+        if(it == m_groups.end())
+        {
+            m_groups.emplace(key, other_group);
+            continue;
+        }
+
+        for(size_t i = 0; i < m_aggregates.size(); ++i)
+        {
+            merge(it->second[i], other_group[i], m_aggregates[i]);
+        }
+    }
+}
+
+void Aggregation::merge(state_t &state, const state_t &other, const aggregate_t &aggregate) const
+{
+    state.count += other.count;
+    state.is_float = state.is_float || other.is_float;
+    state.integer_sum += other.integer_sum;
+    state.float_sum += other.float_sum;
+
+    if(other.extreme.type == ScalarValue::Type::None)
+    {
+        return;
+    }
+
+    if(state.extreme.type == ScalarValue::Type::None
+       || (aggregate.function == Function::Min && other.extreme < state.extreme)
+       || (aggregate.function == Function::Max && state.extreme < other.extreme))
+    {
+        state.extreme = other.extreme;
+    }
+}
+
+void Aggregation::write(json::Writer &writer, const group_t &group) const
+{
+    for(size_t i = 0; i < m_aggregates.size(); ++i)
+    {
+        auto &aggregate = m_aggregates[i];
+        auto &state = group[i];
+
+        switch(aggregate.function)
+        {
+        case Function::Count:
+            writer.write_integer(aggregate.name, static_cast<json::integer_t>(state.count));
+            break;
+        case Function::Sum:
+            if(state.is_float)
+            {
+                writer.write_float(aggregate.name, state.float_sum);
+            }
+            else
+            {
+                writer.write_integer(aggregate.name, state.integer_sum);
+            }
+            break;
+        case Function::Avg:
+            if(state.count == 0)
+            {
+                writer.write_null(aggregate.name);
+            }
+            else
+            {
+                writer.write_float(aggregate.name, state.float_sum / static_cast<json::float_t>(state.count));
+            }
+            break;
+        case Function::Min:
+        case Function::Max:
+            state.extreme.write(writer, aggregate.name);
+            break;
+        }
+    }
+}
+
+json::Document Aggregation::result() const
+{
+    json::Writer writer;
+
+    if(m_group_by.empty())
+    {
+        writer.start_map();
+
+        auto it = m_groups.find("");
+
+        // Also return a result if there are no objects
+        write(writer, it == m_groups.end() ? group_t(m_aggregates.size()) : it->second);
+
+        writer.end_map();
+    }
+    else
+    {
+        writer.start_array();
+
+        size_t pos = 0;
+
+        for(auto &[key, group] : m_groups)
+        {
+            writer.start_map(std::to_string(pos));
+
+            if(key.empty())
+            {
+                writer.write_null(GROUP_FIELD);
+            }
+            else
+            {
+                writer.write_document(GROUP_FIELD, json::Document(key));
+            }
+
+            write(writer, group);
+            writer.end_map();
+
+            pos += 1;
+        }
+
+        writer.end_array();
+    }
+
+    return writer.make_document();
+}
+
+} // namespace credb::trusted
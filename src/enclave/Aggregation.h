@@ -0,0 +1,117 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+#include "ScalarValue.h"
+
+namespace credb::trusted
+{
+
+/**
+ * Evaluates aggregate functions over a stream of objects
+ *
+ * The aggregates are specified as a map from output name to function, e.g.
+ * {"total": {"$sum": "price"}, "cheapest": {"$min": "price"}, "num": {"$count": ""}}.
+ * Supported functions are $count, $sum, $min, $max and $avg.
+ * $count with an empty path counts all objects, otherwise it counts the objects that contain the path.
+ *
+ * Without a group-by path the result is a map of the aggregates.
+ * Otherwise, it is an array with one map per group, where the field "group" holds the value of the group-by path.
+ */
+class Aggregation
+{
+public:
+    /// Name of the field that holds the group value
+    static constexpr const char *GROUP_FIELD = "group";
+
+    /**
+     * @throws std::runtime_error if the specification is invalid
+     */
+    Aggregation(const json::Document &aggregates, std::string group_by = "");
+
+    /**
+     * Update all aggregates with the values of the object
+     */
+    void add(const json::Document &object);
+
+    /**
+     * Account for num_objects objects without looking at them
+     *
+     * @note only valid if counts_only() is true
+     */
+    void add_count(size_t num_objects);
+
+    /**
+     * Combine with the state of another aggregation with the same specification
+     *
+     * This allows evaluating parts of a scan separately
+     */
+    void merge(const Aggregation &other);
+
+    json::Document result() const;
+
+    /**
+     * Forget all objects added so far (but keep the specification)
+     */
+    void clear() { m_groups.clear(); }
+
+    /**
+     * All paths that need to be read from the objects
+     */
+    std::vector<std::string> paths() const;
+
+    /**
+     * Is the result determined by the number of objects alone?
+     */
+    bool counts_only() const;
+
+private:
+    enum class Function
+    {
+        Count,
+        Sum,
+        Min,
+        Max,
+        Avg
+    };
+
+    struct aggregate_t
+    {
+        std::string name;
+        Function function;
+        std::string path;
+    };
+
+    struct state_t
+    {
+        uint64_t count = 0;
+
+        bool is_float = false;
+        json::integer_t integer_sum = 0;
+        json::float_t float_sum = 0.0;
+
+        /// Minimum or maximum seen so far (if any)
+        ScalarValue extreme;
+    };
+
+    using group_t = std::vector<state_t>;
+
+    void update(state_t &state, const aggregate_t &aggregate, const json::Document &object) const;
+    void merge(state_t &state, const state_t &other, const aggregate_t &aggregate) const;
+    void write(json::Writer &writer, const group_t &group) const;
+
+    std::vector<aggregate_t> m_aggregates;
+    const std::string m_group_by;
+
+    /// Groups indexed by the JSON representation of their value (empty if the path does not exist)
+    std::map<std::string, group_t> m_groups;
+};
+
+} // namespace credb::trusted
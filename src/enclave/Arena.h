@@ -0,0 +1,119 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace credb
+{
+namespace trusted
+{
+
+/**
+ * A simple bump allocator
+ *
+ * Memory is handed out sequentially and can only be freed all at once.
+ * The first chunk is stored inline, so small workloads never touch the heap.
+ *
+ * @note Destructors of objects created in the arena are not invoked by the arena
+ * @note This class shall only be used by one thread
+ */
+class Arena
+{
+public:
+    static constexpr size_t INLINE_SIZE = 2048;
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    Arena()
+        : m_pos(reinterpret_cast<uintptr_t>(m_inline)), m_end(m_pos + INLINE_SIZE)
+    {}
+
+    Arena(const Arena &other) = delete;
+    Arena(Arena &&other) = delete;
+
+    ~Arena()
+    {
+        clear();
+    }
+
+    /**
+     * Get an uninitialized piece of memory that lives until the next call to clear()
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        auto pos = align(m_pos, alignment);
+
+        if(pos + size > m_end)
+        {
+            new_chunk(size + alignment);
+            pos = align(m_pos, alignment);
+        }
+
+        m_pos = pos + size;
+        return reinterpret_cast<void*>(pos);
+    }
+
+    /**
+     * Construct a new object in the arena
+     */
+    template<typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Free all memory at once
+     *
+     * The inline chunk is kept for reuse
+     */
+    void clear()
+    {
+        for(auto chunk : m_chunks)
+        {
+            delete[] chunk;
+        }
+
+        m_chunks.clear();
+        m_pos = reinterpret_cast<uintptr_t>(m_inline);
+        m_end = m_pos + INLINE_SIZE;
+    }
+
+    /**
+     * The number of chunks that had to be allocated on the heap
+     */
+    size_t num_chunks() const
+    {
+        return m_chunks.size();
+    }
+
+private:
+    static uintptr_t align(uintptr_t pos, size_t alignment)
+    {
+        return (pos + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    }
+
+    void new_chunk(size_t min_size)
+    {
+        const size_t size = min_size > CHUNK_SIZE ? min_size : CHUNK_SIZE;
+        auto chunk = new uint8_t[size];
+
+        m_chunks.push_back(chunk);
+        m_pos = reinterpret_cast<uintptr_t>(chunk);
+        m_end = m_pos + size;
+    }
+
+    alignas(std::max_align_t) uint8_t m_inline[INLINE_SIZE];
+
+    uintptr_t m_pos, m_end;
+
+    std::vector<uint8_t*> m_chunks;
+};
+
+} // namespace trusted
+} // namespace credb
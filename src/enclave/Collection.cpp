@@ -5,8 +5,11 @@
 #include "BufferManager.h"
 #include "Enclave.h"
 #include "Index.h"
+#include "IndexBuilder.h"
 #include "HashMap.h"
 #include "Ledger.h"
+#include "OrderedKeyIndex.h"
+#include "OrderedKeyIndexBuilder.h"
 #include "RemoteParties.h"
 #include "logging.h"
 
@@ -14,16 +17,19 @@ namespace credb::trusted
 {
 
 Collection::Collection(BufferManager &buffer_manager, std::string name)
-: m_buffer_manager(buffer_manager), m_name(std::move(name))
+: m_buffer_manager(buffer_manager), m_name(std::move(name)), m_ordered_index(nullptr), m_num_objects(0), m_num_objects_with_policy(0)
 {
     m_primary_index = new HashMap(m_buffer_manager, m_name + "_primary_index");
 }
 
 Collection::Collection(Collection &&other) noexcept
 : m_buffer_manager(other.m_buffer_manager), m_name(other.m_name),
-  m_primary_index(other.m_primary_index), m_secondary_indexes(std::move(other.m_secondary_indexes))
+  m_primary_index(other.m_primary_index), m_ordered_index(other.m_ordered_index.load()),
+  m_secondary_indexes(std::move(other.m_secondary_indexes)), m_num_objects(other.m_num_objects.load()),
+  m_num_objects_with_policy(other.m_num_objects_with_policy.load()), m_exact_counts(other.m_exact_counts)
 {
     other.m_primary_index = nullptr;
+    other.m_ordered_index = nullptr;
 }
 
 Collection::~Collection()
@@ -31,16 +37,64 @@ Collection::~Collection()
     delete m_primary_index;
     m_primary_index = nullptr;
 
-    for(auto it : m_secondary_indexes)
+    delete m_ordered_index.load();
+    m_ordered_index = nullptr;
+
+    m_secondary_indexes.clear();
+}
+
+std::unordered_map<std::string, std::shared_ptr<Index>> Collection::secondary_indexes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_secondary_indexes;
+}
+
+bool Collection::create_ordered_index(Enclave &enclave, Ledger &ledger)
+{
+    OrderedKeyIndex *index = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_ordered_index != nullptr)
+        {
+            return false;
+        }
+
+        // Register the index right away so that writers start maintaining it
+        index = new OrderedKeyIndex();
+        m_ordered_index = index;
+    }
+
+    auto builder = std::make_shared<OrderedKeyIndexBuilder>(enclave, ledger, *this, m_name, *index);
+
+    // Do the first batch right away. Small collections will be indexed immediately.
+    builder->resume();
+
+    if(!builder->is_done())
     {
-        delete it.second;
+        enclave.task_manager().register_background_task(builder);
     }
 
-    m_secondary_indexes.clear();
+    return true;
+}
+
+std::shared_ptr<Index> Collection::get_secondary_index(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_secondary_indexes.find(name);
+
+    if(it == m_secondary_indexes.end())
+    {
+        return nullptr;
+    }
+
+    return it->second;
 }
 
 bool Collection::drop_index(const std::string &name)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     auto it = m_secondary_indexes.find(name);
 
     if(it == m_secondary_indexes.end())
@@ -48,39 +102,65 @@ bool Collection::drop_index(const std::string &name)
         return false;
     }
 
-    // FIXME not thread safe!
+    // Queries and IndexBuilders that still use the index keep it alive until they are done
     it->second->clear();
-    delete it->second;
     m_secondary_indexes.erase(it);
     return true;
 }
 
-bool Collection::create_index(const std::string &name, const std::vector<std::string> &paths, Enclave &enclave, Ledger &ledger)
+bool Collection::create_index(const std::string &name,
+                              const std::vector<std::string> &paths,
+                              const std::vector<std::string> &include,
+                              Enclave &enclave,
+                              Ledger &ledger)
 {
-    if(m_secondary_indexes.find(name) != m_secondary_indexes.end())
     {
-        log_debug("index " + name + " already exists. ignore");
-        return false;
-    }
+        std::lock_guard<std::mutex> lock(m_mutex);
 
-    Index *index = new HashIndex(m_buffer_manager, name, paths);
-    m_secondary_indexes.insert({ name, index });
+        if(m_secondary_indexes.find(name) != m_secondary_indexes.end())
+        {
+            log_debug("index " + name + " already exists. ignore");
+            return false;
+        }
 
-    std::unique_ptr<ObjectKeyProvider> key_provider(new HashMap::LinearScanKeyProvider(*m_primary_index));
+        // Register the index right away so that writers start maintaining it
+        // It won't be used by queries until the IndexBuilder is done
+        auto index = std::make_shared<HashIndex>(m_buffer_manager, name, paths, include);
+        index->set_build_progress(0.0);
 
-    OpContext context(enclave.identity());
+        m_secondary_indexes.insert({ name, index });
+    }
 
-    ObjectListIterator oit(context, m_name, json::Document(""), ledger, nullptr, std::move(key_provider));
+    start_index_builder(name, enclave, ledger);
+    return true;
+}
 
-    std::string key;
-    ObjectEventHandle event;
-    while(oit.next(key, event))
+void Collection::build_secondary_indexes(Enclave &enclave, Ledger &ledger)
+{
+    for(auto &it : secondary_indexes())
     {
-        json::Document view = event.value();
-        index->insert(view, key);
+        start_index_builder(it.first, enclave, ledger);
     }
+}
 
-    return true;
+void Collection::start_index_builder(const std::string &name, Enclave &enclave, Ledger &ledger)
+{
+    auto index = get_secondary_index(name);
+
+    if(!index)
+    {
+        return;
+    }
+
+    auto builder = std::make_shared<IndexBuilder>(enclave, ledger, *this, m_name, name, index);
+
+    // Do the first batch right away. Small collections will be indexed immediately.
+    builder->resume();
+
+    if(!builder->is_done())
+    {
+        enclave.task_manager().register_background_task(builder);
+    }
 }
 
 void Collection::update_index(const std::string &name, bitstream &changes)
@@ -138,50 +218,113 @@ void Collection::load_metadata(bitstream &input)
 {
     //m_primary_index->load_metadata(input);
 
+    // Older metadata starts with the number of secondary indexes
+    size_t marker;
+    input >> marker;
+
+    uint32_t version = 0;
     size_t num_s_indexes;
-    input >> num_s_indexes;
+
+    if(marker == METADATA_MARKER)
+    {
+        input >> version;
+
+        if(version > METADATA_VERSION)
+        {
+            throw std::runtime_error("Unsupported collection metadata version: " + std::to_string(version));
+        }
+
+        size_t num_objects, num_objects_with_policy;
+        input >> num_objects >> num_objects_with_policy;
+        m_num_objects = num_objects;
+        m_num_objects_with_policy = num_objects_with_policy;
+        m_exact_counts = true;
+
+        input >> num_s_indexes;
+    }
+    else
+    {
+        log_warning("Collection " + m_name + " has no object counts. Counts will be estimated.");
+
+        m_num_objects = m_primary_index->size();
+        m_num_objects_with_policy = 0;
+        m_exact_counts = false;
+
+        num_s_indexes = marker;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
 
     for(size_t j = 0; j < num_s_indexes; ++j)
     {
         std::string name;
         input >> name;
 
-        HashIndex *index = HashIndex::new_from_metadata(m_buffer_manager, input);
+        std::shared_ptr<Index> index(HashIndex::new_from_metadata(m_buffer_manager, input, version));
+
+        // The content of the index is not part of the metadata
+        index->set_build_progress(0.0);
 
         auto it = m_secondary_indexes.find(name);
         if(it != m_secondary_indexes.end())
         {
             log_debug("Replacing index " + name);
-            delete it->second;
             m_secondary_indexes.erase(it);
         }
 
         m_secondary_indexes[name] = index;
     }
+
+    bool has_ordered_index = false;
+
+    if(version > 0)
+    {
+        input >> has_ordered_index;
+    }
+
+    if(has_ordered_index)
+    {
+        if(m_ordered_index == nullptr)
+        {
+            m_ordered_index = new OrderedKeyIndex();
+        }
+
+        m_ordered_index.load()->load_metadata(input);
+    }
 }
 
 void Collection::dump_metadata(bitstream &output)
 {
     //m_primary_index->dump_metadata(output);
 
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    output << METADATA_MARKER << METADATA_VERSION;
+    output << m_num_objects.load() << m_num_objects_with_policy.load();
     output << m_secondary_indexes.size();
 
-    for(auto it : m_secondary_indexes)
+    for(auto &it : m_secondary_indexes)
     {
         output << it.first;
         it.second->dump_metadata(output);
     }
+
+    // An incomplete index is simply created again on restart, and a full one is dropped
+    auto ordered_index = m_ordered_index.load();
+    const bool has_ordered_index = ordered_index != nullptr && ordered_index->is_ready();
+    output << has_ordered_index;
+
+    if(has_ordered_index)
+    {
+        ordered_index->dump_metadata(output);
+    }
 }
 
 void Collection::unload_everything()
 {
     //m_primary_index->unload_everything();
 
-    for(auto it_ : m_secondary_indexes)
-    {
-        delete it_.second;
-    }
-
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_secondary_indexes.clear();
 }
 
@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 #include <mutex>
@@ -21,6 +24,7 @@ class RemoteParties;
 class StringIndex;
 class BufferManager;
 class HashMap;
+class OrderedKeyIndex;
 
 class Collection
 {
@@ -31,14 +35,33 @@ public:
 
     ~Collection();
 
+    /**
+     * @note Secondary indexes are not ready after loading. Call build_secondary_indexes to populate them again.
+     */
     void load_metadata(bitstream &input);
     void unload_everything();
     void dump_metadata(bitstream &output);
 
-    bool create_index(const std::string &name, const std::vector<std::string> &paths, Enclave &enclave, Ledger &ledger);
+    /**
+     * @param include
+     *      Additional paths to store in the index (makes it a covering index)
+     */
+    bool create_index(const std::string &name,
+                      const std::vector<std::string> &paths,
+                      const std::vector<std::string> &include,
+                      Enclave &enclave,
+                      Ledger &ledger);
 
     bool drop_index(const std::string &name);
 
+    /**
+     * Fill all secondary indexes from the primary index (in the background)
+     *
+     * Used after a bulk load, which does not maintain secondary indexes itself.
+     * @note the indexes must be empty and marked as incomplete already
+     */
+    void build_secondary_indexes(Enclave &enclave, Ledger &ledger);
+
 #ifndef IS_TEST
     void notify_triggers(RemoteParties &parties);
 #endif
@@ -51,14 +74,77 @@ public:
 
     HashMap &primary_index() { return *m_primary_index; }
 
-    std::unordered_map<std::string, Index *> secondary_indexes() { return m_secondary_indexes; }
+    /**
+     * Start keeping the keys of this collection in order (allows range and prefix scans)
+     *
+     * Existing keys are added by a background task (see OrderedKeyIndexBuilder)
+     *
+     * @return false if the index already existed
+     */
+    bool create_ordered_index(Enclave &enclave, Ledger &ledger);
+
+    /**
+     * Get the ordered index, so that writers can keep it up to date
+     *
+     * @return the ordered index or nullptr if it has not been created
+     * @note Only use it for scans if it is ready (see OrderedKeyIndex::is_ready)
+     */
+    OrderedKeyIndex *ordered_index() { return m_ordered_index; }
+
+    /**
+     * Number of (non-deleted) objects in this collection
+     */
+    size_t num_objects() const { return m_num_objects; }
+
+    void increment_object_count() { m_num_objects++; }
+
+    void decrement_object_count() { m_num_objects--; }
+
+    /**
+     * Number of objects in this collection that have their own policy
+     * Counts can only be answered from indexes if this is zero, because policies might hide objects.
+     */
+    size_t num_objects_with_policy() const { return m_num_objects_with_policy; }
+
+    void increment_policy_count() { m_num_objects_with_policy++; }
+
+    void decrement_policy_count() { m_num_objects_with_policy--; }
+
+    /**
+     * Are num_objects() and num_objects_with_policy() exact?
+     *
+     * Metadata written by older versions does not contain the counts
+     */
+    bool has_exact_counts() const { return m_exact_counts; }
+
+    /**
+     * @note The indexes stay valid even if they are dropped concurrently
+     */
+    std::unordered_map<std::string, std::shared_ptr<Index>> secondary_indexes();
+
+    /**
+     * Get a secondary index by name
+     *
+     * @return the index or nullptr if no such index exists
+     */
+    std::shared_ptr<Index> get_secondary_index(const std::string &name);
 
 private:
+    /// Metadata written by older versions starts with the number of secondary indexes instead
+    static constexpr size_t METADATA_MARKER = std::numeric_limits<size_t>::max();
+    static constexpr uint32_t METADATA_VERSION = 1;
+
+    void start_index_builder(const std::string &name, Enclave &enclave, Ledger &ledger);
+
     BufferManager &m_buffer_manager;
     const std::string m_name;
     HashMap *m_primary_index;
-    std::unordered_map<std::string, Index *> m_secondary_indexes;
+    std::atomic<OrderedKeyIndex *> m_ordered_index;
+    std::unordered_map<std::string, std::shared_ptr<Index>> m_secondary_indexes;
     std::unordered_set<remote_party_id> m_triggers;
+    std::atomic<size_t> m_num_objects;
+    std::atomic<size_t> m_num_objects_with_policy;
+    bool m_exact_counts = true;
     std::mutex m_mutex;
 };
 
@@ -0,0 +1,95 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "CommitTracker.h"
+
+namespace credb::trusted
+{
+
+commit_seq_t CommitTracker::start(const std::set<shard_id_t> &shards, const std::vector<std::pair<std::string, std::string>> &keys)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto seq = m_next_seq;
+    m_next_seq += 1;
+
+    for(auto &id : keys)
+    {
+        m_writers[id] = seq;
+    }
+
+    m_pending.emplace(seq, pending_commit_t{shards, keys});
+    return seq;
+}
+
+void CommitTracker::finish(commit_seq_t seq)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_pending.find(seq);
+
+    if(it == m_pending.end())
+    {
+        return;
+    }
+
+    for(auto &id : it->second.keys)
+    {
+        auto wit = m_writers.find(id);
+
+        // A later transaction might have written the object since
+        if(wit != m_writers.end() && wit->second == seq)
+        {
+            m_writers.erase(wit);
+        }
+    }
+
+    m_pending.erase(it);
+    m_condition.notify_all();
+}
+
+void CommitTracker::get_dependencies(const std::string &collection, const std::string &key, std::set<commit_seq_t> &out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_writers.find({collection, key});
+
+    if(it != m_writers.end())
+    {
+        out.insert(it->second);
+    }
+}
+
+void CommitTracker::get_dependencies(shard_id_t shard, std::set<commit_seq_t> &out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for(auto &[seq, pending] : m_pending)
+    {
+        if(pending.shards.find(shard) != pending.shards.end())
+        {
+            out.insert(seq);
+        }
+    }
+}
+
+void CommitTracker::wait(const std::set<commit_seq_t> &dependencies)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for(auto seq : dependencies)
+    {
+        while(m_pending.find(seq) != m_pending.end())
+        {
+            m_condition.wait(lock);
+        }
+    }
+}
+
+size_t CommitTracker::num_pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+} // namespace credb::trusted
@@ -0,0 +1,127 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "credb/event_id.h"
+#include "util/pair_hash.h"
+
+namespace credb::trusted
+{
+
+using commit_seq_t = uint64_t;
+constexpr commit_seq_t INVALID_COMMIT_SEQ = 0;
+
+/**
+ * Keeps track of transactions that released their locks before they finished committing
+ *
+ * A transaction gives up its locks as soon as its writes are applied and appended to the
+ * transaction ledger. The remainder of the commit (e.g. signing the witness) happens without locks.
+ * Transactions that lock an object written by such a transaction depend on it,
+ * and must not acknowledge their own commit before all their predecessors are done.
+ *
+ * Predecessors never wait for their successors, so this cannot deadlock.
+ */
+class CommitTracker
+{
+public:
+    /**
+     * A transaction is about to release its locks
+     *
+     * @param shards
+     *     The shards written to by the transaction
+     * @param keys
+     *     The objects written to by the transaction, identified by (collection, key)
+     * @return a sequence number identifying the transaction until finish() is called
+     */
+    commit_seq_t start(const std::set<shard_id_t> &shards, const std::vector<std::pair<std::string, std::string>> &keys);
+
+    /**
+     * The transaction identified by seq completed its commit
+     */
+    void finish(commit_seq_t seq);
+
+    /**
+     * Get the unfinished transaction (if any) that wrote to an object
+     */
+    void get_dependencies(const std::string &collection, const std::string &key, std::set<commit_seq_t> &out) const;
+
+    /**
+     * Get all unfinished transactions that wrote to a shard
+     */
+    void get_dependencies(shard_id_t shard, std::set<commit_seq_t> &out) const;
+
+    /**
+     * Block until all of the specified transactions have finished
+     */
+    void wait(const std::set<commit_seq_t> &dependencies);
+
+    /**
+     * The number of transactions that released their locks but did not finish yet
+     */
+    size_t num_pending() const;
+
+private:
+    struct pending_commit_t
+    {
+        std::set<shard_id_t> shards;
+        std::vector<std::pair<std::string, std::string>> keys;
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+
+    commit_seq_t m_next_seq = INVALID_COMMIT_SEQ + 1;
+
+    std::map<commit_seq_t, pending_commit_t> m_pending;
+
+    /// The most recent unfinished writer of each object
+    std::unordered_map<std::pair<std::string, std::string>, commit_seq_t, pair_hash> m_writers;
+};
+
+/**
+ * Finishes a commit once it goes out of scope
+ *
+ * Successors wait for the commit to finish, so this must also happen if the commit fails halfway.
+ */
+class CommitGuard
+{
+public:
+    CommitGuard(CommitTracker &tracker, commit_seq_t seq)
+        : m_tracker(tracker), m_seq(seq)
+    {
+    }
+
+    CommitGuard(const CommitGuard &other) = delete;
+
+    ~CommitGuard()
+    {
+        finish();
+    }
+
+    /**
+     * Finish the commit now (instead of on destruction)
+     */
+    void finish()
+    {
+        if(m_seq != INVALID_COMMIT_SEQ)
+        {
+            m_tracker.finish(m_seq);
+            m_seq = INVALID_COMMIT_SEQ;
+        }
+    }
+
+private:
+    CommitTracker &m_tracker;
+    commit_seq_t m_seq;
+};
+
+} // namespace credb::trusted
@@ -0,0 +1,129 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "ContentionManager.h"
+
+#ifdef FAKE_ENCLAVE
+#include "../server/FakeEnclave.h"
+#else
+#include "Enclave_t.h"
+#endif
+
+#include <algorithm>
+
+namespace credb::trusted
+{
+
+void ContentionManager::record_commit()
+{
+    m_num_commits += 1;
+}
+
+void ContentionManager::record_abort(bool conflict)
+{
+    m_num_aborts += 1;
+
+    if(conflict)
+    {
+        m_num_conflicts += 1;
+    }
+}
+
+void ContentionManager::record_conflict(shard_id_t shard, const std::string &collection, const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_shard_conflicts[shard] += 1;
+
+    for(auto &entry : m_hot_keys)
+    {
+        if(entry.key == key && entry.collection == collection)
+        {
+            entry.count += 1;
+            return;
+        }
+    }
+
+    if(m_hot_keys.size() < NUM_HOT_KEYS)
+    {
+        m_hot_keys.push_back({collection, key, 1, 0});
+        return;
+    }
+
+    // Replace the key with the fewest conflicts (it inherits its count)
+    auto &entry = *std::min_element(m_hot_keys.begin(), m_hot_keys.end(),
+                        [](const hot_key_t &a, const hot_key_t &b) { return a.count < b.count; });
+
+    entry.collection = collection;
+    entry.key = key;
+    entry.error = entry.count;
+    entry.count += 1;
+}
+
+void ContentionManager::record_conflict(shard_id_t shard)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_shard_conflicts[shard] += 1;
+}
+
+void ContentionManager::record_retry(uint32_t attempt)
+{
+    m_num_retries += 1;
+
+    if(attempt == NUM_OPTIMISTIC_ATTEMPTS)
+    {
+        m_num_escalations += 1;
+    }
+}
+
+void ContentionManager::backoff(uint32_t attempt)
+{
+    constexpr uint32_t BASE_MICROS = 10;
+    constexpr uint32_t MAX_SHIFT = 10;
+
+    sleep_for_micros(BASE_MICROS << std::min(attempt, MAX_SHIFT));
+}
+
+void ContentionManager::write(json::Writer &writer, const std::string &name) const
+{
+    const size_t num_commits = m_num_commits;
+    const size_t num_aborts = m_num_aborts;
+    const size_t num_finished = num_commits + num_aborts;
+
+    writer.start_map(name);
+    writer.write_integer("num_commits", num_commits);
+    writer.write_integer("num_aborts", num_aborts);
+    writer.write_integer("num_conflicts", m_num_conflicts.load());
+    writer.write_float("abort_rate", num_finished > 0 ? static_cast<double>(num_aborts) / static_cast<double>(num_finished) : 0.0);
+    writer.write_integer("num_retries", m_num_retries.load());
+    writer.write_integer("num_escalations", m_num_escalations.load());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    writer.start_map("shard_conflicts");
+    for(auto &[shard, count] : m_shard_conflicts)
+    {
+        writer.write_integer(std::to_string(shard), count);
+    }
+    writer.end_map();
+
+    auto hot_keys = m_hot_keys;
+    std::sort(hot_keys.begin(), hot_keys.end(),
+              [](const hot_key_t &a, const hot_key_t &b) { return a.count > b.count; });
+
+    writer.start_array("hot_keys");
+    for(auto &entry : hot_keys)
+    {
+        writer.start_map();
+        writer.write_string("collection", entry.collection);
+        writer.write_string("key", entry.key);
+        writer.write_integer("conflicts", entry.count);
+        writer.write_integer("error", entry.error);
+        writer.end_map();
+    }
+    writer.end_array();
+
+    writer.end_map();
+}
+
+} // namespace credb::trusted
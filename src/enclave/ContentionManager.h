@@ -0,0 +1,119 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include "credb/event_id.h"
+
+namespace credb::trusted
+{
+
+/**
+ * Thrown when a transaction of a program lost a conflict and the program should be run again
+ */
+class transaction_conflict_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Keeps track of why and where transactions abort and decides how conflicting programs are retried
+ *
+ * Programs that opted into server-side retries are run again with exponential backoff.
+ * After a few failed attempts they switch to pessimistic locking, so that they cannot lose again
+ * to optimistic transactions that touch the same keys.
+ */
+class ContentionManager
+{
+public:
+    /// Number of keys with the most conflicts that are tracked
+    static constexpr size_t NUM_HOT_KEYS = 16;
+
+    /// Number of attempts before a program uses pessimistic locking
+    static constexpr uint32_t NUM_OPTIMISTIC_ATTEMPTS = 3;
+
+    /// Number of attempts before a program gives up
+    static constexpr uint32_t MAX_ATTEMPTS = 6;
+
+    void record_commit();
+
+    /**
+     * @param conflict
+     *     Was the transaction aborted because of another transaction? (as opposed to e.g. a policy violation)
+     */
+    void record_abort(bool conflict);
+
+    /**
+     * Remember which object caused a conflict
+     */
+    void record_conflict(shard_id_t shard, const std::string &collection, const std::string &key);
+
+    /**
+     * Remember a conflict that can only be attributed to a shard (e.g. a range predicate)
+     */
+    void record_conflict(shard_id_t shard);
+
+    /**
+     * A program is run again
+     *
+     * @param attempt
+     *     The number of the upcoming attempt (starting at 1 for the first retry)
+     */
+    void record_retry(uint32_t attempt);
+
+    /**
+     * Should the specified attempt use pessimistic locking?
+     */
+    static bool is_pessimistic(uint32_t attempt)
+    {
+        return attempt >= NUM_OPTIMISTIC_ATTEMPTS;
+    }
+
+    /**
+     * Wait before the specified attempt
+     *
+     * The wait time doubles with each attempt.
+     * The thread sleeps outside of the enclave, so that others (e.g. the lock holder) can run.
+     */
+    static void backoff(uint32_t attempt);
+
+    void write(json::Writer &writer, const std::string &name) const;
+
+private:
+    struct hot_key_t
+    {
+        std::string collection;
+        std::string key;
+
+        /// Upper bound for the number of conflicts
+        size_t count;
+
+        /// How much count might overestimate the actual number
+        size_t error;
+    };
+
+    std::atomic<size_t> m_num_commits = 0;
+    std::atomic<size_t> m_num_aborts = 0;
+    std::atomic<size_t> m_num_conflicts = 0;
+    std::atomic<size_t> m_num_retries = 0;
+    std::atomic<size_t> m_num_escalations = 0;
+
+    mutable std::mutex m_mutex;
+
+    std::map<shard_id_t, size_t> m_shard_conflicts;
+
+    // Space-Saving summary of the keys with the most conflicts
+    std::vector<hot_key_t> m_hot_keys;
+};
+
+} // namespace credb::trusted
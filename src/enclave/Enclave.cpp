@@ -9,6 +9,7 @@
 #include <sgx_utils.h>
 
 #include "Ledger.h"
+#include "QueryCursor.h"
 #include "logging.h"
 #include "util/EncryptionType.h"
 #include "util/remote_attestation_result.h"
@@ -316,6 +317,21 @@ bool Enclave::load_everything(const std::string &filename)
     return ok;
 }
 
+bool Enclave::run_maintenance()
+{
+#ifndef IS_TEST
+    const auto now = QueryCursor::current_time();
+
+    if(now >= m_last_idle_sweep + IDLE_SWEEP_INTERVAL)
+    {
+        m_last_idle_sweep = now;
+        m_remote_parties.release_idle_resources();
+    }
+#endif
+
+    return m_task_manager.run_background_task();
+}
+
 #ifndef IS_TEST
 bool Enclave::set_trigger(const std::string &collection, remote_party_id identifier)
 {
@@ -479,6 +495,22 @@ void credb_set_upstream(remote_party_id upstream_id)
     credb::trusted::g_enclave->set_upstream(upstream_id);
 }
 
+/// Donate the calling thread to the enclave's worker pool (returns after credb_stop_workers)
+void credb_run_worker()
+{
+    credb::trusted::g_enclave->worker_pool().run_worker();
+}
+
+void credb_stop_workers()
+{
+    credb::trusted::g_enclave->worker_pool().stop();
+}
+
+bool credb_run_maintenance()
+{
+    return credb::trusted::g_enclave->run_maintenance();
+}
+
 void credb_peer_insert_response(remote_party_id peer_id, uint32_t op_id, const uint8_t *data, uint32_t length)
 {
 #ifdef IS_TEST
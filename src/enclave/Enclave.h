@@ -17,6 +17,7 @@
 #include "RemoteParties.h"
 #include "TaskManager.h"
 #include "TransactionManager.h"
+#include "WorkerPool.h"
 #include "util/IdentityDatabase.h"
 #include "util/status.h"
 #include "util/types.h"
@@ -70,6 +71,7 @@ public:
 
     BufferManager &buffer_manager() { return m_buffer_manager; }
     TaskManager &task_manager() { return m_task_manager; }
+    WorkerPool &worker_pool() { return m_worker_pool; }
     TransactionManager &transaction_manager() { return m_transaction_manager; }
     Ledger &ledger() { return m_ledger; }
     TransactionLedger &transaction_ledger() { return m_transaction_ledger; }
@@ -82,6 +84,15 @@ public:
     bool dump_everything(const std::string &filename); // for debug purpose
     bool load_everything(const std::string &filename); // for debug purpose
 
+    /**
+     * Do a slice of background work (e.g. index builds)
+     *
+     * Called periodically by a dedicated untrusted thread
+     *
+     * @return true if there is more work to do right away
+     */
+    bool run_maintenance();
+
     void set_upstream(remote_party_id upstream_id);
     bool is_downstream_mode() const;
     remote_party_id get_upstream_id() const { return m_upstream_id; }
@@ -98,6 +109,7 @@ public:
 private:
     std::unique_ptr<EncryptedIO> m_encrypted_io;
     TaskManager m_task_manager;
+    WorkerPool m_worker_pool;
     TransactionManager m_transaction_manager;
     BufferManager m_buffer_manager;
     Ledger m_ledger;
@@ -112,6 +124,10 @@ private:
 
     RemoteParties m_remote_parties;
 
+    /// How often (in milliseconds) run_maintenance looks for idle cursors and snapshots
+    static constexpr uint64_t IDLE_SWEEP_INTERVAL = 10 * 1000;
+    uint64_t m_last_idle_sweep = 0; // only accessed by the maintenance thread
+
     sgx_ec256_private_t m_private_key;
     sgx_ec256_public_t m_upstream_public_key;
 
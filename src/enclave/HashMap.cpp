@@ -2,6 +2,10 @@
 /// This file is part of the CreDB Project. See LICENSE for more information.
 
 #include "HashMap.h"
+
+#include <algorithm>
+#include <set>
+
 #include "logging.h"
 #include "util/get_heap_size_of.h"
 
@@ -24,48 +28,116 @@ inline PageHandle<HashMap::node_t> duplicate(PageHandle<HashMap::node_t> &hdl)
 
 
 HashMap::LinearScanKeyProvider::LinearScanKeyProvider(HashMap &index)
-    : m_iterator(index, 0)
+    : LinearScanKeyProvider(index, 0, NUM_BUCKETS)
+{
+}
+
+HashMap::LinearScanKeyProvider::LinearScanKeyProvider(HashMap &index, bucketid_t begin_bucket, size_t end_bucket)
+    : m_index(index), m_end_bucket(end_bucket), m_iterator(new iterator_t(index, begin_bucket, end_bucket)),
+      m_next_bucket(end_bucket)
 {
 }
 
 bool HashMap::LinearScanKeyProvider::get_next_key(KeyType &key)
 {
-    if(m_iterator.at_end())
+    if(!m_pending_keys.empty())
+    {
+        key = std::move(m_pending_keys.front());
+        m_pending_keys.pop_front();
+        return true;
+    }
+
+    if(!m_iterator)
+    {
+        if(m_next_bucket >= m_end_bucket)
+        {
+            return false;
+        }
+
+        m_iterator.reset(new iterator_t(m_index, static_cast<bucketid_t>(m_next_bucket), m_end_bucket));
+    }
+
+    if(m_iterator->at_end())
     {
         return false;
     }
     
-    key = m_iterator.key();
-    ++m_iterator;
+    key = m_iterator->key();
+    ++(*m_iterator);
 
     return true;
 }
 
+void HashMap::LinearScanKeyProvider::suspend()
+{
+    if(!m_iterator)
+    {
+        return;
+    }
+
+    if(m_iterator->at_end())
+    {
+        m_next_bucket = m_end_bucket;
+    }
+    else
+    {
+        const auto bucket = m_iterator->bucket();
+
+        while(!m_iterator->at_end() && m_iterator->bucket() == bucket)
+        {
+            m_pending_keys.push_back(m_iterator->key());
+            ++(*m_iterator);
+        }
+
+        m_next_bucket = bucket + 1;
+    }
+
+    m_iterator.reset();
+}
+
 size_t HashMap::LinearScanKeyProvider::count_rest()
 {
-    auto it2 = m_iterator.duplicate();
-    size_t cnt = 0;
-    
-    while(!it2.at_end())
+    size_t cnt = m_pending_keys.size();
+
+    if(m_iterator)
     {
-        ++cnt;
-        ++it2;
+        auto it2 = m_iterator->duplicate();
+
+        while(!it2.at_end())
+        {
+            ++cnt;
+            ++it2;
+        }
+    }
+    else if(m_next_bucket < m_end_bucket)
+    {
+        iterator_t it2(m_index, static_cast<bucketid_t>(m_next_bucket), m_end_bucket);
+
+        while(!it2.at_end())
+        {
+            ++cnt;
+            ++it2;
+        }
     }
 
     return cnt;
 }
 
-HashMap::iterator_t::iterator_t(HashMap &map, bucketid_t bpos)
-    : m_map(map), m_shard_id(NUM_SHARDS), m_bucket(bpos), m_pos(0)
+HashMap::iterator_t::iterator_t(HashMap &map, bucketid_t bpos, size_t end_bucket)
+    : m_map(map), m_shard_id(NUM_SHARDS), m_bucket(bpos), m_end_bucket(std::min(end_bucket, NUM_BUCKETS)), m_pos(0)
 {
-    if(bpos < NUM_BUCKETS)
+    if(bpos < m_end_bucket)
     {
         next_bucket();
     }
+    else
+    {
+        m_bucket = NUM_BUCKETS;
+    }
 }
 
-HashMap::iterator_t::iterator_t(HashMap &map, bucketid_t bpos, std::vector<PageHandle<node_t>> &current_nodes, uint32_t pos)
-    : m_map(map), m_shard_id(bpos % NUM_SHARDS), m_bucket(bpos), m_pos(pos)
+HashMap::iterator_t::iterator_t(HashMap &map, bucketid_t bpos, size_t end_bucket, std::vector<PageHandle<node_t>> &current_nodes, uint32_t pos)
+    : m_map(map), m_shard_id(bpos % NUM_SHARDS), m_bucket(bpos), m_end_bucket(end_bucket), m_pos(pos)
 {
     m_shard_lock = ReadLock(m_map.get_shard(m_bucket).mutex);
 
@@ -81,7 +153,7 @@ bool HashMap::iterator_t::at_end() const { return m_bucket >= NUM_BUCKETS; }
 
 HashMap::iterator_t HashMap::iterator_t::duplicate()
 {
-    return HashMap::iterator_t(m_map, m_bucket, m_current_nodes, m_pos);
+    return HashMap::iterator_t(m_map, m_bucket, m_end_bucket, m_current_nodes, m_pos);
 }
 
 void HashMap::iterator_t::clear()
@@ -116,7 +188,7 @@ void HashMap::iterator_t::set_value(const ValueType &new_value, bitstream *out_c
 
     if(out_changes)
     {
-        *out_changes << m_bucket << bucket;
+        m_map.write_changes(*out_changes, m_bucket);
     }
 
     m_shard_lock.lockable().write_to_read_lock();
@@ -194,7 +266,7 @@ bool HashMap::iterator_t::operator==(const iterator_t &other) const
 
 void HashMap::iterator_t::next_bucket()
 {
-    while(m_bucket < NUM_BUCKETS)
+    while(m_bucket < m_end_bucket)
     {
         m_current_nodes.clear();
         auto shard = m_bucket % HashMap::NUM_SHARDS;
@@ -221,15 +293,140 @@ void HashMap::iterator_t::next_bucket()
     }
 
     // at end
-    if(m_bucket == NUM_BUCKETS)
+    if(m_bucket >= m_end_bucket)
     {
         clear();
     }
 }
 
 HashMap::HashMap(BufferManager &buffer, const std::string &name)
-    : AbstractMap(buffer, name)
+    : AbstractMap(buffer, name), m_filter_negatives(0), m_filter_false_positives(0)
+{
+    for(auto &filter : m_filters)
+    {
+        filter.bits.assign(FILTER_MIN_BITS / 64, 0);
+        filter.num_keys = 0;
+    }
+}
+
+void HashMap::load_root(bitstream &in)
 {
+    AbstractMap::load_root(in);
+
+    const bool rebuild = has_filters();
+
+    for(bucketid_t bid = 0; bid < NUM_BUCKETS; ++bid)
+    {
+        WriteLock lock(get_shard(bid).mutex);
+
+        if(rebuild)
+        {
+            rebuild_filter(bid, FILTER_MIN_BITS, lock);
+        }
+        else
+        {
+            m_filters[bid].bits.assign(FILTER_MIN_BITS / 64, 0);
+            m_filters[bid].num_keys = 0;
+        }
+    }
+}
+
+bool HashMap::set_filter_bits(filter_t &filter, const KeyType &key)
+{
+    const size_t num_bits = filter.bits.size() * 64;
+    auto h1 = hash<KeyType>(key);
+    auto h2 = hash<hashval_t>(h1) | 1;
+    bool changed = false;
+
+    for(size_t i = 0; i < FILTER_NUM_HASHES; ++i)
+    {
+        auto bit = (h1 + i * h2) % num_bits;
+        auto &word = filter.bits[bit / 64];
+        const auto mask = uint64_t{1} << (bit % 64);
+
+        changed = changed || !(word & mask);
+        word |= mask;
+    }
+
+    return changed;
+}
+
+void HashMap::rebuild_filter(bucketid_t bid, size_t num_bits, RWHandle &shard_lock)
+{
+    auto &filter = m_filters[bid];
+    filter.bits.assign(num_bits / 64, 0);
+    filter.num_keys = 0;
+
+    auto node = get_node(bid, false, shard_lock);
+
+    while(node)
+    {
+        for(size_t pos = 0; pos < node->size(); ++pos)
+        {
+            set_filter_bits(filter, node->get(pos).first);
+            filter.num_keys += 1;
+        }
+
+        node = get_successor(bid, node, false, shard_lock);
+    }
+
+    // The filter might be too small for the bucket's current content
+    if(filter.num_keys * FILTER_BITS_PER_KEY > num_bits)
+    {
+        rebuild_filter(bid, num_bits * 2, shard_lock);
+    }
+}
+
+void HashMap::add_to_filter(bucketid_t bid, const KeyType &key, RWHandle &shard_lock)
+{
+    if(!has_filters())
+    {
+        return;
+    }
+
+    auto &filter = m_filters[bid];
+
+    // Updates of existing keys don't set new bits (except for false positives)
+    if(!set_filter_bits(filter, key))
+    {
+        return;
+    }
+
+    filter.num_keys += 1;
+
+    const size_t num_bits = filter.bits.size() * 64;
+
+    if(filter.num_keys * FILTER_BITS_PER_KEY > num_bits)
+    {
+        // Bits cannot be moved to a larger filter, so rebuild it from the nodes
+        rebuild_filter(bid, num_bits * 2, shard_lock);
+    }
+}
+
+bool HashMap::filter_might_contain(bucketid_t bid, const KeyType &key)
+{
+    if(!has_filters())
+    {
+        return true;
+    }
+
+    auto &filter = m_filters[bid];
+    const size_t num_bits = filter.bits.size() * 64;
+    auto h1 = hash<KeyType>(key);
+    auto h2 = hash<hashval_t>(h1) | 1;
+
+    for(size_t i = 0; i < FILTER_NUM_HASHES; ++i)
+    {
+        auto bit = (h1 + i * h2) % num_bits;
+
+        if(!(filter.bits[bit / 64] & (uint64_t{1} << (bit % 64))))
+        {
+            m_filter_negatives += 1;
+            return false;
+        }
+    }
+
+    return true;
 }
 
 HashMap::~HashMap() = default;
@@ -238,13 +435,12 @@ HashMap::iterator_t HashMap::begin() { return { *this, 0 }; }
 
 HashMap::iterator_t HashMap::end() { return { *this, NUM_BUCKETS }; }
 
-void HashMap::insert(const KeyType &key, const ValueType &value, bitstream *out_changes)
+void HashMap::insert(const KeyType &key, const ValueType &value, bitstream *out_changes, bool flush)
 {
     auto bid = to_bucket(key);
     auto &s = get_shard(bid);
 
     WriteLock lock(s.mutex);
-    auto &bucket = get_bucket(bid);
 
     auto node = get_node(bid, true, lock);
     bool done = false;
@@ -261,17 +457,44 @@ void HashMap::insert(const KeyType &key, const ValueType &value, bitstream *out_
             node = get_successor(bid, node, true, lock);
         }
 
-        node->flush_page();
+        if(flush)
+        {
+            node->flush_page();
+        }
     }
 
+    add_to_filter(bid, key, lock);
+
     if(out_changes)
     {
-        *out_changes << bid << bucket;
+        write_changes(*out_changes, bid);
     }
 
     m_size += 1;
 }
 
+void HashMap::flush_buckets(const std::vector<KeyType> &keys)
+{
+    std::set<bucketid_t> buckets;
+
+    for(auto &key : keys)
+    {
+        buckets.insert(to_bucket(key));
+    }
+
+    for(auto bid : buckets)
+    {
+        ReadLock lock(get_shard(bid).mutex);
+        auto node = get_node(bid, false, lock);
+
+        while(node)
+        {
+            node->flush_page();
+            node = get_successor(bid, node, false, lock);
+        }
+    }
+}
+
 bool HashMap::get(const KeyType& key, ValueType &value_out)
 {
     auto bid = to_bucket(key);
@@ -279,6 +502,11 @@ bool HashMap::get(const KeyType& key, ValueType &value_out)
     
     ReadLock lock(s.mutex);
 
+    if(!filter_might_contain(bid, key))
+    {
+        return false;
+    }
+
     auto node = get_node(bid, false, lock);
 
     std::vector<page_no_t> parents;
@@ -293,6 +521,7 @@ bool HashMap::get(const KeyType& key, ValueType &value_out)
         node = get_successor(bid, node, false, lock);
     }
 
+    m_filter_false_positives += 1;
     return false;
 }
 
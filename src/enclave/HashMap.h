@@ -7,7 +7,10 @@
 #include <bitstream.h>
 #include <tuple>
 #include <array>
+#include <deque>
+#include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "ObjectListIterator.h"
 #include "HashMapNode.h"
@@ -30,7 +33,11 @@ public:
     class iterator_t
     {
     public:
-        iterator_t(HashMap &map, bucketid_t bpos);
+        /**
+         * @param end_bucket
+         *      Stop iterating once this bucket is reached (exclusive bound)
+         */
+        iterator_t(HashMap &map, bucketid_t bpos, size_t end_bucket = NUM_BUCKETS);
         iterator_t(const iterator_t &other) = delete;
         ~iterator_t();
 
@@ -39,6 +46,10 @@ public:
         void clear();
         bool at_end() const;
         void operator++();
+
+        /// The bucket the iterator currently points to
+        bucketid_t bucket() const { return m_bucket; }
+
         KeyType   key() const;
         ValueType value() const;
         bool operator!=(const iterator_t &other) const;
@@ -47,7 +58,7 @@ public:
         void set_value(const ValueType &new_value, bitstream *out_changes = nullptr);
 
     private:
-        iterator_t(HashMap &map, bucketid_t bpos, std::vector<PageHandle<node_t>> &current_nodes, uint32_t pos);
+        iterator_t(HashMap &map, bucketid_t bpos, size_t end_bucket, std::vector<PageHandle<node_t>> &current_nodes, uint32_t pos);
 
         friend class HashMap;
 
@@ -59,6 +70,7 @@ public:
         RWHandle m_shard_lock;
 
         bucketid_t m_bucket;
+        const size_t m_end_bucket;
 
         std::vector<PageHandle<node_t>> m_current_nodes;
         uint32_t m_pos;
@@ -68,28 +80,160 @@ public:
     {
     public:
         LinearScanKeyProvider(HashMap &index);
+
+        /**
+         * Only scan the keys in buckets [begin_bucket, end_bucket)
+         *
+         * This allows splitting a scan into disjoint parts
+         */
+        LinearScanKeyProvider(HashMap &index, bucketid_t begin_bucket, size_t end_bucket);
         LinearScanKeyProvider(const ObjectListIterator &other) = delete;
         LinearScanKeyProvider(ObjectListIterator &&other) = delete;
 
         bool get_next_key(KeyType &key) override;
         size_t count_rest() override;
 
+        /**
+         * Copies the remaining keys of the current bucket and releases the iterator
+         *
+         * The scan resumes at the next bucket once these keys have been returned
+         */
+        void suspend() override;
+
     private:
-        HashMap::iterator_t m_iterator;
+        HashMap &m_index;
+        const size_t m_end_bucket;
+
+        /// Not set while suspended
+        std::unique_ptr<HashMap::iterator_t> m_iterator;
+
+        /// Keys of the bucket that was being scanned when the provider got suspended
+        std::deque<KeyType> m_pending_keys;
+        size_t m_next_bucket;
     };
 
+    /// Initial size (in bits) of the Bloom filter kept for every bucket
+    static constexpr size_t FILTER_MIN_BITS = 256;
+
+    /**
+     * A bucket's Bloom filter is doubled in size once it holds fewer bits than this per key
+     *
+     * With three hashes this keeps the false-positive rate at around 2% however many keys a bucket holds
+     */
+    static constexpr size_t FILTER_BITS_PER_KEY = 10;
+
+    /// Number of bits set per key in a bucket's Bloom filter
+    static constexpr size_t FILTER_NUM_HASHES = 3;
+
     HashMap(BufferManager &buffer, const std::string &name);
     ~HashMap();
 
+    /**
+     * Load the root and rebuild the Bloom filters from the nodes
+     *
+     * The filters only live in memory and are not part of the root, so its format stays the same.
+     * Roots are only loaded by downstream servers when connecting to upstream (see Enclave),
+     * which never use filters, so no nodes are read there. A primary index that starts from
+     * scratch (e.g. after a restart) has no buckets and, thus, empty filters.
+     */
+    void load_root(bitstream &in) override;
+
+    /**
+     * Size (in bits) of a bucket's Bloom filter
+     */
+    size_t filter_size(bucketid_t bid) const
+    {
+        return m_filters[bid].bits.size() * 64;
+    }
+
+    /**
+     * Number of lookups that were answered by a bucket's Bloom filter without loading any node
+     */
+    size_t num_filter_negatives() const
+    {
+        return m_filter_negatives;
+    }
+
+    /**
+     * Number of lookups that passed the Bloom filter but did not find the key
+     */
+    size_t num_filter_false_positives() const
+    {
+        return m_filter_false_positives;
+    }
+
     iterator_t begin();
     iterator_t end();
 
-    void insert(const KeyType &key, const ValueType &value, bitstream *out_changes = nullptr);
+    /**
+     * @param flush
+     *      Write modified nodes to disk right away. Bulk loads unset this and call flush_buckets() once they are done.
+     */
+    void insert(const KeyType &key, const ValueType &value, bitstream *out_changes = nullptr, bool flush = true);
+
+    /**
+     * Write the (modified) nodes of the buckets holding the given keys to disk
+     */
+    void flush_buckets(const std::vector<KeyType> &keys);
     
     bool get(const KeyType& key, ValueType &value_out);
 
 private:
     friend class iterator_t;
+
+    struct filter_t
+    {
+        std::vector<uint64_t> bits;
+
+        /// Number of keys that set at least one new bit
+        size_t num_keys;
+    };
+
+    /**
+     * Downstream servers receive bucket updates from upstream, which don't include the filters.
+     * They always look at the nodes instead.
+     */
+    bool has_filters()
+    {
+        return !buffer_manager().get_encrypted_io().is_remote();
+    }
+
+    /**
+     * Mark the key as present in its bucket's Bloom filter
+     *
+     * Grows the filter when it gets too full for the number of keys in the bucket
+     *
+     * @note you must hold a write lock to the bucket's shard
+     */
+    void add_to_filter(bucketid_t bid, const KeyType &key, RWHandle &shard_lock);
+
+    /**
+     * Set the bits of a key without checking the size of the filter
+     *
+     * @return true if at least one bit was not set before
+     */
+    bool set_filter_bits(filter_t &filter, const KeyType &key);
+
+    /**
+     * Recreate the Bloom filter of a bucket with the given size from its nodes
+     *
+     * @note you must hold a write lock to the bucket's shard
+     */
+    void rebuild_filter(bucketid_t bid, size_t num_bits, RWHandle &shard_lock);
+
+    /**
+     * Check the Bloom filter of a bucket
+     *
+     * @return false if the key is definitely not stored in the bucket
+     * @note you must hold at least a read lock to the bucket's shard
+     */
+    bool filter_might_contain(bucketid_t bid, const KeyType &key);
+
+    /// One Bloom filter per bucket so that misses don't need to load any nodes
+    std::array<filter_t, NUM_BUCKETS> m_filters;
+
+    std::atomic<size_t> m_filter_negatives;
+    std::atomic<size_t> m_filter_false_positives;
 };
 
 
@@ -2,12 +2,55 @@
 /// This file is part of the CreDB Project. See LICENSE for more information.
 
 #include "Index.h"
+#include "predicates.h"
+
+#include <algorithm>
+#include <set>
 
 namespace credb::trusted
 {
 
-Index::Index(std::string name, std::vector<std::string> paths)
-    : m_name(std::move(name)), m_paths(std::move(paths))
+/**
+ * Compute the hash that an index entry with the specified value would have
+ * (used to handle $in)
+ */
+inline int64_t hash_in_value(const std::string &path, const json::Document &value)
+{
+    bitstream bstream;
+    json::Writer writer(bstream);
+    writer.start_map("");
+    writer.write_document(path, value);
+    writer.end_map();
+
+    json::Document doc(bstream.data(), bstream.size(), json::DocumentMode::ReadOnly);
+    return doc.hash();
+}
+
+/**
+ * Compute the paths stored by a covering index
+ */
+inline std::vector<std::string> get_covered_paths(const std::vector<std::string> &paths, const std::vector<std::string> &include)
+{
+    if(include.empty())
+    {
+        return {};
+    }
+
+    std::vector<std::string> result = paths;
+
+    for(auto &path : include)
+    {
+        if(std::find(result.begin(), result.end(), path) == result.end())
+        {
+            result.push_back(path);
+        }
+    }
+
+    return result;
+}
+
+Index::Index(std::string name, std::vector<std::string> paths, std::vector<std::string> include)
+    : m_name(std::move(name)), m_paths(std::move(paths)), m_covered_paths(get_covered_paths(m_paths, include)), m_build_progress(1.0)
 {
 }
 
@@ -20,8 +63,24 @@ const std::vector<std::string> &Index::paths() const
 
 const std::string &Index::name() const { return m_name; }
 
-HashIndex::HashIndex(BufferManager &buffer, const std::string &name, const std::vector<std::string> &paths)
-: Index(name, paths), m_map(buffer, name)
+bool Index::covers(const std::string &path) const
+{
+    for(auto &covered : m_covered_paths)
+    {
+        if(path == covered || (path.size() > covered.size() && path.compare(0, covered.size(), covered) == 0 && path[covered.size()] == '.'))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+HashIndex::HashIndex(BufferManager &buffer,
+                     const std::string &name,
+                     const std::vector<std::string> &paths,
+                     const std::vector<std::string> &include)
+: Index(name, paths, include), m_map(buffer, name), m_multikey(false)
 {
     if(paths.size() != 1)
     {
@@ -33,16 +92,27 @@ HashIndex::~HashIndex() = default;
 
 void HashIndex::dump_metadata(bitstream &output)
 {
-    output << m_name << m_paths;
+    output << m_name << m_paths << m_covered_paths << m_multikey.load();
 }
 
-HashIndex *HashIndex::new_from_metadata(BufferManager &buffer, bitstream &input)
+HashIndex *HashIndex::new_from_metadata(BufferManager &buffer, bitstream &input, uint32_t version)
 {
     std::string name, prefix;
-    std::vector<std::string> paths;
+    std::vector<std::string> paths, include;
+    bool multikey = false;
     input >> name >> paths;
-    auto index = new HashIndex(buffer, name, paths);
+
+    if(version > 0)
+    {
+        input >> include >> multikey;
+    }
+
+    auto index = new HashIndex(buffer, name, paths, include);
+    index->m_multikey = multikey;
     //index->m_map.load_metadata(input);
+
+    // Neither the entries nor the statistics are persisted (see IndexBuilder)
+    index->m_statistics.set_valid(false);
     return index;
 }
 
@@ -69,7 +139,7 @@ bool HashIndex::matches_query(const json::Document &predicate) const
                         // the same format.
                         //                  some mechanism to speed up? e.g. pre-compiling
                         //                  predicate?
-                        if(key != "$in")
+                        if(key != "$in" && key != CONTAINS_OPERATOR)
                         {
                             return false;
                         }
@@ -85,12 +155,100 @@ bool HashIndex::matches_query(const json::Document &predicate) const
     }
 }
 
-bool HashIndex::insert(const json::Document &document, const std::string &key)
+std::string HashIndex::encode_entry(const json::Document &document, const std::string &key, const event_id_t &eid) const
+{
+    if(!is_covering())
+    {
+        return key;
+    }
+
+    const bool has_policy = !json::Document(document, "policy", false).empty();
+    json::Document stored(document, covered_paths());
+
+    bitstream bstream;
+    bstream << key << eid << has_policy << stored;
+
+    return std::string(reinterpret_cast<const char*>(bstream.data()), bstream.size());
+}
+
+IndexEntry HashIndex::decode_entry(const std::string &value) const
+{
+    bitstream bstream;
+    bstream.assign(reinterpret_cast<const uint8_t*>(value.data()), value.size(), true);
+
+    std::string key;
+    event_id_t eid;
+    bool has_policy;
+    json::Document stored("");
+
+    bstream >> key >> eid >> has_policy >> stored;
+
+    // Don't reference the map's memory
+    return IndexEntry{std::move(key), eid, has_policy, stored.duplicate()};
+}
+
+std::string HashIndex::decode_key(const std::string &value) const
+{
+    if(!is_covering())
+    {
+        return value;
+    }
+
+    bitstream bstream;
+    bstream.assign(reinterpret_cast<const uint8_t*>(value.data()), value.size(), true);
+
+    std::string key;
+    bstream >> key;
+    return key;
+}
+
+std::vector<int64_t> HashIndex::get_hashes(const json::Document &document) const
+{
+    json::Document view(document, paths(), true);
+    std::vector<int64_t> result = { view.hash() };
+
+    const std::string &vkey = paths()[0];
+    json::Document value(document, vkey);
+
+    if(value.get_type() == json::ObjectType::Array)
+    {
+        for(uint32_t i = 0; i < value.get_size(); ++i)
+        {
+            auto hash = hash_in_value(vkey, json::Document(value, std::to_string(i)));
+
+            if(std::find(result.begin(), result.end(), hash) == result.end())
+            {
+                result.push_back(hash);
+            }
+        }
+    }
+
+    return result;
+}
+
+bool HashIndex::insert(const json::Document &document, const std::string &key, const event_id_t &eid)
 {
     try
     {
-        json::Document view(document, paths(), true);
-        m_map.insert(view.hash(), key);
+        auto entry = encode_entry(document, key, eid);
+        auto hashes = get_hashes(document);
+
+        if(hashes.size() > 1)
+        {
+            m_multikey = true;
+        }
+
+        // Writers and the IndexBuilder might both insert the same entry while the index is being built
+        const bool check_duplicates = !is_ready();
+
+        for(auto value : hashes)
+        {
+            if(m_map.insert(value, entry, check_duplicates))
+            {
+                m_statistics.insert(value);
+            }
+        }
+
         return true;
     }
     catch(json_error &e)
@@ -99,14 +257,46 @@ bool HashIndex::insert(const json::Document &document, const std::string &key)
     }
 }
 
-void HashIndex::clear() { m_map.clear(); }
+void HashIndex::clear()
+{
+    m_map.clear();
+    m_statistics.clear();
+}
 
 bool HashIndex::remove(const json::Document &document, const std::string &key)
 {
     try
     {
-        json::Document view(document, paths(), true);
-        return m_map.remove(view.hash(), key);
+        bool removed = false;
+
+        for(auto value : get_hashes(document))
+        {
+            if(!is_covering())
+            {
+                if(m_map.remove(value, key))
+                {
+                    m_statistics.remove(value);
+                    removed = true;
+                }
+
+                continue;
+            }
+
+            // The entry also contains the stored values, which might be different from the document
+            std::unordered_set<std::string> entries;
+            m_map.find(value, entries, SetOperation::Union);
+
+            for(auto &entry : entries)
+            {
+                if(decode_key(entry) == key && m_map.remove(value, entry))
+                {
+                    m_statistics.remove(value);
+                    removed = true;
+                }
+            }
+        }
+
+        return removed;
     }
     catch(json_error &)
     {
@@ -115,7 +305,61 @@ bool HashIndex::remove(const json::Document &document, const std::string &key)
 }
 
 void HashIndex::find(const json::Document &predicate, std::unordered_set<std::string> &out, SetOperation op)
-{   
+{
+    if(!is_covering())
+    {
+        find_values(predicate, out, op);
+        return;
+    }
+
+    std::unordered_set<std::string> entries;
+    find_values(predicate, entries, SetOperation::Union);
+
+    std::unordered_set<std::string> keys;
+
+    for(auto &entry : entries)
+    {
+        keys.insert(decode_key(entry));
+    }
+
+    if(op == SetOperation::Union)
+    {
+        out.insert(keys.begin(), keys.end());
+    }
+    else
+    {
+        for(auto it = out.begin(); it != out.end();)
+        {
+            if(!keys.count(*it))
+            {
+                it = out.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
+
+void HashIndex::find_entries(const json::Document &predicate, std::vector<IndexEntry> &out)
+{
+    if(!is_covering())
+    {
+        throw std::runtime_error("Index " + name() + " is not covering");
+    }
+
+    std::unordered_set<std::string> entries;
+    find_values(predicate, entries, SetOperation::Union);
+
+    for(auto &entry : entries)
+    {
+        out.emplace_back(decode_entry(entry));
+    }
+}
+
+void HashIndex::find_values(const json::Document &predicate, std::unordered_set<std::string> &out, SetOperation op)
+{
     if(paths().size() != 1)
     {
         log_fatal("Invalid state: need exactly one path");
@@ -123,7 +367,14 @@ void HashIndex::find(const json::Document &predicate, std::unordered_set<std::st
 
     const std::string &vkey = paths()[0];
     json::Document in(predicate, vkey + ".$in");
-    if(in.empty())
+    json::Document element(predicate, vkey + "." + CONTAINS_OPERATOR);
+
+    if(!element.empty())
+    {
+        // array elements have their own entries
+        m_map.find(hash_in_value(vkey, element), out, op);
+    }
+    else if(in.empty())
     {
         // only equality test
         m_map.find(predicate.hash(), out, op);
@@ -142,15 +393,7 @@ void HashIndex::find(const json::Document &predicate, std::unordered_set<std::st
         for(uint32_t i = 0; i < in.get_size(); ++i)
         {
             json::Document view2(in, to_string(i));
-
-            bitstream bstream;
-            json::Writer writer(bstream);
-            writer.start_map("");
-            writer.write_document(vkey, view2);
-            writer.end_map();
-
-            json::Document doc(bstream.data(), bstream.size(), json::DocumentMode::ReadOnly);
-            m_map.find(doc.hash(), *set, SetOperation::Union); // union first
+            m_map.find(hash_in_value(vkey, view2), *set, SetOperation::Union); // union first
         }
 
         if(op == SetOperation::Intersect)
@@ -181,22 +424,90 @@ size_t HashIndex::estimate_value_count(const json::Document &predicate)
 
     const std::string &vkey = paths()[0];
     json::Document in(predicate, vkey + ".$in");
-    if(in.empty())
+    json::Document element(predicate, vkey + "." + CONTAINS_OPERATOR);
+
+    if(!element.empty())
+    {
+        return m_statistics.estimate_count(hash_in_value(vkey, element));
+    }
+    else if(in.empty())
     {
         // only equality test
-        return m_map.estimate_value_count(predicate.hash());
+        return m_statistics.estimate_count(predicate.hash());
     }
     else
     {
-        // $in operator support
-        // because $in with SetOperation::Intersect will fetch the whole value set anyway,
-        // the heuristic here is that returning the smallest number,
-        // making sure this hash index is (highly probably) the first one to evaluate,
-        // thus $in will be (highly probably) with SetOperation::Union.
-        // this heuristic will not reduce time costs, but will avoid one times extra space.
-        return 0;
+        // $in operator support: sum up the estimates for all values
+        if(in.get_type() != json::ObjectType::Array)
+        {
+            throw std::runtime_error("$in operand is not an array");
+        }
+
+        size_t count = 0;
+
+        for(uint32_t i = 0; i < in.get_size(); ++i)
+        {
+            json::Document view2(in, to_string(i));
+            count += m_statistics.estimate_count(hash_in_value(vkey, view2));
+        }
+
+        return count;
     }
 }
 
+bool HashIndex::count(const json::Document &predicate, size_t &out)
+{
+    if(paths().size() != 1)
+    {
+        log_fatal("Invalid state");
+    }
+
+    // Note: the number of map entries with a hash is exact (see MultiMapNode::estimate_value_count)
+    const std::string &vkey = paths()[0];
+    json::Document in(predicate, vkey + ".$in");
+    json::Document element(predicate, vkey + "." + CONTAINS_OPERATOR);
+
+    if(!element.empty())
+    {
+        // there is exactly one entry for every object that is or contains the element
+        out = m_map.estimate_value_count(hash_in_value(vkey, element));
+        return true;
+    }
+
+    if(m_multikey)
+    {
+        // equality lookups would also count arrays containing the value
+        return false;
+    }
+
+    if(in.empty())
+    {
+        out = m_map.estimate_value_count(predicate.hash());
+        return true;
+    }
+
+    if(in.get_type() != json::ObjectType::Array)
+    {
+        throw std::runtime_error("$in operand is not an array");
+    }
+
+    // Don't count objects twice if a value is listed more than once
+    std::set<int64_t> hashes;
+
+    for(uint32_t i = 0; i < in.get_size(); ++i)
+    {
+        json::Document view2(in, to_string(i));
+        hashes.insert(hash_in_value(vkey, view2));
+    }
+
+    out = 0;
+
+    for(auto hash : hashes)
+    {
+        out += m_map.estimate_value_count(hash);
+    }
+
+    return true;
+}
 
 } // namespace credb::trusted
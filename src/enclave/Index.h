@@ -4,9 +4,12 @@
 #pragma once
 
 #include "BufferManager.h"
+#include "IndexStatistics.h"
 #include "MultiMap.h"
 #include "util/defines.h"
+#include "credb/event_id.h"
 #include <json/json.h>
+#include <atomic>
 #include <unordered_set>
 
 namespace credb::trusted
@@ -14,16 +17,80 @@ namespace credb::trusted
 
 class Enclave;
 
+/// An entry of a covering index
+struct IndexEntry
+{
+    std::string key;
+
+    /// Identifier of the version the stored value belongs to
+    event_id_t eid;
+
+    /// The object has its own policy that must be checked before returning its value
+    bool has_policy;
+
+    /// Projection of the object on all covered paths
+    json::Document value;
+};
+
 /// Generic index interface
 class Index
 {
 public:
-    Index(std::string name, std::vector<std::string> paths);
+    /**
+     * @param include
+     *      Additional paths whose values are stored in the index alongside the key (see is_covering)
+     */
+    Index(std::string name, std::vector<std::string> paths, std::vector<std::string> include = {});
     virtual ~Index();
 
     const std::vector<std::string> &paths() const;
     const std::string &name() const;
 
+    /**
+     * Paths whose values are stored in the index entries
+     * This is empty for regular indexes and paths() + included paths for covering indexes
+     */
+    const std::vector<std::string> &covered_paths() const { return m_covered_paths; }
+
+    /**
+     * A covering index stores the values of all covered paths.
+     * Queries that only need these paths can be answered without reading the ledger.
+     */
+    bool is_covering() const { return !m_covered_paths.empty(); }
+
+    /**
+     * Is the value at the specified path (or all of its children) stored in the index?
+     */
+    bool covers(const std::string &path) const;
+
+    /**
+     * Fraction of the collection that has been added to the index so far
+     *
+     * Indexes that are still being built (see IndexBuilder) are kept up to date by writers
+     * but must not be used to answer queries
+     */
+    double build_progress() const { return m_build_progress; }
+
+    void set_build_progress(double progress) { m_build_progress = progress; }
+
+    /**
+     * Mark the index as fully populated
+     *
+     * The index was built from scratch, so its statistics are complete as well
+     */
+    void finish_build()
+    {
+        m_statistics.set_valid(true);
+        m_build_progress = 1.0;
+    }
+
+    bool is_ready() const { return m_build_progress >= 1.0; }
+
+    /**
+     * Statistics about the values stored in this index
+     */
+    const IndexStatistics &statistics() const { return m_statistics; }
+
     /**
      * Check if two documents are equal for the paths relevant to this index
      */
@@ -31,38 +98,101 @@ public:
 
     virtual bool matches_query(const json::Document &predicate) const = 0;
     virtual void clear() = 0;
-    virtual bool insert(const json::Document &document, const std::string &key) = 0;
+
+    /**
+     * Add an object to the index
+     *
+     * @param eid
+     *      The identifier of the object's current version (only stored by covering indexes)
+     */
+    virtual bool insert(const json::Document &document, const std::string &key, const event_id_t &eid) = 0;
     virtual bool remove(const json::Document &document, const std::string &key) = 0;
     virtual void
     find(const json::Document &predicate, std::unordered_set<std::string> &out, SetOperation op) = 0;
+
+    /**
+     * Get the full entries matching the predicate
+     *
+     * @note only supported by covering indexes
+     */
+    virtual void find_entries(const json::Document &predicate, std::vector<IndexEntry> &out) = 0;
     virtual size_t estimate_value_count(const json::Document &predicate) = 0;
+
+    /**
+     * Count the objects matching the predicate using only the index entries
+     *
+     * @note This assumes that objects with the same hash have the same value
+     * @return false if the index can't give an exact answer
+     */
+    virtual bool count(const json::Document &predicate, size_t &out) = 0;
+
     virtual void dump_metadata(bitstream &output) = 0; // for debug purpose
 
 protected:
     const std::string m_name;
     const std::vector<std::string> m_paths;
+    const std::vector<std::string> m_covered_paths;
+
+    IndexStatistics m_statistics;
+
+private:
+    std::atomic<double> m_build_progress;
 };
 
 
 /// Index using a hash map internally
-/// (only supports equality operations)
+/// (only supports equality and membership operations)
 class HashIndex : public Index
 {
 public:
-    HashIndex(BufferManager &buffer, const std::string &name, const std::vector<std::string> &paths);
+    HashIndex(BufferManager &buffer,
+              const std::string &name,
+              const std::vector<std::string> &paths,
+              const std::vector<std::string> &include = {});
     ~HashIndex();
-    static HashIndex *new_from_metadata(BufferManager &buffer, bitstream &input);
+    /**
+     * @param version
+     *      The version of the collection metadata (0 if written by a version without covering and multikey indexes)
+     */
+    static HashIndex *new_from_metadata(BufferManager &buffer, bitstream &input, uint32_t version);
     void dump_metadata(bitstream &output) override; // for debug purpose
 
     bool matches_query(const json::Document &predicate) const override;
-    bool insert(const json::Document &document, const std::string &key) override;
+    bool insert(const json::Document &document, const std::string &key, const event_id_t &eid) override;
     void clear() override;
     bool remove(const json::Document &document, const std::string &key) override;
     void find(const json::Document &predicate, std::unordered_set<std::string> &out, SetOperation op) override;
+    void find_entries(const json::Document &predicate, std::vector<IndexEntry> &out) override;
     size_t estimate_value_count(const json::Document &predicate) override;
+    bool count(const json::Document &predicate, size_t &out) override;
 
 private:
+    /**
+     * Look up the raw map values for a predicate (handles $in)
+     */
+    void find_values(const json::Document &predicate, std::unordered_set<std::string> &out, SetOperation op);
+
+    /**
+     * Get all hashes an object is indexed under
+     *
+     * Arrays are indexed as a whole (for equality) and once for every distinct element (for $contains)
+     * @throw json_error if the document doesn't contain the indexed path
+     */
+    std::vector<int64_t> get_hashes(const json::Document &document) const;
+
+    /**
+     * Generate the value stored in the map for an object
+     * This is just the key, unless the index is covering.
+     */
+    std::string encode_entry(const json::Document &document, const std::string &key, const event_id_t &eid) const;
+
+    IndexEntry decode_entry(const std::string &value) const;
+    std::string decode_key(const std::string &value) const;
+
     MultiMap m_map;
+
+    /// Set once entries for array elements have been added (equality lookups then also return arrays containing the value)
+    std::atomic<bool> m_multikey;
 };
 
 inline bool Index::compare(const json::Document &first, const json::Document &second) const
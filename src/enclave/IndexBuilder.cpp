@@ -0,0 +1,104 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "IndexBuilder.h"
+#include "Collection.h"
+#include "Enclave.h"
+#include "Index.h"
+#include "Ledger.h"
+#include "LockHandle.h"
+#include "logging.h"
+
+namespace credb::trusted
+{
+
+IndexBuilder::IndexBuilder(Enclave &enclave, Ledger &ledger, Collection &collection, std::string collection_name, std::string index_name, std::shared_ptr<Index> index)
+    : Task(enclave), m_ledger(ledger), m_collection(collection),
+      m_collection_name(std::move(collection_name)), m_index_name(std::move(index_name)),
+      m_op_context(enclave.identity()), m_index(std::move(index))
+{
+    Task::setup_thread();
+}
+
+void IndexBuilder::handle_op_response()
+{
+    log_warning("IndexBuilder does not send any requests");
+}
+
+void IndexBuilder::resume()
+{
+    lock();
+    Task::switch_into_thread();
+    unlock();
+}
+
+void IndexBuilder::work()
+{
+    while(process_batch())
+    {
+        // Give writers (and other requests) a chance to run
+        suspend();
+    }
+
+    mark_done();
+}
+
+bool IndexBuilder::process_batch()
+{
+    // The index might have been dropped (and maybe created again) in the meantime
+    if(m_collection.get_secondary_index(m_index_name) != m_index)
+    {
+        log_debug("Index " + m_index_name + " was dropped before it was complete");
+        return false;
+    }
+
+    std::vector<std::string> keys;
+
+    {
+        // Only hold the primary index' locks while collecting the keys
+        HashMap::iterator_t it(m_collection.primary_index(), m_next_bucket);
+        auto current_bucket = it.bucket();
+
+        // Never stop in the middle of a bucket
+        while(!it.at_end() && (keys.size() < BATCH_SIZE || it.bucket() == current_bucket))
+        {
+            current_bucket = it.bucket();
+            keys.push_back(it.key());
+            ++it;
+        }
+
+        m_next_bucket = it.at_end() ? HashMap::NUM_BUCKETS : it.bucket();
+    }
+
+    for(auto &key : keys)
+    {
+        // Holding the shard lock serializes us with writers to this object
+        // Either they see the entry we add, or we read the version they wrote
+        auto shard = m_ledger.get_shard(m_collection_name, key);
+
+        LockHandle lock_handle(m_ledger);
+        lock_handle.get_shard(shard, LockType::Read);
+
+        event_id_t eid;
+        auto event = m_ledger.get_latest_version(m_op_context, m_collection_name, key, "", eid, lock_handle, LockType::Read);
+
+        if(event.valid())
+        {
+            m_index->insert(event.value(), key, eid);
+        }
+    }
+
+    if(m_next_bucket >= HashMap::NUM_BUCKETS)
+    {
+        m_index->finish_build();
+        log_debug("Finished building index " + m_index_name);
+        return false;
+    }
+    else
+    {
+        m_index->set_build_progress(static_cast<double>(m_next_bucket) / static_cast<double>(HashMap::NUM_BUCKETS));
+        return true;
+    }
+}
+
+} // namespace credb::trusted
@@ -0,0 +1,65 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <memory>
+
+#include "Task.h"
+#include "OpContext.h"
+#include "HashMap.h"
+
+namespace credb::trusted
+{
+
+class Ledger;
+class Collection;
+class Index;
+
+/**
+ * Populates a newly created secondary index in the background
+ *
+ * The collection is scanned in batches of buckets of the primary index.
+ * Between two batches the task suspends so that no locks are held for a long period of time.
+ * Concurrent writes are applied to the index by Ledger::put_next_version, so the index
+ * only has to be marked as ready once the scan reached the last bucket.
+ *
+ * The builder keeps its own reference to the index, so dropping the index while it is being built is safe.
+ * The build stops once the collection no longer contains this particular index.
+ */
+class IndexBuilder : public Task
+{
+public:
+    /// Approximate number of objects to index before yielding
+    static constexpr size_t BATCH_SIZE = 1000;
+
+    IndexBuilder(Enclave &enclave, Ledger &ledger, Collection &collection, std::string collection_name, std::string index_name, std::shared_ptr<Index> index);
+
+    void handle_op_response() override;
+
+    void resume() override;
+
+protected:
+    void work() override;
+
+private:
+    /**
+     * Index the next batch of objects
+     *
+     * @return false if the index is complete (or has been dropped)
+     */
+    bool process_batch();
+
+    Ledger &m_ledger;
+    Collection &m_collection;
+
+    const std::string m_collection_name;
+    const std::string m_index_name;
+    const OpContext m_op_context;
+
+    const std::shared_ptr<Index> m_index;
+
+    HashMap::bucketid_t m_next_bucket = 0;
+};
+
+} // namespace credb::trusted
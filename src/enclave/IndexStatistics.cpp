@@ -0,0 +1,226 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "IndexStatistics.h"
+#include "util/hash.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace credb::trusted
+{
+
+IndexStatistics::IndexStatistics()
+{
+    clear();
+}
+
+void IndexStatistics::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_valid = true;
+    m_num_entries = 0;
+    m_num_frequent_values = 0;
+    m_sketch.fill(0);
+}
+
+void IndexStatistics::insert(int64_t value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_num_entries += 1;
+
+    // Update the distinct-count sketch
+    constexpr size_t register_bits = 8;
+    static_assert((size_t{1} << register_bits) == NUM_SKETCH_REGISTERS, "Register bits don't match number of registers");
+
+    const auto h = hash<int64_t>(value);
+    const auto reg = h & (NUM_SKETCH_REGISTERS - 1);
+    const auto rest = h >> register_bits;
+    const uint8_t rank = rest == 0 ? (64 - register_bits + 1) : static_cast<uint8_t>(__builtin_clzll(rest) - register_bits + 1);
+
+    if(rank > m_sketch[reg])
+    {
+        m_sketch[reg] = rank;
+    }
+
+    // Update the frequent values
+    for(size_t i = 0; i < m_num_frequent_values; ++i)
+    {
+        if(m_frequent_values[i].value == value)
+        {
+            m_frequent_values[i].count += 1;
+            return;
+        }
+    }
+
+    if(m_num_frequent_values < NUM_FREQUENT_VALUES)
+    {
+        m_frequent_values[m_num_frequent_values] = {value, 1, 0};
+        m_num_frequent_values += 1;
+        return;
+    }
+
+    // Replace the least frequent value (it inherits its count)
+    size_t min_pos = 0;
+
+    for(size_t i = 1; i < m_num_frequent_values; ++i)
+    {
+        if(m_frequent_values[i].count < m_frequent_values[min_pos].count)
+        {
+            min_pos = i;
+        }
+    }
+
+    auto &entry = m_frequent_values[min_pos];
+    entry.value = value;
+    entry.error = entry.count;
+    entry.count += 1;
+}
+
+void IndexStatistics::remove(int64_t value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_num_entries > 0)
+    {
+        m_num_entries -= 1;
+    }
+
+    for(size_t i = 0; i < m_num_frequent_values; ++i)
+    {
+        auto &entry = m_frequent_values[i];
+
+        if(entry.value == value)
+        {
+            if(entry.count > 0)
+            {
+                entry.count -= 1;
+            }
+
+            entry.error = std::min(entry.error, entry.count);
+
+            return;
+        }
+    }
+}
+
+bool IndexStatistics::is_valid() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_valid;
+}
+
+void IndexStatistics::set_valid(bool valid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_valid = valid;
+}
+
+size_t IndexStatistics::num_entries() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_num_entries;
+}
+
+size_t IndexStatistics::num_distinct_values() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return estimate_distinct_values();
+}
+
+size_t IndexStatistics::estimate_distinct_values() const
+{
+    constexpr double m = static_cast<double>(NUM_SKETCH_REGISTERS);
+    constexpr double alpha = 0.7213 / (1.0 + 1.079 / m);
+
+    double sum = 0.0;
+    size_t num_zeros = 0;
+
+    for(auto reg : m_sketch)
+    {
+        sum += std::ldexp(1.0, -static_cast<int>(reg));
+
+        if(reg == 0)
+        {
+            num_zeros += 1;
+        }
+    }
+
+    double estimate = alpha * m * m / sum;
+
+    if(estimate <= 2.5 * m && num_zeros > 0)
+    {
+        // small range correction (linear counting)
+        estimate = m * std::log(m / static_cast<double>(num_zeros));
+    }
+
+    auto result = static_cast<size_t>(estimate + 0.5);
+
+    if(result > m_num_entries)
+    {
+        result = m_num_entries;
+    }
+
+    return result;
+}
+
+size_t IndexStatistics::average_count() const
+{
+    const auto num_distinct = estimate_distinct_values();
+
+    if(num_distinct == 0)
+    {
+        return 0;
+    }
+
+    return (m_num_entries + num_distinct - 1) / num_distinct;
+}
+
+size_t IndexStatistics::estimate_count(int64_t value) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto average = average_count();
+    size_t min_count = m_num_entries;
+
+    for(size_t i = 0; i < m_num_frequent_values; ++i)
+    {
+        auto &entry = m_frequent_values[i];
+
+        if(entry.value == value)
+        {
+            // The value occurs at least (count - error) times
+            const auto guaranteed = entry.count - entry.error;
+            return std::max(guaranteed, std::min(entry.count, average));
+        }
+
+        min_count = std::min(min_count, entry.count);
+    }
+
+    // Values that are not tracked can't be more frequent than any of the tracked ones
+    if(m_num_frequent_values == NUM_FREQUENT_VALUES)
+    {
+        return std::min(average, min_count);
+    }
+    else
+    {
+        // All values are tracked
+        return 0;
+    }
+}
+
+void IndexStatistics::write(json::Writer &writer, const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    writer.start_map(name);
+    writer.write_boolean("valid", m_valid);
+    writer.write_integer("num_entries", m_num_entries);
+    writer.write_integer("num_distinct_values", estimate_distinct_values());
+    writer.write_integer("num_frequent_values", m_num_frequent_values);
+    writer.end_map();
+}
+
+} // namespace credb::trusted
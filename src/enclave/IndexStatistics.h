@@ -0,0 +1,101 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+#include <json/json.h>
+
+namespace credb::trusted
+{
+
+/**
+ * Statistics about the value distribution of an index
+ *
+ * They are maintained incrementally whenever an entry is added to or removed from the index
+ * and are used by the query planner to estimate the size of a lookup without loading any index pages.
+ *
+ * Values are identified by the hash of their (json) representation.
+ */
+class IndexStatistics
+{
+public:
+    /// Number of most frequent values that are tracked exactly (or close to it)
+    static constexpr size_t NUM_FREQUENT_VALUES = 16;
+
+    /// Number of registers of the distinct-count sketch (must be a power of two)
+    static constexpr size_t NUM_SKETCH_REGISTERS = 256;
+
+    IndexStatistics();
+
+    void insert(int64_t value);
+    void remove(int64_t value);
+    void clear();
+
+    /**
+     * Do the statistics describe all entries of the index?
+     *
+     * Statistics are not persisted. After a restart they are invalid until the index has been rebuilt
+     * and callers should fall back to a neutral estimate.
+     */
+    bool is_valid() const;
+    void set_valid(bool valid);
+
+    /**
+     * Total number of entries in the index
+     */
+    size_t num_entries() const;
+
+    /**
+     * Estimated number of distinct values in the index
+     *
+     * @note The sketch can not forget values, so this might overestimate after removals
+     */
+    size_t num_distinct_values() const;
+
+    /**
+     * Estimate how many entries have the specified value
+     */
+    size_t estimate_count(int64_t value) const;
+
+    /**
+     * Write a summary of the statistics (e.g. for explain or debugging)
+     */
+    void write(json::Writer &writer, const std::string &name) const;
+
+private:
+    struct frequent_value_t
+    {
+        int64_t value;
+
+        /// Upper bound for the number of occurrences
+        size_t count;
+
+        /// How much count might overestimate the actual number
+        size_t error;
+    };
+
+    /**
+     * Expected count for any value assuming a uniform distribution
+     */
+    size_t average_count() const;
+
+    size_t estimate_distinct_values() const;
+
+    mutable std::mutex m_mutex;
+
+    bool m_valid;
+    size_t m_num_entries;
+
+    // Space-Saving summary of the most frequent values
+    std::array<frequent_value_t, NUM_FREQUENT_VALUES> m_frequent_values;
+    size_t m_num_frequent_values;
+
+    // HyperLogLog registers
+    std::array<uint8_t, NUM_SKETCH_REGISTERS> m_sketch;
+};
+
+} // namespace credb::trusted
@@ -0,0 +1,295 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "KeyLockTable.h"
+#include "ContentionManager.h"
+#include "logging.h"
+
+#include <algorithm>
+
+namespace credb::trusted
+{
+
+/// Add everybody but owner to out
+inline bool find_others(const std::vector<lock_owner_t> &owners, lock_owner_t owner, std::vector<lock_owner_t> *out)
+{
+    bool found = false;
+
+    for(auto o : owners)
+    {
+        if(o != owner)
+        {
+            found = true;
+
+            if(out)
+            {
+                out->push_back(o);
+            }
+        }
+    }
+
+    return found;
+}
+
+bool KeyLockTable::can_lock(const partition_t &partition, const key_lock_t *lock_info, lock_owner_t owner, LockType lock_type,
+                            std::vector<lock_owner_t> *blockers)
+{
+    bool result = true;
+
+    if(lock_info && lock_info->writer != nullptr && lock_info->writer != owner)
+    {
+        result = false;
+
+        if(blockers)
+        {
+            blockers->push_back(lock_info->writer);
+        }
+    }
+
+    if(lock_type == LockType::Write)
+    {
+        if(lock_info && find_others(lock_info->readers, owner, blockers))
+        {
+            result = false;
+        }
+
+        if(find_others(partition.readers, owner, blockers))
+        {
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+void KeyLockTable::add_lock(partition_t &partition, key_lock_t &lock_info, lock_owner_t owner, LockType lock_type)
+{
+    if(lock_type == LockType::Write)
+    {
+        if(lock_info.writer == owner)
+        {
+            lock_info.write_count += 1;
+            return;
+        }
+
+        lock_info.writer = owner;
+        lock_info.write_count = 1;
+        partition.key_writers[owner] += 1;
+    }
+    else
+    {
+        lock_info.readers.push_back(owner);
+    }
+}
+
+bool KeyLockTable::try_lock_key(lock_owner_t owner, shard_id_t shard, const std::string &collection, const std::string &key, LockType lock_type,
+                                std::vector<lock_owner_t> *blockers)
+{
+    auto &partition = get_partition(shard);
+    std::lock_guard<std::mutex> lock(partition.mutex);
+
+    auto it = partition.keys.find({collection, key});
+    key_lock_t *lock_info = (it == partition.keys.end()) ? nullptr : &it->second;
+
+    if(!can_lock(partition, lock_info, owner, lock_type, blockers))
+    {
+        return false;
+    }
+
+    if(!lock_info)
+    {
+        lock_info = &partition.keys[{collection, key}];
+    }
+
+    add_lock(partition, *lock_info, owner, lock_type);
+    return true;
+}
+
+void KeyLockTable::lock_key(lock_owner_t owner, shard_id_t shard, const std::string &collection, const std::string &key, LockType lock_type)
+{
+    auto &partition = get_partition(shard);
+    std::unique_lock<std::mutex> lock(partition.mutex);
+
+    const auto id = std::pair(collection, key);
+
+    partition.released.wait(lock, [&] {
+        auto it = partition.keys.find(id);
+        return can_lock(partition, (it == partition.keys.end()) ? nullptr : &it->second, owner, lock_type, nullptr);
+    });
+
+    add_lock(partition, partition.keys[id], owner, lock_type);
+}
+
+void KeyLockTable::unlock_key(lock_owner_t owner, shard_id_t shard, const std::string &collection, const std::string &key, LockType lock_type)
+{
+    auto &partition = get_partition(shard);
+    std::lock_guard<std::mutex> lock(partition.mutex);
+
+    auto it = partition.keys.find({collection, key});
+
+    if(it == partition.keys.end())
+    {
+        log_error("Cannot unlock key: not locked");
+        return;
+    }
+
+    auto &lock_info = it->second;
+
+    if(lock_type == LockType::Write)
+    {
+        if(lock_info.writer != owner)
+        {
+            log_error("Cannot unlock key: not the owner");
+            return;
+        }
+
+        lock_info.write_count -= 1;
+
+        if(lock_info.write_count > 0)
+        {
+            return;
+        }
+
+        lock_info.writer = nullptr;
+
+        auto wit = partition.key_writers.find(owner);
+
+        if(wit != partition.key_writers.end() && --wit->second == 0)
+        {
+            partition.key_writers.erase(wit);
+        }
+    }
+    else
+    {
+        auto rit = std::find(lock_info.readers.begin(), lock_info.readers.end(), owner);
+
+        if(rit == lock_info.readers.end())
+        {
+            log_error("Cannot unlock key: not the owner");
+            return;
+        }
+
+        lock_info.readers.erase(rit);
+    }
+
+    if(lock_info.writer == nullptr && lock_info.readers.empty())
+    {
+        partition.keys.erase(it);
+    }
+
+    partition.released.notify_all();
+}
+
+bool KeyLockTable::try_lock_shard(lock_owner_t owner, shard_id_t shard)
+{
+    auto &partition = get_partition(shard);
+    std::lock_guard<std::mutex> lock(partition.mutex);
+
+    for(auto &[writer, count] : partition.key_writers)
+    {
+        if(writer != owner && count > 0)
+        {
+            return false;
+        }
+    }
+
+    partition.readers.push_back(owner);
+    return true;
+}
+
+void KeyLockTable::unlock_shard(lock_owner_t owner, shard_id_t shard)
+{
+    auto &partition = get_partition(shard);
+    std::lock_guard<std::mutex> lock(partition.mutex);
+
+    auto it = std::find(partition.readers.begin(), partition.readers.end(), owner);
+
+    if(it == partition.readers.end())
+    {
+        log_error("Cannot unlock shard: not locked");
+        return;
+    }
+
+    partition.readers.erase(it);
+    partition.released.notify_all();
+}
+
+bool KeyLockTable::has_key_writes(lock_owner_t owner, shard_id_t shard) const
+{
+    auto &partition = get_partition(shard);
+    std::lock_guard<std::mutex> lock(partition.mutex);
+
+    return partition.key_writers.find(owner) != partition.key_writers.end();
+}
+
+size_t KeyLockTable::num_locked_keys() const
+{
+    size_t result = 0;
+
+    for(auto &partition : m_partitions)
+    {
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        result += partition.keys.size();
+    }
+
+    return result;
+}
+
+KeyWriteLocks::KeyWriteLocks(KeyLockTable &table) : m_table(table)
+{
+}
+
+KeyWriteLocks::~KeyWriteLocks()
+{
+    for(auto &[shard, collection, key] : m_locked)
+    {
+        m_table.unlock_key(this, shard, collection, key, LockType::Write);
+    }
+}
+
+bool KeyWriteLocks::lock(shard_id_t shard, const std::string &collection, const std::string &key, const std::vector<shard_id_t> &held_shards)
+{
+    if(held_shards.empty())
+    {
+        m_table.lock_key(this, shard, collection, key, LockType::Write);
+        m_locked.emplace_back(shard, collection, key);
+        return true;
+    }
+
+    // We cannot sleep on the partition while holding shard locks.
+    // Instead, poll and give up once the holder needs one of our shards to commit.
+    std::vector<lock_owner_t> blockers;
+
+    for(uint32_t attempt = 1; !m_table.try_lock_key(this, shard, collection, key, LockType::Write, &blockers); ++attempt)
+    {
+        for(auto owner : blockers)
+        {
+            for(auto held : held_shards)
+            {
+                if(m_table.has_key_writes(owner, held))
+                {
+                    return false;
+                }
+            }
+        }
+
+        blockers.clear();
+        ContentionManager::backoff(attempt);
+    }
+
+    m_locked.emplace_back(shard, collection, key);
+    return true;
+}
+
+bool KeyWriteLocks::try_lock(shard_id_t shard, const std::string &collection, const std::string &key)
+{
+    if(!m_table.try_lock_key(this, shard, collection, key, LockType::Write))
+    {
+        return false;
+    }
+
+    m_locked.emplace_back(shard, collection, key);
+    return true;
+}
+
+} // namespace credb::trusted
@@ -0,0 +1,173 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "credb/event_id.h"
+#include "util/RWLockable.h"
+#include "util/pair_hash.h"
+
+namespace credb::trusted
+{
+
+/// Identifies the holder of a lock (e.g. the transaction)
+using lock_owner_t = const void*;
+
+/**
+ * Locks held by transactions between prepare and commit
+ *
+ * Transactions lock the individual objects they read or write, so that two transactions
+ * only conflict if they actually access the same object.
+ * Range predicates (e.g. a serializable find) cannot be expressed as a set of keys. Those
+ * instead lock a whole shard, which conflicts with all key write locks of that shard.
+ *
+ * Writes outside of transactions briefly take key write locks as well (see KeyWriteLocks),
+ * so that they cannot change objects a prepared transaction depends on.
+ *
+ * Every lock has an owner. Locks never conflict with other locks of the same owner.
+ * Except for lock_key() none of the functions block.
+ *
+ * The table is split by shard, so that writers to different shards never contend on the same mutex.
+ *
+ * @note These locks only order transactions among each other. Access to the ledger itself
+ *       is still protected by the shard locks (see LockHandle)
+ */
+class KeyLockTable
+{
+public:
+    /**
+     * Try to lock an object
+     *
+     * @param shard
+     *     The shard the object is stored in
+     * @param blockers [optional]
+     *     Will contain the owners of the conflicting locks on failure
+     * @return false if another owner holds a conflicting lock
+     */
+    bool try_lock_key(lock_owner_t owner, shard_id_t shard, const std::string &collection, const std::string &key, LockType lock_type,
+                      std::vector<lock_owner_t> *blockers = nullptr);
+
+    /**
+     * Lock an object and wait for other owners to release conflicting locks if needed
+     *
+     * @note The caller must not hold any shard locks, because the current holder might need those to commit
+     */
+    void lock_key(lock_owner_t owner, shard_id_t shard, const std::string &collection, const std::string &key, LockType lock_type);
+
+    void unlock_key(lock_owner_t owner, shard_id_t shard, const std::string &collection, const std::string &key, LockType lock_type);
+
+    /**
+     * Try to lock all objects of a shard for reading
+     *
+     * @return false if another owner holds a write lock for a key in this shard
+     */
+    bool try_lock_shard(lock_owner_t owner, shard_id_t shard);
+
+    void unlock_shard(lock_owner_t owner, shard_id_t shard);
+
+    /**
+     * Does the owner hold a write lock for any key in the specified shard?
+     */
+    bool has_key_writes(lock_owner_t owner, shard_id_t shard) const;
+
+    /**
+     * The number of objects that are currently locked
+     */
+    size_t num_locked_keys() const;
+
+private:
+    /// Number of partitions of the table (one per shard of the ledger)
+    static constexpr size_t NUM_PARTITIONS = 64;
+
+    struct key_lock_t
+    {
+        std::vector<lock_owner_t> readers;
+        lock_owner_t writer = nullptr;
+
+        /// How often the writer locked the object (e.g. a batch that writes the same key twice)
+        uint32_t write_count = 0;
+    };
+
+    using key_map_t = std::unordered_map<std::pair<std::string, std::string>, key_lock_t, pair_hash>;
+
+    struct partition_t
+    {
+        mutable std::mutex mutex;
+
+        /// Notified whenever a lock in this partition is released
+        std::condition_variable_any released;
+
+        key_map_t keys;
+
+        /// Owners of predicate locks
+        std::vector<lock_owner_t> readers;
+
+        /// Number of key write locks in this shard per owner
+        std::unordered_map<lock_owner_t, uint32_t> key_writers;
+    };
+
+    partition_t& get_partition(shard_id_t shard)
+    {
+        return m_partitions[shard % NUM_PARTITIONS];
+    }
+
+    const partition_t& get_partition(shard_id_t shard) const
+    {
+        return m_partitions[shard % NUM_PARTITIONS];
+    }
+
+    /**
+     * Check whether a lock could be acquired right now
+     *
+     * @note the caller must hold the mutex of the partition
+     */
+    static bool can_lock(const partition_t &partition, const key_lock_t *lock_info, lock_owner_t owner, LockType lock_type,
+                         std::vector<lock_owner_t> *blockers);
+
+    static void add_lock(partition_t &partition, key_lock_t &lock_info, lock_owner_t owner, LockType lock_type);
+
+    std::array<partition_t, NUM_PARTITIONS> m_partitions;
+};
+
+/**
+ * Key write locks of a write that is not part of a transaction
+ *
+ * The locks are released once this goes out of scope, i.e. after the write has been applied.
+ */
+class KeyWriteLocks
+{
+public:
+    explicit KeyWriteLocks(KeyLockTable &table);
+    ~KeyWriteLocks();
+
+    KeyWriteLocks(const KeyWriteLocks &other) = delete;
+
+    /**
+     * Lock an object for writing and wait for the current holder to commit or abort
+     *
+     * @param held_shards
+     *     The shard locks the caller holds (e.g. because it runs inside a program).
+     *     The current holder might need those to commit. In that case waiting would never end.
+     * @return false only if the holder needs one of the held shards
+     */
+    bool lock(shard_id_t shard, const std::string &collection, const std::string &key, const std::vector<shard_id_t> &held_shards);
+
+    /**
+     * Lock an object for writing if nobody else holds a lock for it
+     */
+    bool try_lock(shard_id_t shard, const std::string &collection, const std::string &key);
+
+private:
+    KeyLockTable &m_table;
+    std::vector<std::tuple<shard_id_t, std::string, std::string>> m_locked;
+};
+
+} // namespace credb::trusted
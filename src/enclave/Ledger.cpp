@@ -17,6 +17,7 @@
 #include <cowlang/Interpreter.h>
 #include <cowlang/unpack.h>
 
+#include "Aggregation.h"
 #include "Block.h"
 #include "Enclave.h"
 #include "Index.h"
@@ -24,10 +25,16 @@
 #include "Witness.h"
 #include "LockHandle.h"
 #include "PageHandle.h"
+#include "OrderedKeyIndex.h"
+#include "QueryPlanner.h"
+#include "ResultSorter.h"
+#include "ScalarValue.h"
+#include "predicates.h"
 #include "Shard.h"
 #include "HashMap.h"
 #include "credb/Client.h"
 #include "logging.h"
+#include "util/keys.h"
 
 #include "bindings/Database.h"
 #include "bindings/Object.h"
@@ -35,6 +42,8 @@
 #include "bindings/OpInfo.h"
 
 #include <algorithm>
+#include <map>
+#include <unordered_set>
 
 namespace credb::trusted
 {
@@ -228,7 +237,7 @@ bool Ledger::check(const OpContext &op_context,
     }
     else
     {
-        return value.matches_predicates(predicate);
+        return matches_predicates(value, predicate);
     }
 }
 
@@ -488,6 +497,46 @@ bool Ledger::check_object_policy(const json::Document &policy,
     }
 }
 
+/// Shard locks the caller of a write holds already (e.g. because it runs inside a program)
+inline std::vector<shard_id_t> get_held_shards(const LockHandle *lock_handle)
+{
+    return lock_handle ? lock_handle->held_shards() : std::vector<shard_id_t>();
+}
+
+/**
+ * Lock the keys of several objects
+ *
+ * Keys are always locked in the same order (by shard, then by key),
+ * so that two batches cannot end up waiting for each other.
+ *
+ * @return the positions of all objects that could not be locked
+ */
+inline std::set<size_t> lock_batch(KeyWriteLocks &key_locks, const std::string &collection,
+                                   const std::map<shard_id_t, std::vector<size_t>> &shards,
+                                   const std::vector<std::pair<std::string, json::Document>> &objects,
+                                   const std::vector<shard_id_t> &held_shards)
+{
+    std::set<size_t> failed;
+
+    for(auto &[shard, positions] : shards)
+    {
+        auto sorted = positions;
+        std::sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+            return objects[a].first < objects[b].first;
+        });
+
+        for(auto pos : sorted)
+        {
+            if(!key_locks.lock(shard, collection, objects[pos].first, held_shards))
+            {
+                failed.insert(pos);
+            }
+        }
+    }
+
+    return failed;
+}
+
 event_id_t Ledger::put_without_key(const OpContext &op_context,
                        const std::string &collection,
                        std::string &key_out,
@@ -501,6 +550,7 @@ event_id_t Ledger::put_without_key(const OpContext &op_context,
     event_id_t eid = INVALID_EVENT;
     shard_id_t shard = -1; 
 
+    KeyWriteLocks key_locks(m_enclave.transaction_manager().key_locks());
     LockHandle lock_handle(*this, lock_handle_);
 
     while(eid == INVALID_EVENT)
@@ -509,6 +559,12 @@ event_id_t Ledger::put_without_key(const OpContext &op_context,
         const auto key = credb::random_object_key(KEY_LEN);
         shard = get_shard(collection, key);
 
+        // A transaction might be about to create this key. Just pick another one.
+        if(!key_locks.try_lock(shard, collection, key))
+        {
+            continue;
+        }
+
         // Lock shard
         lock_handle.get_pending_block(shard, LockType::Write);
 
@@ -530,6 +586,231 @@ event_id_t Ledger::put_without_key(const OpContext &op_context,
     return eid;
 }
 
+std::vector<event_id_t> Ledger::put_many(const OpContext &op_context,
+                                         const std::string &collection,
+                                         std::vector<std::pair<std::string, json::Document>> &objects,
+                                         LockHandle *lock_handle_)
+{
+    std::vector<event_id_t> result(objects.size(), INVALID_EVENT);
+    std::map<shard_id_t, std::vector<size_t>> shards;
+
+    // Policies may read other objects, so check them before locking any shards
+    for(size_t pos = 0; pos < objects.size(); ++pos)
+    {
+        auto &key = objects[pos].first;
+
+        if(prepare_write(op_context, collection, key, "", OperationType::PutObject, lock_handle_))
+        {
+            shards[get_shard(collection, key)].push_back(pos);
+        }
+    }
+
+    // Lock all keys before any shards, so that we can wait for transactions that are committing
+    KeyWriteLocks key_locks(m_enclave.transaction_manager().key_locks());
+    const auto failed = lock_batch(key_locks, collection, shards, objects, get_held_shards(lock_handle_));
+
+    for(auto it = shards.begin(); it != shards.end();)
+    {
+        auto &[shard, positions] = *it;
+
+        positions.erase(std::remove_if(positions.begin(), positions.end(), [&](size_t pos) {
+            return failed.count(pos) > 0;
+        }), positions.end());
+
+        if(positions.empty())
+        {
+            it = shards.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if(shards.empty())
+    {
+        return result;
+    }
+
+    LockHandle lock_handle(*this, lock_handle_);
+
+    for(auto &[shard, positions] : shards)
+    {
+        lock_handle.get_shard(shard, LockType::Write);
+
+        for(auto pos : positions)
+        {
+            auto &[key, doc] = objects[pos];
+            result[pos] = apply_write(op_context, collection, key, doc, "", &lock_handle, OperationType::PutObject, INVALID_LEDGER_POS, true);
+
+            if(!lock_handle_)
+            {
+                // Sealing a block also writes it to disk
+                organize_ledger(shard);
+            }
+        }
+
+        {
+            auto pending = lock_handle.get_pending_block(shard, LockType::Write);
+            auto pending_id = pending->identifier();
+
+            pending->flush_page();
+            lock_handle.release_block(shard, pending_id, LockType::Write);
+        }
+
+        lock_handle.release_shard(shard, LockType::Write);
+    }
+
+#ifndef IS_TEST
+    if(auto col = try_get_collection(collection))
+    {
+        col->notify_triggers(m_enclave.remote_parties());
+    }
+#endif
+
+    return result;
+}
+
+std::vector<event_id_t> Ledger::bulk_load(const OpContext &op_context,
+                                          const std::string &collection,
+                                          std::vector<std::pair<std::string, json::Document>> &objects)
+{
+    if(!op_context.valid())
+    {
+        throw std::runtime_error("Cannot modify using invalid identity");
+    }
+
+    // Validate everything first so that we never leave a partially loaded batch behind
+    std::unordered_set<std::string> keys;
+
+    for(auto &[key, doc] : objects)
+    {
+        if(!is_valid_key(key))
+        {
+            throw std::runtime_error("Cannot bulk load: invalid key " + key);
+        }
+
+        // The collection policy would have to be checked for all other objects
+        if(key == "policy")
+        {
+            throw std::runtime_error("Cannot bulk load a collection policy");
+        }
+
+        if(!keys.insert(key).second)
+        {
+            throw std::runtime_error("Cannot bulk load: duplicate key " + key);
+        }
+
+        if(!doc.valid())
+        {
+            throw std::runtime_error("Cannot bulk load: invalid document for key " + key);
+        }
+    }
+
+    std::vector<event_id_t> result(objects.size(), INVALID_EVENT);
+    std::map<shard_id_t, std::vector<size_t>> shards;
+
+    for(size_t pos = 0; pos < objects.size(); ++pos)
+    {
+        shards[get_shard(collection, objects[pos].first)].push_back(pos);
+    }
+
+    // Transactions might be about to create some of these objects. Wait for them to finish.
+    KeyWriteLocks key_locks(m_enclave.transaction_manager().key_locks());
+    lock_batch(key_locks, collection, shards, objects, {});
+
+    // Also hold the shard of the collection policy, so that nobody can set one while we load
+    shards[get_shard(collection, "policy")];
+
+    // Only lock the shards this batch writes to (in order). Writes to other shards can continue.
+    LockHandle lock_handle(*this);
+
+    for(auto &it : shards)
+    {
+        lock_handle.get_shard(it.first, LockType::Write);
+    }
+
+    auto &col = get_collection(collection, true);
+    event_id_t eid;
+
+    if(col.primary_index().get("policy", eid))
+    {
+        throw std::runtime_error("Cannot bulk load into collection " + collection + " because it has a policy");
+    }
+
+    // Every object is written as the first version of its key
+    for(auto &[key, doc] : objects)
+    {
+        (void)doc;
+
+        if(col.primary_index().get(key, eid))
+        {
+            throw std::runtime_error("Cannot bulk load: object " + key + " already exists");
+        }
+    }
+
+    // The first batch into an empty collection (re)builds the secondary indexes afterwards,
+    // all later batches keep them up to date like put_many does
+    const bool is_empty = col.primary_index().size() == 0;
+    const auto mode = is_empty ? WriteMode::BulkLoad : WriteMode::Batch;
+
+    if(is_empty)
+    {
+        // Queries must not use the indexes until they have been built again
+        for(auto &it : col.secondary_indexes())
+        {
+            it.second->set_build_progress(0.0);
+        }
+    }
+
+    for(auto &[shard, positions] : shards)
+    {
+        for(auto pos : positions)
+        {
+            auto &[key, doc] = objects[pos];
+            result[pos] = put_next_version(op_context, collection, key, doc, INITIAL_VERSION_NO, INVALID_EVENT, ObjectEventHandle(), lock_handle, INVALID_LEDGER_POS, mode);
+
+            // Sealing a block also writes it to disk
+            organize_ledger(shard);
+        }
+
+        {
+            auto pending = lock_handle.get_pending_block(shard, LockType::Write);
+            auto pending_id = pending->identifier();
+
+            pending->flush_page();
+            lock_handle.release_block(shard, pending_id, LockType::Write);
+        }
+    }
+
+    if(mode == WriteMode::BulkLoad)
+    {
+        // Only write the index nodes this batch touched
+        std::vector<std::string> loaded_keys;
+        loaded_keys.reserve(objects.size());
+
+        for(auto &it : objects)
+        {
+            loaded_keys.push_back(it.first);
+        }
+
+        col.primary_index().flush_buckets(loaded_keys);
+    }
+
+    lock_handle.clear();
+
+    if(is_empty)
+    {
+        col.build_secondary_indexes(m_enclave, *this);
+    }
+
+#ifndef IS_TEST
+    col.notify_triggers(m_enclave.remote_parties());
+#endif
+
+    return result;
+}
+
 event_id_t Ledger::apply_write(const OpContext &op_context,
                        const std::string &collection,
                        const std::string &key,
@@ -537,10 +818,21 @@ event_id_t Ledger::apply_write(const OpContext &op_context,
                        const std::string &path,
                        LockHandle *lock_handle_,
                        OperationType op_type,
-                       ledger_pos_t transaction_ref)
+                       ledger_pos_t transaction_ref,
+                       bool in_batch)
 {
     auto s = get_shard(collection, key);
 
+    // Transactions hold their own key locks. Batches have already locked all their keys.
+    KeyWriteLocks key_locks(m_enclave.transaction_manager().key_locks());
+
+    if(transaction_ref == INVALID_LEDGER_POS && !in_batch
+        && !key_locks.lock(s, collection, key, get_held_shards(lock_handle_)))
+    {
+        log_debug("rejected write because the transaction holding the object needs a shard we locked");
+        return INVALID_EVENT;
+    }
+
     LockHandle lock_handle(*this, lock_handle_);
 
     // Acquire lock to shard in any case
@@ -551,6 +843,7 @@ event_id_t Ledger::apply_write(const OpContext &op_context,
     event_id_t previous_id = INVALID_EVENT;
 
     version_number_t number = INITIAL_VERSION_NO;
+    const auto mode = in_batch ? WriteMode::Batch : WriteMode::Single;
 
     ObjectEventHandle previous_version;
     auto previous_event = get_latest_event(collection, key, previous_id, lock_handle, LockType::Write);
@@ -579,7 +872,7 @@ event_id_t Ledger::apply_write(const OpContext &op_context,
         else
         {
             // Create a new object
-            res = put_next_version(op_context, collection, key, to_write, number, previous_id, previous_version, lock_handle, transaction_ref);
+            res = put_next_version(op_context, collection, key, to_write, number, previous_id, previous_version, lock_handle, transaction_ref, mode);
         }
     }
     else
@@ -599,20 +892,20 @@ event_id_t Ledger::apply_write(const OpContext &op_context,
                 json::Document doc = value.duplicate(true);
                 doc.add(path, to_write);
 
-                res = put_next_version(op_context, collection, key, doc, number, previous_id, previous_version, lock_handle, transaction_ref);
+                res = put_next_version(op_context, collection, key, doc, number, previous_id, previous_version, lock_handle, transaction_ref, mode);
             }
             else if(op_type == OperationType::PutObject)
             {
                 if(path.empty())
                 {
-                    res = put_next_version(op_context, collection, key, to_write, number, previous_id, previous_version, lock_handle, transaction_ref);
+                    res = put_next_version(op_context, collection, key, to_write, number, previous_id, previous_version, lock_handle, transaction_ref, mode);
                 }
                 else
                 {
                     json::Document doc = value.duplicate(true);
                     doc.insert(path, to_write);
 
-                    res = put_next_version(op_context, collection, key, doc, number, previous_id, previous_version, lock_handle, transaction_ref);
+                    res = put_next_version(op_context, collection, key, doc, number, previous_id, previous_version, lock_handle, transaction_ref, mode);
                 }
             }
             else if(op_type == OperationType::RemoveObject)
@@ -623,7 +916,24 @@ event_id_t Ledger::apply_write(const OpContext &op_context,
                 auto &col = get_collection(collection);
                 col.primary_index().insert(key, res);
 
+                // Covering indexes must not return removed objects
+                for(auto it : col.secondary_indexes())
+                {
+                    it.second->remove(value, key);
+                }
+
+                if(auto ordered_index = col.ordered_index())
+                {
+                    ordered_index->remove(key);
+                }
+
+                if(!policy.empty())
+                {
+                    col.decrement_policy_count();
+                }
+
                 m_object_count--;
+                col.decrement_object_count();
             }
             else
             {
@@ -648,7 +958,8 @@ event_id_t Ledger::put_next_version(const OpContext &op_context,
                                     event_id_t previous_id,
                                     const ObjectEventHandle &previous_version,
                                     LockHandle &lock_handle,
-                                    ledger_pos_t transaction_ref)
+                                    ledger_pos_t transaction_ref,
+                                    WriteMode mode)
 {
     if(!op_context.valid())
     {
@@ -675,42 +986,22 @@ event_id_t Ledger::put_next_version(const OpContext &op_context,
     if(version_number == INITIAL_VERSION_NO)
     {
         m_object_count++;
-        writer.write_integer(INVALID_BLOCK);
-        writer.write_integer(0);
+        col.increment_object_count();
 
-        for(auto it : col.secondary_indexes())
+        if(auto ordered_index = col.ordered_index())
         {
-            auto index = it.second;
-            index->insert(doc, key);
+            ordered_index->insert(key);
         }
+
+        writer.write_integer(INVALID_BLOCK);
+        writer.write_integer(0);
     }
     else
     {
-        for(auto it : col.secondary_indexes())
-        {
-            auto index = it.second;
-            auto old_val = previous_version.value();
-
-            auto equal = index->compare(old_val, doc);
-
-            if(!equal)
-            {
-                index->remove(old_val, key);
-                index->insert(doc, key);
-            } 
-        }
-
         writer.write_integer(previous_id.block);
         writer.write_integer(previous_id.index);
     }
 
-    // check if any indexes match
-    for(auto it : col.secondary_indexes())
-    {
-        auto index = it.second;
-        index->insert(doc, key);
-    }
-
     writer.write_document("", doc);
 
     if(previous_version.valid())
@@ -730,16 +1021,61 @@ event_id_t Ledger::put_next_version(const OpContext &op_context,
     auto new_version = writer.make_document();
 
     auto index = pending->insert(new_version);
-    pending->flush_page();
+
+    if(mode == WriteMode::Single)
+    {
+        pending->flush_page();
+    }
 
     event_id_t event_id = { shard_no, pending->identifier(), index };
 
+    const bool has_policy = !json::Document(doc, "policy", false).empty();
+    const bool had_policy = version_number != INITIAL_VERSION_NO && !previous_version.get_policy().empty();
+
+    if(has_policy && !had_policy)
+    {
+        col.increment_policy_count();
+    }
+    else if(!has_policy && had_policy)
+    {
+        col.decrement_policy_count();
+    }
+
+    // Covering indexes store the event id, so this has to happen after the version was inserted
+    // Bulk loads build the secondary indexes once all objects are in place
+    if(mode != WriteMode::BulkLoad)
+    {
+        for(auto it : col.secondary_indexes())
+        {
+            auto sindex = it.second;
+
+            if(version_number == INITIAL_VERSION_NO)
+            {
+                sindex->insert(doc, key, event_id);
+            }
+            else
+            {
+                auto old_val = previous_version.value();
+
+                // Entries of covering indexes depend on more than just the indexed paths
+                if(sindex->is_covering() || !sindex->compare(old_val, doc))
+                {
+                    sindex->remove(old_val, key);
+                    sindex->insert(doc, key, event_id);
+                }
+            }
+        }
+    }
+
     bitstream index_changes;
     std::string index_name;
     index_changes << collection << index_name;
-    col.primary_index().insert(key, event_id, &index_changes);
+    col.primary_index().insert(key, event_id, &index_changes, mode != WriteMode::BulkLoad);
 #ifndef IS_TEST
-    col.notify_triggers(m_enclave.remote_parties());
+    if(mode == WriteMode::Single)
+    {
+        col.notify_triggers(m_enclave.remote_parties());
+    }
 #endif
     m_version_count += 1;
 
@@ -807,10 +1143,32 @@ void Ledger::put_object_index_from_upstream(bitstream &changes, shard_id_t shard
     col.update_index(index, changes);
 }
 
-bool Ledger::create_index(const std::string &collection, const std::string &name, const std::vector<std::string> &paths)
+bool Ledger::create_index(const std::string &collection,
+                          const std::string &name,
+                          const std::vector<std::string> &paths,
+                          const std::vector<std::string> &include)
 {
     auto &col = get_collection(collection, true);
-    return col.create_index(name, paths, m_enclave, *this);
+    return col.create_index(name, paths, include, m_enclave, *this);
+}
+
+bool Ledger::create_ordered_index(const std::string &collection)
+{
+    auto &col = get_collection(collection, true);
+
+    if(col.num_objects() > OrderedKeyIndex::MAX_KEYS)
+    {
+        log_warning("Collection " + collection + " is too large for an ordered index");
+        return false;
+    }
+
+    if(!col.create_ordered_index(m_enclave, *this))
+    {
+        log_debug("ordered index for " + collection + " already exists. ignore");
+        return false;
+    }
+
+    return true;
 }
 
 bool Ledger::drop_index(const std::string &collection, const std::string &name)
@@ -824,6 +1182,7 @@ bool Ledger::clear(const OpContext &op_context, const std::string &collection)
     const auto transaction_ref = INVALID_LEDGER_POS;
 
     auto &col = get_collection(collection);
+    auto secondary_indexes = col.secondary_indexes();
     auto it = col.primary_index().begin();
  
     while(!it.at_end())
@@ -853,7 +1212,25 @@ bool Ledger::clear(const OpContext &op_context, const std::string &collection)
             
             it.set_value(id, &index_changes);
 
+            auto value = previous_event.value();
+
+            for(auto sit : secondary_indexes)
+            {
+                sit.second->remove(value, key);
+            }
+
+            if(auto ordered_index = col.ordered_index())
+            {
+                ordered_index->remove(key);
+            }
+
+            if(!previous_event.get_policy().empty())
+            {
+                col.decrement_policy_count();
+            }
+
             m_object_count--;
+            col.decrement_object_count();
            
             // tell downstream
             send_index_updates_to_downstream(index_changes, shard, pending->identifier(), pending->num_entries());
@@ -943,32 +1320,722 @@ ObjectEventHandle Ledger::get_latest_version(const OpContext &op_context,
     }
 }
 
-uint32_t Ledger::count_objects(const OpContext &op_context, const std::string &collection, const json::Document &predicates)
+ObjectEventHandle Ledger::get_snapshot_version(const OpContext &op_context,
+                                const std::string &collection,
+                                const std::string &key,
+                                const std::string &path,
+                                const LedgerSnapshot &snapshot,
+                                event_id_t &id,
+                                LockHandle &lock_handle)
 {
-    if(collection.empty())
+    auto event = get_latest_event(collection, key, id, lock_handle, LockType::Read);
+
+    // Skip everything that happened after the snapshot was taken
+    while(event.valid())
     {
-        return num_objects();
-    }
+        if(snapshot.contains(id)
+           && (event.get_type() == ObjectEventType::NewVersion || event.get_type() == ObjectEventType::Deletion))
+        {
+            break;
+        }
 
-    auto it = find(op_context, collection, predicates);
+        if(!event.has_predecessor())
+        {
+            // Created after the snapshot
+            event.clear();
+            break;
+        }
 
-    uint32_t count = 0;
-    std::string key;
-    ObjectEventHandle _;
+        block_id_t previous_block = id.block;
 
-    while(it.next(key, _))
+        id = { id.shard, event.previous_block(), event.previous_index() };
+        event = lock_handle.get_block(id.shard, id.block, LockType::Read)->get(id.index);
+
+        lock_handle.release_block(id.shard, previous_block, LockType::Read);
+    }
+
+    if(!event.valid() || event.get_type() != ObjectEventType::NewVersion)
     {
-        count += 1;
+        lock_handle.release_block(id.shard, id.block, LockType::Read);
+        id = INVALID_EVENT;
+        return ObjectEventHandle();
     }
 
-    return count;
-}
+    auto policy = event.get_policy();
 
-event_id_t Ledger::put_tombstone(const OpContext &op_context,
-                                 const event_id_t &previous_id,
-                                 LockHandle &lock_handle, 
-                                 ledger_pos_t transaction_ref)
-{
+    if(policy.empty() || check_object_policy(policy, op_context, collection, key, path, OperationType::GetObject, lock_handle))
+    {
+        return event;
+    }
+    else
+    {
+        return ObjectEventHandle();
+    }
+}
+
+LedgerSnapshot Ledger::get_snapshot()
+{
+    LedgerSnapshot snapshot;
+    LockHandle lock_handle(*this);
+
+    // Transactions hold the locks of all their shards while writing
+    // So holding all shard locks at once guarantees that we see either all or none of their writes
+    for(shard_id_t shard = 0; shard < NUM_SHARDS; ++shard)
+    {
+        lock_handle.get_shard(shard, LockType::Read);
+    }
+
+    for(shard_id_t shard = 0; shard < NUM_SHARDS; ++shard)
+    {
+        auto pending = lock_handle.get_pending_block(shard, LockType::Read);
+        auto pending_id = pending->identifier();
+
+        snapshot.set_head({shard, pending_id, pending->num_entries()});
+        lock_handle.release_block(shard, pending_id, LockType::Read);
+    }
+
+    return snapshot;
+}
+
+uint32_t Ledger::count_objects(const OpContext &op_context, const std::string &collection, const json::Document &predicates)
+{
+    if(collection.empty())
+    {
+        return num_objects();
+    }
+
+    auto col = try_get_collection(collection);
+
+    if(!col)
+    {
+        return 0;
+    }
+
+    size_t index_count = 0;
+
+    if(count_from_indexes(*col, predicates, index_count))
+    {
+        return index_count;
+    }
+
+    QueryPlanner planner;
+    auto plan = planner.plan(col, predicates);
+
+    if(use_parallel_scan(collection, plan))
+    {
+        return count_parallel(op_context, collection, predicates);
+    }
+
+    auto it = find(op_context, collection, predicates, plan);
+
+    uint32_t count = 0;
+    std::string key;
+    ObjectEventHandle _;
+
+    while(it.next(key, _))
+    {
+        count += 1;
+    }
+
+    return count;
+}
+
+void Ledger::aggregate(const OpContext &op_context,
+                       const std::string &collection,
+                       const json::Document &predicates,
+                       Aggregation &aggregation)
+{
+    auto col = try_get_collection(collection);
+
+    if(!col)
+    {
+        return;
+    }
+
+    size_t index_count = 0;
+
+    if(aggregation.counts_only() && count_from_indexes(*col, predicates, index_count))
+    {
+        aggregation.add_count(index_count);
+        return;
+    }
+
+    auto plan = plan_query(collection, predicates, aggregation.paths());
+
+    if(plan.covering)
+    {
+        for(auto &entry : find_covered(op_context, collection, predicates, plan))
+        {
+            aggregation.add(entry.value);
+        }
+
+        return;
+    }
+
+    if(use_parallel_scan(collection, plan))
+    {
+        const size_t num_parts = num_scan_parts();
+        std::vector<Aggregation> parts(num_parts, aggregation);
+
+        for(auto &part : parts)
+        {
+            part.clear();
+        }
+
+        scan_in_parts(op_context, *col, collection, predicates, num_parts, [&](size_t part, ObjectListIterator &it) {
+            std::string key;
+            ObjectEventHandle hdl;
+
+            while(it.next(key, hdl))
+            {
+                parts[part].add(hdl.value());
+            }
+        });
+
+        for(auto &part : parts)
+        {
+            aggregation.merge(part);
+        }
+
+        return;
+    }
+
+    auto it = find(op_context, collection, predicates, plan);
+
+    std::string key;
+    ObjectEventHandle hdl;
+
+    while(it.next(key, hdl))
+    {
+        aggregation.add(hdl.value());
+    }
+}
+
+bool Ledger::use_parallel_scan(const std::string &collection, const QueryPlan &plan)
+{
+    if(!plan.is_linear_scan() || m_enclave.worker_pool().num_workers() == 0)
+    {
+        return false;
+    }
+
+    auto col = try_get_collection(collection);
+    return col && col->num_objects() >= PARALLEL_SCAN_THRESHOLD;
+}
+
+size_t Ledger::num_scan_parts()
+{
+    // Use more parts than threads so that uneven parts don't leave threads idle
+    constexpr size_t PARTS_PER_THREAD = 4;
+    constexpr size_t MAX_PARTS = 64;
+
+    return std::min((m_enclave.worker_pool().num_workers() + 1) * PARTS_PER_THREAD, MAX_PARTS);
+}
+
+void Ledger::scan_in_parts(const OpContext &op_context,
+                           Collection &col,
+                           const std::string &collection,
+                           const json::Document &predicates,
+                           size_t num_parts,
+                           const std::function<void(size_t, ObjectListIterator&)> &func)
+{
+    auto &primary_index = col.primary_index();
+    std::vector<WorkerPool::job_t> jobs;
+
+    for(size_t part = 0; part < num_parts; ++part)
+    {
+        auto begin = static_cast<HashMap::bucketid_t>(part * HashMap::NUM_BUCKETS / num_parts);
+        auto end = (part + 1) * HashMap::NUM_BUCKETS / num_parts;
+
+        // every part gets its own copy so that no document is shared between threads
+        auto part_predicates = std::make_shared<json::Document>(predicates.duplicate());
+
+        jobs.emplace_back([&, part, begin, end, part_predicates]() {
+            std::unique_ptr<ObjectKeyProvider> key_provider(new HashMap::LinearScanKeyProvider(primary_index, begin, end));
+            ObjectListIterator it(op_context, collection, part_predicates->duplicate(), *this, nullptr, std::move(key_provider));
+
+            func(part, it);
+        });
+    }
+
+    m_enclave.worker_pool().run_all(jobs);
+}
+
+std::vector<ScanResult> Ledger::find_parallel(const OpContext &op_context,
+                                              const std::string &collection,
+                                              const json::Document &predicates,
+                                              const std::vector<std::string> &projection,
+                                              int32_t limit)
+{
+    std::vector<ScanResult> result;
+    auto col = try_get_collection(collection);
+
+    if(!col)
+    {
+        return result;
+    }
+
+    const size_t num_parts = num_scan_parts();
+    std::vector<std::vector<ScanResult>> parts(num_parts);
+
+    scan_in_parts(op_context, *col, collection, predicates, num_parts, [&](size_t part, ObjectListIterator &it) {
+        auto &out = parts[part];
+
+        std::string key;
+        ObjectEventHandle hdl;
+
+        // No part can contribute more than limit objects to the result
+        for(auto eid = it.next(key, hdl); hdl.valid(); eid = it.next(key, hdl))
+        {
+            json::Document value = hdl.value();
+
+            if(projection.empty())
+            {
+                out.push_back(ScanResult{key, eid, value.duplicate()});
+            }
+            else
+            {
+                json::Document filtered(value, projection);
+                out.push_back(ScanResult{key, eid, filtered.duplicate()});
+            }
+
+            if(limit > 0 && out.size() == static_cast<size_t>(limit))
+            {
+                break;
+            }
+        }
+    });
+
+    // Parts cover increasing bucket ranges, so concatenating them yields the order of a sequential scan
+    for(auto &part : parts)
+    {
+        for(auto &obj : part)
+        {
+            if(limit > 0 && result.size() == static_cast<size_t>(limit))
+            {
+                return result;
+            }
+
+            result.emplace_back(std::move(obj));
+        }
+    }
+
+    return result;
+}
+
+std::vector<ScanResult> Ledger::get_many(const OpContext &op_context,
+                                         const std::string &collection,
+                                         const std::vector<std::string> &keys,
+                                         const std::string &path,
+                                         LockHandle *lock_handle_,
+                                         const LedgerSnapshot *snapshot)
+{
+    std::vector<ScanResult> result(keys.size());
+
+    for(size_t pos = 0; pos < keys.size(); ++pos)
+    {
+        result[pos].key = keys[pos];
+        result[pos].eid = INVALID_EVENT;
+    }
+
+    if(!try_get_collection(collection))
+    {
+        return result;
+    }
+
+    std::map<shard_id_t, std::vector<size_t>> shards;
+
+    for(size_t pos = 0; pos < keys.size(); ++pos)
+    {
+        shards[get_shard(collection, keys[pos])].push_back(pos);
+    }
+
+    LockHandle lock_handle(*this, lock_handle_);
+
+    for(auto &[shard, positions] : shards)
+    {
+        // Hold the shard lock for the entire batch
+        lock_handle.get_shard(shard, LockType::Read);
+
+        for(auto pos : positions)
+        {
+            event_id_t eid;
+
+            {
+                auto hdl = snapshot ? get_snapshot_version(op_context, collection, keys[pos], path, *snapshot, eid, lock_handle)
+                                    : get_latest_version(op_context, collection, keys[pos], path, eid, lock_handle, LockType::Read);
+
+                if(hdl.valid())
+                {
+                    auto value = path.empty() ? hdl.value().duplicate(true) : hdl.value(path).duplicate(true);
+
+                    if(value.valid())
+                    {
+                        result[pos].eid = eid;
+                        result[pos].value = std::move(value);
+                    }
+                }
+            }
+
+            if(eid != INVALID_EVENT)
+            {
+                lock_handle.release_block(eid.shard, eid.block, LockType::Read);
+            }
+        }
+
+        lock_handle.release_shard(shard, LockType::Read);
+    }
+
+    return result;
+}
+
+std::vector<ScanResult> Ledger::find_join(const OpContext &op_context,
+                                          const std::string &collection,
+                                          const json::Document &predicates,
+                                          const std::vector<std::string> &projection,
+                                          int32_t limit,
+                                          const LookupJoin &join)
+{
+    if(join.local_path.empty() || join.foreign_collection.empty() || join.into.empty())
+    {
+        throw std::runtime_error("Invalid lookup: local path, foreign collection and output field are required");
+    }
+
+    std::vector<ScanResult> result;
+
+    // Textual representation of the referenced value for every result (empty if there is none)
+    std::vector<std::string> references;
+
+    {
+        auto it = find(op_context, collection, predicates);
+        std::string key;
+        ObjectEventHandle hdl;
+
+        for(auto eid = it.next(key, hdl); hdl.valid(); eid = it.next(key, hdl))
+        {
+            if(limit > 0 && result.size() == static_cast<size_t>(limit))
+            {
+                break;
+            }
+
+            json::Document value = hdl.value();
+            json::Document reference(value, join.local_path);
+
+            references.emplace_back(reference.empty() ? "" : reference.str());
+
+            if(projection.empty())
+            {
+                result.push_back(ScanResult{key, eid, value.duplicate()});
+            }
+            else
+            {
+                json::Document filtered(value, projection);
+                result.push_back(ScanResult{key, eid, filtered.duplicate()});
+            }
+        }
+
+        // Locks on this collection are released here, before any foreign objects are read
+    }
+
+    std::map<std::string, std::vector<json::Document>> matches;
+
+    for(auto &reference : references)
+    {
+        if(!reference.empty())
+        {
+            matches.emplace(reference, std::vector<json::Document>{});
+        }
+    }
+
+    if(join.foreign_path.empty())
+    {
+        std::vector<std::string> keys;
+        std::vector<std::string> key_references;
+
+        for(auto &[reference, objects] : matches)
+        {
+            (void)objects;
+            auto value = ScalarValue::read(json::Document(reference));
+
+            if(value.type == ScalarValue::Type::String)
+            {
+                keys.push_back(value.string);
+                key_references.push_back(reference);
+            }
+        }
+
+        auto objects = get_many(op_context, join.foreign_collection, keys);
+
+        for(size_t pos = 0; pos < objects.size(); ++pos)
+        {
+            if(objects[pos].eid != INVALID_EVENT)
+            {
+                matches[key_references[pos]].emplace_back(std::move(objects[pos].value));
+            }
+        }
+    }
+    else if(!matches.empty())
+    {
+        // Resolve all references with a single query, i.e. {foreign_path: {"$in": [...]}}
+        // This way an index on the foreign path is probed once per reference but the collection is only scanned once
+        json::Writer writer;
+        writer.start_map();
+        writer.start_map(join.foreign_path);
+        writer.start_array("$in");
+
+        size_t pos = 0;
+
+        for(auto &[reference, objects] : matches)
+        {
+            (void)objects;
+            writer.write_document(std::to_string(pos), json::Document(reference));
+            pos += 1;
+        }
+
+        writer.end_array();
+        writer.end_map();
+        writer.end_map();
+
+        auto it = find(op_context, join.foreign_collection, writer.make_document());
+        std::string key;
+        ObjectEventHandle hdl;
+
+        while(it.next(key, hdl))
+        {
+            auto value = hdl.value();
+            json::Document foreign_value(value, join.foreign_path);
+
+            auto match = matches.find(foreign_value.str());
+
+            if(match != matches.end())
+            {
+                match->second.emplace_back(value.duplicate());
+            }
+        }
+    }
+
+    for(size_t pos = 0; pos < result.size(); ++pos)
+    {
+        json::Writer writer;
+        writer.start_array();
+
+        auto it = matches.find(references[pos]);
+
+        if(it != matches.end())
+        {
+            for(size_t i = 0; i < it->second.size(); ++i)
+            {
+                writer.write_document(std::to_string(i), it->second[i]);
+            }
+        }
+
+        writer.end_array();
+        result[pos].value.insert(join.into, writer.make_document());
+    }
+
+    return result;
+}
+
+std::vector<ScanResult> Ledger::find_sorted(const OpContext &op_context,
+                                            const std::string &collection,
+                                            const json::Document &predicates,
+                                            const std::vector<std::string> &projection,
+                                            const std::string &sort,
+                                            int32_t limit,
+                                            LockHandle *lock_handle)
+{
+    ResultSorter sorter(sort, limit);
+    auto col = try_get_collection(collection);
+
+    if(!col)
+    {
+        return {};
+    }
+
+    auto plan = plan_query(collection, predicates, projection);
+
+    if(sorter.by_key() && !sorter.descending() && plan.is_linear_scan())
+    {
+        auto ordered_index = col->ordered_index();
+
+        if(ordered_index && ordered_index->is_ready())
+        {
+            // Keys already come in the right order, so we can stop after limit matches
+            std::unique_ptr<ObjectKeyProvider> key_provider(new OrderedKeyIndex::RangeKeyProvider(*ordered_index, "", ""));
+            ObjectListIterator it(op_context, collection, predicates.duplicate(), *this, lock_handle, std::move(key_provider));
+
+            std::vector<ScanResult> result;
+            std::string key;
+            ObjectEventHandle hdl;
+
+            for(auto eid = it.next(key, hdl); hdl.valid(); eid = it.next(key, hdl))
+            {
+                if(limit > 0 && result.size() == static_cast<size_t>(limit))
+                {
+                    break;
+                }
+
+                json::Document value = hdl.value();
+
+                if(projection.empty())
+                {
+                    result.push_back(ScanResult{key, eid, value.duplicate()});
+                }
+                else
+                {
+                    json::Document filtered(value, projection);
+                    result.push_back(ScanResult{key, eid, filtered.duplicate()});
+                }
+            }
+
+            return result;
+        }
+    }
+
+    if(!projection.empty() && !lock_handle)
+    {
+        // The index also needs to hold the values we sort by
+        auto paths = projection;
+
+        if(!sorter.by_key())
+        {
+            paths.push_back(sorter.path());
+        }
+
+        auto covering_plan = plan_query(collection, predicates, paths);
+
+        if(covering_plan.covering)
+        {
+            for(auto &entry : find_covered(op_context, collection, predicates, covering_plan))
+            {
+                sorter.add(entry.key, entry.eid, entry.value, projection);
+            }
+
+            return sorter.result();
+        }
+    }
+
+    if(!lock_handle && use_parallel_scan(collection, plan))
+    {
+        // Every part keeps its own top-k, which are merged at the end
+        const size_t num_parts = num_scan_parts();
+        std::vector<ResultSorter> parts;
+        parts.reserve(num_parts);
+
+        for(size_t i = 0; i < num_parts; ++i)
+        {
+            parts.emplace_back(sort, limit);
+        }
+
+        scan_in_parts(op_context, *col, collection, predicates, num_parts, [&](size_t part, ObjectListIterator &it) {
+            std::string key;
+            ObjectEventHandle hdl;
+
+            for(auto eid = it.next(key, hdl); hdl.valid(); eid = it.next(key, hdl))
+            {
+                parts[part].add(key, eid, hdl.value(), projection);
+            }
+        });
+
+        for(auto &part : parts)
+        {
+            sorter.merge(part);
+        }
+
+        return sorter.result();
+    }
+
+    auto it = find(op_context, collection, predicates, plan, lock_handle);
+    std::string key;
+    ObjectEventHandle hdl;
+
+    for(auto eid = it.next(key, hdl); hdl.valid(); eid = it.next(key, hdl))
+    {
+        sorter.add(key, eid, hdl.value(), projection);
+    }
+
+    return sorter.result();
+}
+
+uint32_t Ledger::count_parallel(const OpContext &op_context, const std::string &collection, const json::Document &predicates)
+{
+    auto col = try_get_collection(collection);
+
+    if(!col)
+    {
+        return 0;
+    }
+
+    const size_t num_parts = num_scan_parts();
+    std::vector<uint32_t> counts(num_parts, 0);
+
+    scan_in_parts(op_context, *col, collection, predicates, num_parts, [&](size_t part, ObjectListIterator &it) {
+        std::string key;
+        ObjectEventHandle _;
+
+        while(it.next(key, _))
+        {
+            counts[part] += 1;
+        }
+    });
+
+    uint32_t count = 0;
+
+    for(auto c : counts)
+    {
+        count += c;
+    }
+
+    return count;
+}
+
+bool Ledger::count_from_indexes(Collection &col, const json::Document &predicates, size_t &out)
+{
+    if(!col.has_exact_counts() || col.num_objects_with_policy() > 0)
+    {
+        // policies might hide some of the objects from the caller
+        return false;
+    }
+
+    if(predicates.empty() || (predicates.get_type() == json::ObjectType::Map && predicates.get_size() == 0))
+    {
+        out = col.num_objects();
+        return true;
+    }
+
+    // Only predicates on a single path can be answered by a (single path) index without residual checks
+    if(predicates.get_type() != json::ObjectType::Map || predicates.get_size() != 1)
+    {
+        return false;
+    }
+
+    const auto path = predicates.get_key(0);
+
+    for(auto &it : col.secondary_indexes())
+    {
+        auto index = it.second;
+
+        if(!index->is_ready() || index->paths().size() != 1 || index->paths()[0] != path
+           || !index->matches_query(predicates))
+        {
+            continue;
+        }
+
+        json::Document view(predicates, index->paths());
+
+        if(index->count(view, out))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+event_id_t Ledger::put_tombstone(const OpContext &op_context,
+                                 const event_id_t &previous_id,
+                                 LockHandle &lock_handle, 
+                                 ledger_pos_t transaction_ref)
+{
     if(!op_context.valid())
     {
         throw std::runtime_error("Cannot modify using invalid identity");
@@ -1010,72 +2077,32 @@ ObjectListIterator Ledger::find(const OpContext &op_context,
         return ObjectListIterator(op_context, collection, predicates.duplicate(), *this, lock_handle, nullptr);
     }
 
-    std::set<std::string> paths;
-    std::vector<std::pair<size_t, Index *>> indexes;
-
-    auto &col = *p_col;
-
-    for(auto &it : col.secondary_indexes())
-    {
-        auto index = it.second;
-        bool contains = true;
-        for(auto &p : index->paths())
-        {
-            if(paths.find(p) == paths.end())
-            {
-                contains = false;
-            }
-        }
-
-        // Already covered by other indexes
-        if(contains || !index->matches_query(predicates))
-        {
-            continue;
-        }
-
-        json::Document view(predicates, index->paths());
-        if(!view.empty())
-        {
-            // reminder: keep this piece of code in sync with the code below
-            json::Document view(predicates, index->paths());
+    QueryPlanner planner;
+    auto plan = planner.plan(p_col, predicates);
 
-            if(view.get_size() > 1)
-            {
-                throw std::runtime_error("Fixme");
-            }
-
-            auto size = index->estimate_value_count(view);
-            log_debug("estimation: will find " + std::to_string(size) + " keys from index " + index->name());
+    return find(op_context, collection, predicates, plan, lock_handle);
+}
 
-            indexes.emplace_back(size, index);
-            for(auto &p : index->paths())
-            {
-                paths.insert(p);
-            }
-        }
-    }
+ObjectListIterator Ledger::find(const OpContext &op_context,
+                                const std::string &collection,
+                                const json::Document &predicates,
+                                const QueryPlan &plan,
+                                LockHandle *lock_handle)
+{
+    auto &col = get_collection(collection);
 
-    if(!indexes.empty())
+    if(!plan.is_linear_scan())
     {
-        // heuristic: let the smallest result set be the first set in the merged keys
-        std::sort(indexes.begin(), indexes.end(),
-                  [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
-
         bool first = true;
         std::unordered_set<std::string> candidates;
 
         // set intersection
-        for(auto &it : indexes)
+        for(auto &step : plan.index_steps)
         {
-            auto index = it.second;
+            auto index = step.index;
 
             // Only use the part of the predicate that the index can help us with
             json::Document view(predicates, index->paths());
-            
-            if(view.get_size() > 1)
-            {
-                throw std::runtime_error("Fixme");
-            }
 
             index->find(view, candidates, first ? SetOperation::Union : SetOperation::Intersect);
             first = false;
@@ -1083,7 +2110,7 @@ ObjectListIterator Ledger::find(const OpContext &op_context,
 
         std::vector<std::string> merged_keys(candidates.begin(), candidates.end());
         log_debug("merged keys size " + std::to_string(merged_keys.size()) + " from " +
-                  std::to_string(indexes.size()) + " indexes");
+                  std::to_string(plan.index_steps.size()) + " indexes");
         
         std::unique_ptr<VectorObjectKeyProvider> key_provider(new VectorObjectKeyProvider(std::move(merged_keys)));
 
@@ -1099,6 +2126,127 @@ ObjectListIterator Ledger::find(const OpContext &op_context,
     }
 }
 
+ObjectListIterator Ledger::scan(const OpContext &op_context,
+                                const std::string &collection,
+                                const std::string &start_key,
+                                const std::string &end_key,
+                                LockHandle *lock_handle)
+{
+    json::Document predicates("");
+    auto p_col = try_get_collection(collection);
+
+    if(!p_col)
+    {
+        return ObjectListIterator(op_context, collection, std::move(predicates), *this, lock_handle, nullptr);
+    }
+
+    auto ordered_index = p_col->ordered_index();
+
+    if(ordered_index && ordered_index->is_ready())
+    {
+        std::unique_ptr<ObjectKeyProvider> key_provider(new OrderedKeyIndex::RangeKeyProvider(*ordered_index, start_key, end_key));
+        return ObjectListIterator(op_context, collection, std::move(predicates), *this, lock_handle, std::move(key_provider));
+    }
+
+    // No ordered index: look at all keys and sort the ones in range
+    log_debug("scan without ordered index");
+    std::vector<std::string> keys;
+
+    for(auto it = p_col->primary_index().begin(); !it.at_end(); ++it)
+    {
+        auto key = it.key();
+
+        if(key >= start_key && (end_key.empty() || key < end_key))
+        {
+            keys.emplace_back(std::move(key));
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    std::unique_ptr<ObjectKeyProvider> key_provider(new VectorObjectKeyProvider(std::move(keys)));
+    return ObjectListIterator(op_context, collection, std::move(predicates), *this, lock_handle, std::move(key_provider));
+}
+
+ObjectListIterator Ledger::scan_prefix(const OpContext &op_context,
+                                       const std::string &collection,
+                                       const std::string &prefix,
+                                       LockHandle *lock_handle)
+{
+    return scan(op_context, collection, prefix, prefix_end(prefix), lock_handle);
+}
+
+QueryPlan Ledger::plan_query(const std::string &collection,
+                             const json::Document &predicates,
+                             const std::vector<std::string> &projection,
+                             int32_t limit)
+{
+    QueryPlanner planner;
+    return planner.plan(try_get_collection(collection), predicates, projection, limit);
+}
+
+std::vector<IndexEntry> Ledger::find_covered(const OpContext &op_context,
+                                             const std::string &collection,
+                                             const json::Document &predicates,
+                                             const QueryPlan &plan)
+{
+    if(!plan.covering || plan.index_steps.size() != 1)
+    {
+        throw std::runtime_error("Query plan is not covering");
+    }
+
+    auto index = plan.index_steps.front().index;
+
+    std::vector<IndexEntry> entries;
+    json::Document view(predicates, index->paths());
+    index->find_entries(view, entries);
+
+    std::vector<IndexEntry> result;
+    CompiledPredicates compiled(predicates);
+
+    for(auto &entry : entries)
+    {
+        if(plan.limit > 0 && result.size() >= static_cast<size_t>(plan.limit))
+        {
+            break;
+        }
+
+        if(entry.has_policy)
+        {
+            // Policies can depend on anything, so we have to go through the ledger here
+            LockHandle lock_handle(*this);
+            event_id_t eid;
+            auto hdl = get_latest_version(op_context, collection, entry.key, "", eid, lock_handle, LockType::Read);
+
+            if(!hdl.valid())
+            {
+                continue;
+            }
+
+            auto value = hdl.value();
+            
+            if(compiled.matches(value))
+            {
+                result.emplace_back(IndexEntry{entry.key, eid, true, json::Document(value, index->covered_paths()).duplicate()});
+            }
+        }
+        else if(compiled.matches(entry.value))
+        {
+            result.emplace_back(std::move(entry));
+        }
+    }
+
+    return result;
+}
+
+json::Document Ledger::explain(const std::string &collection,
+                               const json::Document &predicates,
+                               const std::vector<std::string> &projection,
+                               int32_t limit)
+{
+    return plan_query(collection, predicates, projection, limit).to_document();
+}
+
 ObjectIterator
 Ledger::iterate(const OpContext &op_context, const std::string &collection, const std::string &key, const std::string &path, LockHandle *lock_handle)
 {
@@ -1168,6 +2316,12 @@ void Ledger::load_metadata(bitstream &input)
         shard->load_metadata(input);
     }
 
+    // Secondary indexes have to be populated again
+    for(auto &it : m_collections)
+    {
+        it.second.build_secondary_indexes(m_enclave, *this);
+    }
+
     log_info("Ledger metadata loaded");
 }
 
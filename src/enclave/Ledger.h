@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <list>
 #include <queue>
+#include <functional>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -27,9 +28,75 @@ namespace trusted
 
 class Shard;
 class Index;
+class Aggregation;
+struct QueryPlan;
+struct IndexEntry;
 
 constexpr shard_id_t NUM_SHARDS = 64;
 
+/// Linear scans over collections with at least this many objects are split up and run on the worker pool
+constexpr size_t PARALLEL_SCAN_THRESHOLD = 10000;
+
+/// An object returned by a query
+struct ScanResult
+{
+    std::string key;
+    event_id_t eid;
+
+    /// The (projected) value of the object
+    json::Document value;
+};
+
+/// Describes how to attach the objects of another collection to query results (see Ledger::find_join)
+struct LookupJoin
+{
+    /// Path in the query results that references the other objects
+    std::string local_path;
+
+    std::string foreign_collection;
+
+    /// Path of the foreign objects that has to equal the referenced value. If empty, the referenced value is a key.
+    std::string foreign_path;
+
+    /// Field of the result that will hold the array of referenced objects
+    std::string into;
+};
+
+/**
+ * A consistent view of the ledger at some point in time (see Ledger::get_snapshot)
+ *
+ * Stores the position the next event of every shard will be written to. All earlier events are part of the snapshot.
+ */
+class LedgerSnapshot
+{
+public:
+    LedgerSnapshot() : m_heads(NUM_SHARDS, INVALID_EVENT) {}
+
+    void set_head(const event_id_t &head)
+    {
+        if(head.shard >= NUM_SHARDS)
+        {
+            throw std::runtime_error("Invalid snapshot: no such shard");
+        }
+
+        m_heads[head.shard] = head;
+    }
+
+    const std::vector<event_id_t>& heads() const { return m_heads; }
+
+    /**
+     * Was the event written before the snapshot was taken?
+     */
+    bool contains(const event_id_t &eid) const
+    {
+        auto &head = m_heads[eid.shard];
+        return eid.block < head.block || (eid.block == head.block && eid.index < head.index);
+    }
+
+private:
+    std::vector<event_id_t> m_heads;
+};
+
 class LockHandle;
 
 class Enclave;
@@ -78,6 +145,39 @@ public:
                    const std::string &path = "",
                    LockHandle *lock_handle_ = nullptr);
 
+    /**
+     * Insert or update several objects at once
+     *
+     * Objects are grouped by shard. Every shard is locked only once for its part of the batch,
+     * and its pending block is written to disk once instead of after every object.
+     * If a key appears more than once, the writes are applied in order (the last one wins).
+     *
+     * @return the event id of every write, in the same order as objects (INVALID_EVENT if the write was rejected)
+     */
+    std::vector<event_id_t> put_many(const OpContext &op_context,
+                                     const std::string &collection,
+                                     std::vector<std::pair<std::string, json::Document>> &objects,
+                                     LockHandle *lock_handle_ = nullptr);
+
+    /**
+     * Insert a large number of new objects into a collection without a policy
+     *
+     * Meant for importing data. Large imports can be split into several batches.
+     * The load holds the write locks of all shards it touches for the duration of a batch.
+     * There is no collection policy, so none has to be evaluated for the individual objects.
+     * Objects are still written one at a time, but the pending blocks and the nodes of the primary index
+     * are only written to disk once per batch. If the collection was empty, secondary indexes
+     * are (re)built after the batch; otherwise they are updated as the objects are inserted.
+     * Apart from that, the ledger looks exactly as if the objects had been inserted one by one using put().
+     *
+     * @param objects
+     *      Objects with keys that don't exist in the collection yet (in any order, without duplicates).
+     *      Nothing is written if any of the objects is invalid.
+     * @return the event id of every object, in the same order as objects
+     */
+    std::vector<event_id_t> bulk_load(const OpContext &op_context,
+                                      const std::string &collection,
+                                      std::vector<std::pair<std::string, json::Document>> &objects);
 
     /**
      * Mark an object as deleted
@@ -126,6 +226,159 @@ public:
                             const json::Document &predicates = json::Document(""),
                             LockHandle *lock_handle = nullptr);
 
+    /**
+     * Execute a query using a plan generated by the QueryPlanner
+     *
+     * @note the plan must have been generated for this collection and set of predicates
+     */
+    ObjectListIterator find(const OpContext &op_context,
+                            const std::string &collection,
+                            const json::Document &predicates,
+                            const QueryPlan &plan,
+                            LockHandle *lock_handle = nullptr);
+
+    /**
+     * Iterate over all objects with start_key <= key < end_key in lexicographic order
+     *
+     * @param end_key
+     *      The (exclusive) upper bound. Empty if there is none.
+     * @note This looks at every key of the collection unless it has an ordered index (see create_ordered_index)
+     */
+    ObjectListIterator scan(const OpContext &op_context,
+                            const std::string &collection,
+                            const std::string &start_key,
+                            const std::string &end_key,
+                            LockHandle *lock_handle = nullptr);
+
+    /**
+     * Iterate over all objects whose key starts with prefix in lexicographic order
+     */
+    ObjectListIterator scan_prefix(const OpContext &op_context,
+                                   const std::string &collection,
+                                   const std::string &prefix,
+                                   LockHandle *lock_handle = nullptr);
+
+    /**
+     * Pick the cheapest way to answer a query (see QueryPlanner)
+     */
+    QueryPlan plan_query(const std::string &collection,
+                         const json::Document &predicates,
+                         const std::vector<std::string> &projection = {},
+                         int32_t limit = -1);
+
+    /**
+     * Answer a query using only the values stored in a covering index
+     *
+     * @note the plan must be covering (see QueryPlan::covering)
+     * @return at most plan.limit entries; their values contain all covered paths
+     */
+    std::vector<IndexEntry> find_covered(const OpContext &op_context,
+                                         const std::string &collection,
+                                         const json::Document &predicates,
+                                         const QueryPlan &plan);
+
+    /**
+     * Should the plan be executed using find_parallel/count_parallel?
+     *
+     * This is the case for linear scans of large collections if there are worker threads
+     */
+    bool use_parallel_scan(const std::string &collection, const QueryPlan &plan);
+
+    /**
+     * Find objects by splitting a linear scan into disjoint parts that run concurrently on the worker pool
+     *
+     * @param limit
+     *      The maximum number of results (or -1 for no limit)
+     * @return the same objects, and in the same order, as a linear scan using find()
+     */
+    std::vector<ScanResult> find_parallel(const OpContext &op_context,
+                                          const std::string &collection,
+                                          const json::Document &predicates,
+                                          const std::vector<std::string> &projection = {},
+                                          int32_t limit = -1);
+
+    /**
+     * Read the latest versions of several objects at once
+     *
+     * Keys are grouped by shard, so that every shard is locked only once
+     *
+     * @param snapshot
+     *      If set, read the versions that were current when the snapshot was taken
+     * @return one entry per key, in the same order. Objects that don't exist or can't be accessed have an invalid event id.
+     */
+    std::vector<ScanResult> get_many(const OpContext &op_context,
+                                     const std::string &collection,
+                                     const std::vector<std::string> &keys,
+                                     const std::string &path = "",
+                                     LockHandle *lock_handle = nullptr,
+                                     const LedgerSnapshot *snapshot = nullptr);
+
+    /**
+     * Remember the current state of the ledger
+     *
+     * Shards are only locked while their positions are recorded. Reads at the snapshot never see
+     * a transaction partially and never block writers for longer than a regular read.
+     */
+    LedgerSnapshot get_snapshot();
+
+    /**
+     * Find objects and attach the objects of another collection that they reference
+     *
+     * Every distinct referenced value is only looked up once. Key lookups are batched using get_many.
+     *
+     * @param limit
+     *      The maximum number of results (or -1 for no limit)
+     */
+    std::vector<ScanResult> find_join(const OpContext &op_context,
+                                      const std::string &collection,
+                                      const json::Document &predicates,
+                                      const std::vector<std::string> &projection,
+                                      int32_t limit,
+                                      const LookupJoin &join);
+
+    /**
+     * Find objects ordered by the value at a path (see ResultSorter)
+     *
+     * @param sort
+     *      The path to order by, optionally prefixed with '-' for descending order
+     * @param limit
+     *      The maximum number of results (or -1 for no limit). Only the best limit objects are kept while scanning.
+     * @param lock_handle
+     *      Locks held by the caller (if any). The scan won't be parallelized if this is set.
+     */
+    std::vector<ScanResult> find_sorted(const OpContext &op_context,
+                                        const std::string &collection,
+                                        const json::Document &predicates,
+                                        const std::vector<std::string> &projection,
+                                        const std::string &sort,
+                                        int32_t limit = -1,
+                                        LockHandle *lock_handle = nullptr);
+
+    /**
+     * Count objects using a parallel linear scan (see find_parallel)
+     */
+    uint32_t count_parallel(const OpContext &op_context,
+                            const std::string &collection,
+                            const json::Document &predicates);
+
+    /**
+     * Feed all objects matching the predicates into an aggregation
+     *
+     * Uses covering indexes or index counts when possible, so that objects don't need to be read
+     */
+    void aggregate(const OpContext &op_context,
+                   const std::string &collection,
+                   const json::Document &predicates,
+                   Aggregation &aggregation);
+
+    /**
+     * Describe how a query would be executed (without executing it)
+     */
+    json::Document explain(const std::string &collection,
+                           const json::Document &predicates,
+                           const std::vector<std::string> &projection = {},
+                           int32_t limit = -1);
+
     bool set_trigger(const std::string &collection, remote_party_id identifier);
     bool unset_trigger(const std::string &collection, remote_party_id identifier);
     void remove_triggers_for(remote_party_id identifier);
@@ -161,7 +414,19 @@ public:
               version_number_t version1,
               version_number_t version2);
 
-    bool create_index(const std::string &collection, const std::string &name, const std::vector<std::string> &paths);
+    /**
+     * Keep the keys of a collection in order, so that scans don't need to look at all keys
+     *
+     * Existing keys are added in the background. Scans use the index once that is done.
+     *
+     * @return false if the collection already has an ordered index or has more than OrderedKeyIndex::MAX_KEYS objects
+     */
+    bool create_ordered_index(const std::string &collection);
+
+    bool create_index(const std::string &collection,
+                      const std::string &name,
+                      const std::vector<std::string> &paths,
+                      const std::vector<std::string> &include = {});
     bool drop_index(const std::string &collection, const std::string &name);
 
     bool clear(const OpContext &op_context, const std::string &collection);
@@ -179,6 +444,19 @@ public:
                             LockType lock_type,
                             OperationType access_type = OperationType::GetObject);
 
+    /**
+     * Like get_latest_version, but ignores all events that are not part of the snapshot
+     *
+     * @note the caller must hold a read lock to the object's shard
+     */
+    ObjectEventHandle get_snapshot_version(const OpContext &op_context,
+                            const std::string &collection,
+                            const std::string &key,
+                            const std::string &path,
+                            const LedgerSnapshot &snapshot,
+                            event_id_t &id,
+                            LockHandle &lock_handle);
+
     shard_id_t get_shard(const std::string &collection, const std::string &key);
 
     const std::unordered_map<std::string, Collection> &collections() const;
@@ -222,6 +500,10 @@ public:
                              OperationType op_type,
                              LockHandle *lock_handle_);
 
+    /**
+     * @param in_batch
+     *      If set, the caller writes the pending block to disk and notifies triggers once the entire batch is done (see put_many)
+     */
     event_id_t apply_write(const OpContext &op_context,
                        const std::string &collection,
                        const std::string &key,
@@ -229,13 +511,25 @@ public:
                        const std::string &path,
                        LockHandle *lock_handle_,
                        OperationType op_type,
-                       ledger_pos_t transaction_ref);
+                       ledger_pos_t transaction_ref,
+                       bool in_batch = false);
 
     Collection &get_collection(const std::string &name, bool create = false);
 
     ledger_pos_t get_transaction_ref(const event_id_t &eid);
 
 private:
+    /// How much of the bookkeeping of a write put_next_version takes care of itself
+    enum class WriteMode
+    {
+        /// Write the pending block to disk and notify triggers
+        Single,
+        /// The caller writes the pending block to disk and notifies triggers (see put_many)
+        Batch,
+        /// Like Batch, but secondary indexes are not updated and index pages are not written either (see bulk_load)
+        BulkLoad
+    };
+
     ObjectEventHandle get_event(const event_id_t &eid, LockHandle &lock_handle, LockType lock_type);
 
     Enclave &m_enclave;
@@ -244,6 +538,7 @@ private:
     friend class Transaction;
     friend class LockHandle;
     friend class ObjectListIterator;
+    friend class OrderedKeyIndexBuilder;
 
     ObjectEventHandle get_previous_event(shard_id_t shard_no,
                             const ObjectEventHandle &current,
@@ -263,6 +558,28 @@ private:
                           LockHandle &lock_handle,
                           LockType lock_type);
 
+    /**
+     * Try to count the objects matching the predicates without reading any of them
+     *
+     * @return false if the count can't be answered from the collection's counters and indexes
+     */
+    bool count_from_indexes(Collection &col, const json::Document &predicates, size_t &out);
+
+    /**
+     * Split a linear scan of the collection into num_parts disjoint ranges of buckets and process them on the worker pool
+     *
+     * @param func
+     *      Called once for every part with an iterator over the matching objects of that part
+     */
+    void scan_in_parts(const OpContext &op_context,
+                       Collection &col,
+                       const std::string &collection,
+                       const json::Document &predicates,
+                       size_t num_parts,
+                       const std::function<void(size_t, ObjectListIterator&)> &func);
+
+    size_t num_scan_parts();
+
     event_id_t put_tombstone(const OpContext &op_context,
                              const event_id_t &previous_id,
                              LockHandle &lock_handle,
@@ -276,7 +593,8 @@ private:
                                 event_id_t previous_id,
                                 const ObjectEventHandle &previous_version,
                                 LockHandle &lock_handle,
-                                ledger_pos_t transaction_ref);
+                                ledger_pos_t transaction_ref,
+                                WriteMode mode = WriteMode::Single);
 
     Collection *try_get_collection(const std::string &name);
 
@@ -13,7 +13,7 @@ inline bool Ledger::is_valid_key(const std::string &str)
 
     for(auto c : str)
     {
-        if(!isalnum(c) && c != '_')
+        if(!isalnum(c) && c != '_' && c != '/')
             return false;
     }
 
@@ -240,6 +240,25 @@ void LockHandle::release_shard(shard_id_t shard_no, LockType lock_type)
     }
 }
 
+std::vector<shard_id_t> LockHandle::held_shards() const
+{
+    // Children acquire all their locks through the parent
+    if(m_parent)
+    {
+        return m_parent->held_shards();
+    }
+
+    std::vector<shard_id_t> result;
+    result.reserve(m_locks.size());
+
+    for(auto &it : m_locks)
+    {
+        result.push_back(it.first);
+    }
+
+    return result;
+}
+
 PageHandle<LedgerBlock> LockHandle::get_block(shard_id_t shard_no, block_id_t block, LockType lock_type)
 {
     auto &s = get_shard(shard_no, lock_type);
@@ -5,6 +5,7 @@
 
 #include <unordered_map>
 #include <stdexcept>
+#include <vector>
 
 #include "PageHandle.h"
 #include "Shard.h"
@@ -87,6 +88,11 @@ public:
 
     size_t num_locks() const;
 
+    /**
+     * All shards that are locked by this handle or its parents
+     */
+    std::vector<shard_id_t> held_shards() const;
+
     void set_blocking(bool val);
 
 private:
@@ -279,13 +279,28 @@ MultiMap::iterator_t MultiMap::begin() { return { *this, 0 }; }
 
 MultiMap::iterator_t MultiMap::end() { return { *this, NUM_BUCKETS }; }
 
-void MultiMap::insert(const KeyType &key, const ValueType &value)
+bool MultiMap::insert(const KeyType &key, const ValueType &value, bool check_duplicates)
 {
     auto b = to_bucket(key);
     auto &s = get_shard(b);
 
     WriteLock lock(s.mutex);
 
+    if(check_duplicates)
+    {
+        auto node = get_node(b, false, lock);
+
+        while(node)
+        {
+            if(node->has_entry(key, value))
+            {
+                return false;
+            }
+
+            node = get_successor(b, node, false, lock);
+        }
+    }
+
     auto node = get_node(b, true, lock);
 
     bool created = false;
@@ -301,6 +316,8 @@ void MultiMap::insert(const KeyType &key, const ValueType &value)
     }
 
     m_size++;
+
+    return true;
 }
 
 void MultiMap::clear()
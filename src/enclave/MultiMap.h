@@ -67,7 +67,16 @@ public:
     bool remove(const KeyType &key, const ValueType &value);
     iterator_t begin();
     iterator_t end();
-    void insert(const KeyType &key, const ValueType &value);
+
+    /**
+     * Add a new entry to the map
+     *
+     * @param check_duplicates
+     *      Scan the bucket for the exact same entry first. Only needed while the entry might be inserted twice,
+     *      e.g. by both a writer and an IndexBuilder.
+     * @return false if the exact same entry already existed
+     */
+    bool insert(const KeyType &key, const ValueType &value, bool check_duplicates = true);
     void clear();
 
 private:
@@ -21,6 +21,13 @@ public:
     virtual ~ObjectKeyProvider();
     virtual bool get_next_key(std::string &identifier) = 0;
     virtual size_t count_rest() = 0;
+
+    /**
+     * Release all locks held by the provider until the next call to get_next_key
+     *
+     * Used by cursors that are kept open between requests
+     */
+    virtual void suspend() {}
 };
 
 // TODO: maybe provide better key providers for other indexes and remove this in the future?
@@ -28,6 +28,18 @@ ObjectListIterator::ObjectListIterator(ObjectListIterator &&other) noexcept
 {
 }
 
+void ObjectListIterator::suspend()
+{
+    m_lock_handle.clear();
+    m_current_block = INVALID_BLOCK;
+    m_current_shard = -1;
+
+    if(m_keys)
+    {
+        m_keys->suspend();
+    }
+}
+
 event_id_t ObjectListIterator::next(std::string &key, ObjectEventHandle &res)
 {
     res.clear();
@@ -64,7 +76,7 @@ event_id_t ObjectListIterator::next(std::string &key, ObjectEventHandle &res)
         m_current_block = eid.block;
         auto view = res.value();
 
-        if(!view.matches_predicates(m_predicates))
+        if(!m_predicates.matches(view))
         {
             ++cnt;
             res.clear();
@@ -10,6 +10,7 @@
 #include "OpContext.h"
 #include "ObjectIterator.h"
 #include "ObjectKeyProvider.h"
+#include "predicates.h"
 
 namespace credb::trusted
 {
@@ -34,12 +35,22 @@ public:
      */
     event_id_t next(std::string &key, ObjectEventHandle &res);
 
+    /**
+     * Release all locks held by this iterator
+     *
+     * Iteration continues with the next call to next(). Handles returned earlier must not be used anymore.
+     * This allows keeping an iterator open between requests (see QueryCursor).
+     *
+     * @note the iterator must not have a parent lock handle
+     */
+    void suspend();
+
 private:
     const OpContext &m_context;
     const std::string m_collection;
 
-    // Shouldn't be modified except by move constructor
-    json::Document m_predicates;
+    // Compiled once, so that checking an object doesn't need to parse the predicates again
+    CompiledPredicates m_predicates;
 
     Ledger &m_ledger;
     LockHandle m_lock_handle;
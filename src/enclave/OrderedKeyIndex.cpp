@@ -0,0 +1,126 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "OrderedKeyIndex.h"
+#include "logging.h"
+
+namespace credb::trusted
+{
+
+OrderedKeyIndex::RangeKeyProvider::RangeKeyProvider(OrderedKeyIndex &index, std::string start, std::string end)
+    : m_index(index), m_start(std::move(start)), m_end(std::move(end)), m_started(false)
+{
+}
+
+bool OrderedKeyIndex::RangeKeyProvider::get_next_key(std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_index.m_mutex);
+    auto &keys = m_index.m_keys;
+
+    auto it = m_started ? keys.upper_bound(m_last_key) : keys.lower_bound(m_start);
+
+    if(it == keys.end() || (!m_end.empty() && *it >= m_end))
+    {
+        return false;
+    }
+
+    m_started = true;
+    m_last_key = *it;
+    key = *it;
+    return true;
+}
+
+size_t OrderedKeyIndex::RangeKeyProvider::count_rest()
+{
+    std::lock_guard<std::mutex> lock(m_index.m_mutex);
+    auto &keys = m_index.m_keys;
+
+    auto first = m_started ? keys.upper_bound(m_last_key) : keys.lower_bound(m_start);
+    auto last = m_end.empty() ? keys.end() : keys.lower_bound(m_end);
+
+    size_t count = 0;
+
+    for(auto it = first; it != last && it != keys.end(); ++it)
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+bool OrderedKeyIndex::insert(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(m_full)
+    {
+        return false;
+    }
+
+    if(m_keys.size() >= MAX_KEYS && m_keys.find(key) == m_keys.end())
+    {
+        log_warning("Ordered index exceeds " + std::to_string(MAX_KEYS) + " keys. Disabling it.");
+
+        m_full = true;
+        m_keys.clear();
+        return false;
+    }
+
+    m_keys.insert(key);
+    return true;
+}
+
+void OrderedKeyIndex::remove(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys.erase(key);
+}
+
+void OrderedKeyIndex::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys.clear();
+}
+
+size_t OrderedKeyIndex::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_keys.size();
+}
+
+void OrderedKeyIndex::finish_build()
+{
+    m_ready = true;
+}
+
+void OrderedKeyIndex::dump_metadata(bitstream &output)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    output << m_keys.size();
+
+    for(auto &key : m_keys)
+    {
+        output << key;
+    }
+}
+
+void OrderedKeyIndex::load_metadata(bitstream &input)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys.clear();
+
+    size_t num_keys;
+    input >> num_keys;
+
+    for(size_t i = 0; i < num_keys; ++i)
+    {
+        std::string key;
+        input >> key;
+        m_keys.insert(m_keys.end(), std::move(key));
+    }
+
+    m_full = false;
+    m_ready = true;
+}
+
+} // namespace credb::trusted
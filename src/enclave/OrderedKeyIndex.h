@@ -0,0 +1,101 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <atomic>
+#include <bitstream.h>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "ObjectKeyProvider.h"
+
+namespace credb::trusted
+{
+
+/**
+ * Keeps the keys of all objects in a collection in lexicographic order
+ *
+ * The primary index is a hash map, so this is needed to answer range and prefix scans
+ * without looking at every key in the collection.
+ *
+ * All keys are kept in enclave memory and are written with the collection's metadata.
+ * Therefore, the index is limited to MAX_KEYS keys. Once a collection grows beyond that,
+ * the index is disabled (and not persisted) and scans look at all keys again.
+ *
+ * A new index is populated in the background (see OrderedKeyIndexBuilder).
+ * It must not be used for scans before is_ready() returns true.
+ */
+class OrderedKeyIndex
+{
+public:
+    /// Maximum number of keys in the index
+    static constexpr size_t MAX_KEYS = 100000;
+
+    /**
+     * Iterates over all keys in [start, end)
+     * Keys are looked up one at a time, so concurrent inserts and removes are fine.
+     */
+    class RangeKeyProvider : public ObjectKeyProvider
+    {
+    public:
+        RangeKeyProvider(OrderedKeyIndex &index, std::string start, std::string end);
+
+        bool get_next_key(std::string &key) override;
+        size_t count_rest() override;
+
+    private:
+        OrderedKeyIndex &m_index;
+
+        /// Inclusive lower bound
+        const std::string m_start;
+
+        /// Exclusive upper bound (empty if unbounded)
+        const std::string m_end;
+
+        bool m_started;
+        std::string m_last_key;
+    };
+
+    /**
+     * @return false if the index is full (it will be disabled in that case)
+     */
+    bool insert(const std::string &key);
+
+    void remove(const std::string &key);
+    void clear();
+
+    size_t size() const;
+
+    /**
+     * All keys that existed when the index was created have been added
+     */
+    void finish_build();
+
+    /**
+     * Can the index be used for scans?
+     */
+    bool is_ready() const { return m_ready && !m_full; }
+
+    /**
+     * Did the collection outgrow the index?
+     */
+    bool is_full() const { return m_full; }
+
+    void dump_metadata(bitstream &output);
+
+    /**
+     * @note the loaded index is ready right away
+     */
+    void load_metadata(bitstream &input);
+
+private:
+    mutable std::mutex m_mutex;
+    std::set<std::string> m_keys;
+
+    std::atomic<bool> m_ready = false;
+    std::atomic<bool> m_full = false;
+};
+
+} // namespace credb::trusted
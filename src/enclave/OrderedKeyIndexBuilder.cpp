@@ -0,0 +1,96 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "OrderedKeyIndexBuilder.h"
+#include "Collection.h"
+#include "Ledger.h"
+#include "LockHandle.h"
+#include "OrderedKeyIndex.h"
+#include "logging.h"
+
+namespace credb::trusted
+{
+
+OrderedKeyIndexBuilder::OrderedKeyIndexBuilder(Enclave &enclave, Ledger &ledger, Collection &collection, std::string collection_name, OrderedKeyIndex &index)
+    : Task(enclave), m_ledger(ledger), m_collection(collection),
+      m_collection_name(std::move(collection_name)), m_index(index)
+{
+    Task::setup_thread();
+}
+
+void OrderedKeyIndexBuilder::handle_op_response()
+{
+    log_warning("OrderedKeyIndexBuilder does not send any requests");
+}
+
+void OrderedKeyIndexBuilder::resume()
+{
+    lock();
+    Task::switch_into_thread();
+    unlock();
+}
+
+void OrderedKeyIndexBuilder::work()
+{
+    while(process_batch())
+    {
+        // Give writers (and other requests) a chance to run
+        suspend();
+    }
+
+    mark_done();
+}
+
+bool OrderedKeyIndexBuilder::process_batch()
+{
+    if(m_index.is_full())
+    {
+        log_debug("Ordered index of " + m_collection_name + " is full. Stopping build.");
+        return false;
+    }
+
+    std::vector<std::string> keys;
+
+    {
+        // Only hold the primary index' locks while collecting the keys
+        HashMap::iterator_t it(m_collection.primary_index(), m_next_bucket);
+        auto current_bucket = it.bucket();
+
+        // Never stop in the middle of a bucket
+        while(!it.at_end() && (keys.size() < BATCH_SIZE || it.bucket() == current_bucket))
+        {
+            current_bucket = it.bucket();
+            keys.push_back(it.key());
+            ++it;
+        }
+
+        m_next_bucket = it.at_end() ? HashMap::NUM_BUCKETS : it.bucket();
+    }
+
+    for(auto &key : keys)
+    {
+        // Holding the shard lock serializes us with writers to this object
+        // Either they see the key we add, or we see the version they wrote
+        LockHandle lock_handle(m_ledger);
+        lock_handle.get_shard(m_ledger.get_shard(m_collection_name, key), LockType::Read);
+
+        event_id_t eid;
+        auto hdl = m_ledger.get_latest_event(m_collection_name, key, eid, lock_handle, LockType::Read);
+
+        if(hdl.valid() && hdl.get_type() == ObjectEventType::NewVersion && !m_index.insert(key))
+        {
+            return false;
+        }
+    }
+
+    if(m_next_bucket >= HashMap::NUM_BUCKETS)
+    {
+        m_index.finish_build();
+        log_debug("Finished building ordered index of " + m_collection_name);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace credb::trusted
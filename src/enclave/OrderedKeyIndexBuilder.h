@@ -0,0 +1,56 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include "Task.h"
+#include "HashMap.h"
+
+namespace credb::trusted
+{
+
+class Ledger;
+class Collection;
+class OrderedKeyIndex;
+
+/**
+ * Adds the keys of all existing objects to a newly created ordered index in the background
+ *
+ * Works like the IndexBuilder: the primary index is scanned in batches of buckets,
+ * and concurrent writes maintain the ordered index themselves.
+ * The build stops early if the collection outgrows the index.
+ */
+class OrderedKeyIndexBuilder : public Task
+{
+public:
+    /// Approximate number of keys to add before yielding
+    static constexpr size_t BATCH_SIZE = 1000;
+
+    OrderedKeyIndexBuilder(Enclave &enclave, Ledger &ledger, Collection &collection, std::string collection_name, OrderedKeyIndex &index);
+
+    void handle_op_response() override;
+
+    void resume() override;
+
+protected:
+    void work() override;
+
+private:
+    /**
+     * Add the keys of the next batch of objects
+     *
+     * @return false if the index is complete (or full)
+     */
+    bool process_batch();
+
+    Ledger &m_ledger;
+    Collection &m_collection;
+
+    const std::string m_collection_name;
+
+    OrderedKeyIndex &m_index;
+
+    HashMap::bucketid_t m_next_bucket = 0;
+};
+
+} // namespace credb::trusted
@@ -0,0 +1,41 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include "PendingMessage.h"
+#include "Transaction.h"
+
+namespace credb
+{
+namespace trusted
+{
+
+/**
+ * The answer of a participant to a TransactionPrepare request
+ */
+class PendingVoteResponse : public PendingMessage
+{
+public:
+    PendingVoteResponse(operation_id_t msg_id, Peer &peer)
+    : PendingMessage(msg_id, peer)
+    {
+    }
+
+    PrepareVote result() const
+    {
+        return m_vote;
+    }
+
+protected:
+    void parse(bitstream &msg) override
+    {
+        msg >> reinterpret_cast<uint8_t&>(m_vote);
+    }
+
+private:
+    PrepareVote m_vote = PrepareVote::Abort;
+};
+
+}
+} // namespace credb
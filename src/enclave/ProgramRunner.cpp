@@ -24,45 +24,56 @@ ProgramRunner::ProgramRunner(Enclave &enclave,
                              identity_uid_t transaction_root,
                              transaction_id_t transaction_id)
 : Task(enclave), m_op_context(enclave.identity(), collection + "/" + program_name),
-  m_lock_handle(enclave.ledger()), m_data(std::move(data)), m_interpreter(m_data, m_mem)
+  m_collection(collection), m_program_name(program_name), m_args(args),
+  m_transaction_root(transaction_root), m_transaction_id(transaction_id),
+  m_lock_handle(enclave.ledger()), m_data(std::move(data))
 {
-    auto &ledger = enclave.ledger();
-    const bool is_transaction = (transaction_id != INVALID_TRANSACTION_ID);
+    setup_interpreter();
+    Task::setup_thread();
+}
+
+void ProgramRunner::setup_interpreter()
+{
+    // Make sure the old interpreter and everything it references is gone first
+    m_result = nullptr;
+    m_interpreter.reset();
+
+    m_data.move_to(0);
+    m_interpreter = std::make_unique<cow::Interpreter>(m_data, m_mem);
+
+    auto &ledger = m_enclave.ledger();
+    const bool is_transaction = (m_transaction_id != INVALID_TRANSACTION_ID);
 
     if(is_transaction)
     {
 #ifndef IS_TEST
-        auto &tx_mgr = enclave.transaction_manager();
-        auto transaction = tx_mgr.init_remote_transaction(transaction_root, transaction_id, IsolationLevel::Serializable);
+        auto &tx_mgr = m_enclave.transaction_manager();
+        auto transaction = tx_mgr.init_remote_transaction(m_transaction_root, m_transaction_id, IsolationLevel::Serializable);
 
-        auto tx_hook = cow::make_value<bindings::Transaction>(m_interpreter.memory_manager(), ledger, enclave, *this, transaction, m_lock_handle);
+        auto tx_hook = cow::make_value<bindings::Transaction>(m_interpreter->memory_manager(), ledger, m_enclave, *this, transaction, m_lock_handle);
 
-        m_interpreter.set_module("db", tx_hook);
+        m_interpreter->set_module("db", tx_hook);
 #else
-        (void)transaction_root;
-        (void)transaction_id;
         throw std::runtime_error("No remote transaction_support in test");
 #endif
     }
     else
     {
-        auto db_hook = cow::make_value<bindings::Database>(m_interpreter.memory_manager(), m_op_context, ledger, enclave, this, m_lock_handle);
-        m_interpreter.set_module("db", db_hook);
+        auto db_hook = cow::make_value<bindings::Database>(m_interpreter->memory_manager(), m_op_context, ledger, m_enclave, this, m_lock_handle);
+        m_interpreter->set_module("db", db_hook);
     }
 
-    auto op_ctx_hook = cow::make_value<bindings::OpContext>(m_interpreter.memory_manager(), m_op_context);
+    auto op_ctx_hook = cow::make_value<bindings::OpContext>(m_interpreter->memory_manager(), m_op_context);
 
-    m_interpreter.set_list("argv", args);
-    m_interpreter.set_module("op_context", op_ctx_hook);
+    m_interpreter->set_list("argv", m_args);
+    m_interpreter->set_module("op_context", op_ctx_hook);
 
-    if(!program_name.empty())
+    if(!m_program_name.empty())
     {
         auto object_hook =
-        cow::make_value<bindings::Object>(m_interpreter.memory_manager(), m_op_context, ledger, collection, program_name, m_lock_handle);
-        m_interpreter.set_module("self", object_hook);
+        cow::make_value<bindings::Object>(m_interpreter->memory_manager(), m_op_context, ledger, m_collection, m_program_name, m_lock_handle);
+        m_interpreter->set_module("self", object_hook);
     }
-
-    Task::setup_thread();
 }
 
 ProgramRunner::~ProgramRunner() = default;
@@ -95,27 +106,52 @@ void ProgramRunner::run()
 
 void ProgramRunner::work()
 {
-    try
-    {
-        m_result = m_interpreter.execute();
-    }
-    catch(std::system_error &e)
-    {
-        // unexpected error
-        log_fatal( e.what() );
-    }
-    catch(std::exception &e)
+    auto &contention = m_enclave.transaction_manager().contention();
+
+    while(true)
     {
-        if(has_errors())
+        try
+        {
+            m_result = m_interpreter->execute();
+        }
+        catch(transaction_conflict_error &e)
+        {
+            m_attempt += 1;
+
+            if(m_attempt < ContentionManager::MAX_ATTEMPTS)
+            {
+                // Run the whole program again
+                contention.record_retry(m_attempt);
+                ContentionManager::backoff(m_attempt);
+
+                m_lock_handle.clear();
+                setup_interpreter();
+                continue;
+            }
+
+            m_errors = "Transaction failed after " + std::to_string(m_attempt) + " attempts: " + e.what();
+            log_debug("Program errors: " + m_errors);
+        }
+        catch(std::system_error &e)
         {
-            m_errors = m_errors + "\n" + e.what();
+            // unexpected error
+            log_fatal( e.what() );
         }
-        else
+        catch(std::exception &e)
         {
-            m_errors = e.what();
+            if(has_errors())
+            {
+                m_errors = m_errors + "\n" + e.what();
+            }
+            else
+            {
+                m_errors = e.what();
+            }
+
+            log_debug("Program errors: " + m_errors);
         }
 
-        log_debug("Program errors: " + m_errors);
+        break;
     }
 
     m_lock_handle.clear();
@@ -9,6 +9,7 @@
 #include "Transaction.h"
 
 #include <cowlang/Interpreter.h>
+#include <memory>
 #include <thread>
 
 namespace credb
@@ -54,20 +55,41 @@ public:
         return m_op_context;
     }
 
+    /**
+     * How often the program has been run again because one of its transactions lost a conflict
+     */
+    uint32_t attempt() const
+    {
+        return m_attempt;
+    }
+
 protected:
     void work() override;
 
 private:
+    /**
+     * (Re-)create the interpreter and its modules
+     */
+    void setup_interpreter();
+
     std::string m_errors;
 
     const OpContext m_op_context;
 
+    const std::string m_collection;
+    const std::string m_program_name;
+    const std::vector<std::string> m_args;
+    const identity_uid_t m_transaction_root;
+    const transaction_id_t m_transaction_id;
+
     LockHandle m_lock_handle;
 
     bitstream m_data;
 
+    uint32_t m_attempt = 0;
+
     cow::DummyMemoryManager m_mem;
-    cow::Interpreter m_interpreter;
+    std::unique_ptr<cow::Interpreter> m_interpreter;
     cow::ValuePtr m_result = nullptr;
 };
 
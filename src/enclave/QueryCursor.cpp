@@ -0,0 +1,97 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "QueryCursor.h"
+
+#ifdef FAKE_ENCLAVE
+#include "../server/FakeEnclave.h"
+#else
+#include "Enclave_t.h"
+#endif
+
+#include "Ledger.h"
+
+namespace credb::trusted
+{
+
+QueryCursor::QueryCursor(const OpContext &op_context,
+                         Ledger &ledger,
+                         const std::string &collection,
+                         const json::Document &predicates,
+                         std::vector<std::string> projection,
+                         int32_t limit)
+    : m_context(op_context.duplicate()), m_iterator(ledger.find(m_context, collection, predicates)),
+      m_projection(std::move(projection)), m_remaining(limit), m_done(false), m_last_used(current_time())
+{
+}
+
+uint64_t QueryCursor::current_time()
+{
+    uint64_t result = 0;
+    ::get_current_time(&result);
+    return result;
+}
+
+bool QueryCursor::write_batch(bitstream &output, uint32_t batch_size)
+{
+    m_last_used = current_time();
+
+    uint32_t size = 0;
+    uint32_t size_pos = output.pos();
+    output << size;
+
+    std::string key;
+    ObjectEventHandle hdl;
+
+    while(!m_done && size < batch_size)
+    {
+        if(m_remaining == 0)
+        {
+            m_done = true;
+            break;
+        }
+
+        auto eid = m_iterator.next(key, hdl);
+
+        if(!hdl.valid())
+        {
+            m_done = true;
+            break;
+        }
+
+        output << key << eid;
+
+        json::Document value = hdl.value();
+
+        if(m_projection.empty())
+        {
+            output << value;
+        }
+        else
+        {
+            json::Document filtered(value, m_projection);
+            output << filtered;
+        }
+
+        size += 1;
+
+        if(m_remaining > 0)
+        {
+            m_remaining -= 1;
+            m_done = (m_remaining == 0);
+        }
+    }
+
+    // Don't block writers while waiting for the client to ask for the next batch
+    hdl.clear();
+    m_iterator.suspend();
+
+    uint32_t end_pos = output.pos();
+    output.move_to(size_pos);
+    output << size;
+    output.move_to(end_pos);
+
+    return !m_done;
+}
+
+} // namespace credb::trusted
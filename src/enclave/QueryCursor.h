@@ -0,0 +1,72 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <bitstream.h>
+
+#include "ObjectListIterator.h"
+#include "OpContext.h"
+
+namespace credb::trusted
+{
+
+class Ledger;
+
+using cursor_id_t = uint32_t;
+
+/**
+ * The state of a find operation whose results are sent to the client in batches
+ *
+ * No locks are held between two batches, so concurrent writes might (or might not) be reflected in later batches.
+ */
+class QueryCursor
+{
+public:
+    /// Cursors that have not been used for this long (in milliseconds) get closed
+    static constexpr uint64_t IDLE_TIMEOUT = 10 * 60 * 1000;
+
+    QueryCursor(const OpContext &op_context,
+                Ledger &ledger,
+                const std::string &collection,
+                const json::Document &predicates,
+                std::vector<std::string> projection,
+                int32_t limit);
+
+    QueryCursor(const QueryCursor &other) = delete;
+
+    /**
+     * Write the next (up to) batch_size objects using the same format as a find response
+     *
+     * @return false if the cursor is exhausted
+     */
+    bool write_batch(bitstream &output, uint32_t batch_size);
+
+    bool is_idle(uint64_t now) const
+    {
+        return now >= m_last_used + IDLE_TIMEOUT;
+    }
+
+    /**
+     * Milliseconds since an arbitrary point in time (as reported by the untrusted part)
+     */
+    static uint64_t current_time();
+
+private:
+    /// The iterator refers to this, so it needs to live as long as the cursor
+    const OpContext m_context;
+
+    ObjectListIterator m_iterator;
+    const std::vector<std::string> m_projection;
+
+    /// How many more objects may be returned (-1 if there is no limit)
+    int32_t m_remaining;
+
+    bool m_done;
+    uint64_t m_last_used;
+};
+
+} // namespace credb::trusted
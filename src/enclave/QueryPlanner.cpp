@@ -0,0 +1,353 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "QueryPlanner.h"
+#include "Collection.h"
+#include "Index.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <set>
+
+namespace credb::trusted
+{
+
+json::Document QueryPlan::to_document() const
+{
+    json::Writer writer;
+    writer.start_map();
+
+    if(is_linear_scan())
+    {
+        writer.write_string("strategy", "linear_scan");
+    }
+    else if(covering)
+    {
+        writer.write_string("strategy", "covering_index");
+    }
+    else if(index_steps.size() == 1)
+    {
+        writer.write_string("strategy", "index_lookup");
+    }
+    else
+    {
+        writer.write_string("strategy", "index_intersection");
+    }
+
+    writer.start_array("indexes");
+    for(auto &step : index_steps)
+    {
+        writer.start_map();
+        writer.write_string("name", step.index->name());
+
+        writer.start_array("paths");
+        for(auto &path : step.index->paths())
+        {
+            writer.write_string(path);
+        }
+        writer.end_array();
+
+        writer.start_array("covered_paths");
+        for(auto &path : step.index->covered_paths())
+        {
+            writer.write_string(path);
+        }
+        writer.end_array();
+
+        writer.write_integer("estimated_keys", step.estimated_keys);
+        step.index->statistics().write(writer, "statistics");
+        writer.end_map();
+    }
+    writer.end_array();
+
+    writer.start_array("residual_predicates");
+    for(auto &predicate : residual_predicates)
+    {
+        writer.write_string(predicate);
+    }
+    writer.end_array();
+
+    writer.start_array("projection");
+    for(auto &path : projection)
+    {
+        writer.write_string(path);
+    }
+    writer.end_array();
+
+    writer.write_integer("limit", limit);
+    writer.write_integer("num_objects", num_objects);
+    writer.write_float("estimated_fetches", estimated_fetches);
+    writer.write_float("estimated_results", estimated_results);
+    writer.write_float("estimated_cost", estimated_cost);
+    writer.end_map();
+
+    return writer.make_document();
+}
+
+QueryPlan QueryPlanner::plan(Collection *collection,
+                             const json::Document &predicates,
+                             const std::vector<std::string> &projection,
+                             int32_t limit) const
+{
+    QueryPlan result;
+    result.projection = projection;
+    result.limit = limit;
+
+    if(collection == nullptr)
+    {
+        // Nothing to find
+        return result;
+    }
+
+    result.num_objects = collection->num_objects();
+
+    // Find all indexes that can help with the query
+    std::set<std::string> paths;
+    std::vector<QueryPlan::index_step_t> usable;
+
+    for(auto &it : collection->secondary_indexes())
+    {
+        auto index = it.second;
+        bool contains = true;
+
+        for(auto &p : index->paths())
+        {
+            if(paths.find(p) == paths.end())
+            {
+                contains = false;
+            }
+        }
+
+        // Already covered by other indexes (or still being built)
+        if(contains || !index->is_ready() || !index->matches_query(predicates))
+        {
+            continue;
+        }
+
+        json::Document view(predicates, index->paths());
+
+        if(view.empty())
+        {
+            continue;
+        }
+
+        if(view.get_size() > 1)
+        {
+            throw std::runtime_error("Fixme");
+        }
+
+        size_t size = 0;
+
+        if(index->statistics().is_valid())
+        {
+            size = index->estimate_value_count(view);
+        }
+        else
+        {
+            // Not rebuilt since the last restart. Assume a neutral selectivity.
+            size = static_cast<size_t>(DEFAULT_SELECTIVITY * static_cast<double>(result.num_objects));
+        }
+
+        log_debug("estimation: will find " + std::to_string(size) + " keys from index " + index->name());
+
+        usable.push_back({index, size});
+
+        for(auto &p : index->paths())
+        {
+            paths.insert(p);
+        }
+    }
+
+    // the smallest result set should always be the first set in the merged keys
+    std::sort(usable.begin(), usable.end(),
+              [](const auto &lhs, const auto &rhs) { return lhs.estimated_keys < rhs.estimated_keys; });
+
+    std::vector<std::string> predicate_keys;
+
+    if(!predicates.empty() && predicates.get_type() == json::ObjectType::Map)
+    {
+        for(uint32_t pos = 0; pos < predicates.get_size(); ++pos)
+        {
+            predicate_keys.push_back(predicates.get_key(pos));
+        }
+    }
+
+    const double num_objects = static_cast<double>(result.num_objects);
+
+    auto selectivity = [num_objects](const QueryPlan::index_step_t &step) {
+        return num_objects > 0 ? std::min(1.0, static_cast<double>(step.estimated_keys) / num_objects) : 0.0;
+    };
+
+    // Selectivity of all predicates without index support
+    double unindexed_selectivity = 1.0;
+
+    for(auto &key : predicate_keys)
+    {
+        if(paths.find(key) == paths.end())
+        {
+            unindexed_selectivity *= DEFAULT_SELECTIVITY;
+        }
+    }
+
+    // Option 1: linear scan
+    double total_selectivity = unindexed_selectivity;
+
+    for(auto &step : usable)
+    {
+        total_selectivity *= selectivity(step);
+    }
+
+    result.residual_predicates = predicate_keys;
+    estimate_cost(result, total_selectivity);
+
+    auto make_option = [&](std::vector<QueryPlan::index_step_t> steps, bool covering) {
+        QueryPlan option;
+        option.projection = projection;
+        option.limit = limit;
+        option.num_objects = result.num_objects;
+        option.index_steps = std::move(steps);
+        option.covering = covering;
+
+        std::set<std::string> covered;
+
+        for(auto &step : option.index_steps)
+        {
+            for(auto &p : step.index->paths())
+            {
+                covered.insert(p);
+            }
+        }
+
+        for(auto &key : predicate_keys)
+        {
+            if(covered.find(key) == covered.end())
+            {
+                option.residual_predicates.push_back(key);
+            }
+        }
+
+        double residual_selectivity = unindexed_selectivity;
+
+        for(auto &step : usable)
+        {
+            if(std::find_if(option.index_steps.begin(), option.index_steps.end(),
+                            [&step](const auto &s) { return s.index == step.index; }) == option.index_steps.end())
+            {
+                residual_selectivity *= selectivity(step);
+            }
+        }
+
+        estimate_cost(option, residual_selectivity);
+
+        if(option.estimated_cost < result.estimated_cost)
+        {
+            result = std::move(option);
+        }
+    };
+
+    // Option 2: use the first k indexes (ordered by size)
+    for(size_t k = 1; k <= usable.size(); ++k)
+    {
+        make_option(std::vector<QueryPlan::index_step_t>(usable.begin(), usable.begin() + k), false);
+    }
+
+    // Option 3: answer the query from a single covering index
+    for(auto &step : usable)
+    {
+        if(is_covered_by(*step.index, predicate_keys, projection))
+        {
+            make_option({step}, true);
+        }
+    }
+
+    return result;
+}
+
+bool QueryPlanner::is_covered_by(const Index &index,
+                                 const std::vector<std::string> &predicate_keys,
+                                 const std::vector<std::string> &projection) const
+{
+    // We need the entire object if there is no projection
+    if(!index.is_covering() || projection.empty())
+    {
+        return false;
+    }
+
+    for(auto &key : predicate_keys)
+    {
+        if(!index.covers(key))
+        {
+            return false;
+        }
+    }
+
+    for(auto &path : projection)
+    {
+        if(!index.covers(path))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void QueryPlanner::estimate_cost(QueryPlan &plan, double residual_selectivity) const
+{
+    const double num_objects = static_cast<double>(plan.num_objects);
+    double candidates = 0.0;
+    double cost = 0.0;
+
+    if(plan.is_linear_scan())
+    {
+        candidates = num_objects;
+    }
+    else
+    {
+        auto it = plan.index_steps.begin();
+        candidates = static_cast<double>(it->estimated_keys);
+        cost += candidates * COST_INDEX_ENTRY;
+
+        for(++it; it != plan.index_steps.end(); ++it)
+        {
+            cost += candidates * COST_INDEX_PROBE;
+            candidates *= num_objects > 0 ? std::min(1.0, static_cast<double>(it->estimated_keys) / num_objects) : 0.0;
+        }
+    }
+
+    double results = candidates * residual_selectivity;
+    double fetches = candidates;
+
+    if(plan.limit > 0)
+    {
+        // We can stop once we found enough objects
+        if(residual_selectivity > 0.0)
+        {
+            fetches = std::min(fetches, static_cast<double>(plan.limit) / residual_selectivity);
+        }
+
+        results = std::min(results, static_cast<double>(plan.limit));
+    }
+
+    if(plan.covering)
+    {
+        // All entries are decoded, but nothing is read from the ledger
+        cost += candidates * COST_DECODE_ENTRY;
+        fetches = 0.0;
+    }
+    else
+    {
+        if(plan.is_linear_scan())
+        {
+            cost += fetches * COST_SCAN_KEY;
+        }
+
+        cost += fetches * COST_FETCH_OBJECT;
+    }
+
+    plan.estimated_fetches = fetches;
+    plan.estimated_results = results;
+    plan.estimated_cost = cost;
+}
+
+} // namespace credb::trusted
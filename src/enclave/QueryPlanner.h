@@ -0,0 +1,117 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+namespace credb::trusted
+{
+
+class Collection;
+class Index;
+
+/**
+ * Describes how a query on a collection will be answered
+ */
+struct QueryPlan
+{
+    struct index_step_t
+    {
+        std::shared_ptr<Index> index;
+
+        /// Estimated number of keys returned by this index
+        size_t estimated_keys;
+    };
+
+    /**
+     * The indexes that will be used (in order)
+     * The first lookup produces the candidate set, all following ones intersect with it.
+     * If this is empty, a linear scan over the primary index is performed.
+     */
+    std::vector<index_step_t> index_steps;
+
+    /**
+     * Top-level predicates that are not answered by any of the indexes
+     *
+     * @note Candidates are always checked against the full predicate, because hash indexes only compare hashes
+     */
+    std::vector<std::string> residual_predicates;
+
+    std::vector<std::string> projection;
+    int32_t limit = -1;
+
+    /**
+     * The query can be answered using only the values stored in the (single) covering index
+     * No objects need to be read from the ledger.
+     */
+    bool covering = false;
+
+    /// Number of objects in the collection when the plan was created
+    size_t num_objects = 0;
+
+    /// Estimated number of objects that need to be read from the ledger
+    double estimated_fetches = 0.0;
+
+    /// Estimated number of objects in the result
+    double estimated_results = 0.0;
+
+    /// Estimated cost (in units of COST_FETCH_OBJECT)
+    double estimated_cost = 0.0;
+
+    bool is_linear_scan() const { return index_steps.empty(); }
+
+    /**
+     * Serialize the plan (used by explain)
+     */
+    json::Document to_document() const;
+};
+
+/**
+ * Picks the cheapest way to answer a query using the statistics of each index
+ */
+class QueryPlanner
+{
+public:
+    /// Reading and decoding an object from the ledger
+    static constexpr double COST_FETCH_OBJECT = 1.0;
+
+    /// Moving to the next key of the primary index
+    static constexpr double COST_SCAN_KEY = 0.05;
+
+    /// Reading an entry while looking up a value in an index
+    static constexpr double COST_INDEX_ENTRY = 0.05;
+
+    /// Checking whether a candidate is contained in another index (requires walking a bucket chain)
+    static constexpr double COST_INDEX_PROBE = 0.5;
+
+    /// Decoding the values stored in an entry of a covering index
+    static constexpr double COST_DECODE_ENTRY = 0.1;
+
+    /// Assumed selectivity of a predicate that no index helps with
+    static constexpr double DEFAULT_SELECTIVITY = 0.1;
+
+    QueryPlan plan(Collection *collection,
+                   const json::Document &predicates,
+                   const std::vector<std::string> &projection = {},
+                   int32_t limit = -1) const;
+
+private:
+    /**
+     * Can the index answer the query without reading the objects?
+     */
+    bool is_covered_by(const Index &index,
+                       const std::vector<std::string> &predicate_keys,
+                       const std::vector<std::string> &projection) const;
+
+    /**
+     * Estimate the cost of the plan and fill in the estimates
+     */
+    void estimate_cost(QueryPlan &plan, double residual_selectivity) const;
+};
+
+} // namespace credb::trusted
@@ -46,6 +46,28 @@ std::vector<std::tuple<std::string, std::string, uint16_t>> RemoteParties::get_p
     return result;
 }
 
+void RemoteParties::release_idle_resources()
+{
+    std::vector<std::shared_ptr<RemoteParty>> parties;
+
+    {
+        ReadLock lock(m_lockable);
+
+        for(auto &[id, rp] : m_remote_parties)
+        {
+            (void)id;
+            parties.push_back(rp);
+        }
+    }
+
+    // Don't hold the lock while closing cursors so connections can be set up in the meantime
+    for(auto &rp : parties)
+    {
+        rp->close_idle_cursors();
+        rp->release_idle_snapshots();
+    }
+}
+
 bool RemoteParties::handle_message(remote_party_id identifier, const uint8_t *data, size_t len)
 {
     auto rp = find<RemoteParty>(identifier);
@@ -82,6 +82,14 @@ public:
 
     void handle_disconnect(remote_party_id local_id);
 
+    /**
+     * Close idle cursors and release idle snapshots of all remote parties
+     *
+     * Called periodically (see Enclave::run_maintenance), so the state of connections that
+     * are not used anymore gets cleaned up as well.
+     */
+    void release_idle_resources();
+
     const std::unordered_set<remote_party_id> &get_downstream_set() const;
     void add_downstream_server(remote_party_id downstream_id);
 
@@ -2,8 +2,11 @@
 /// This file is part of the CreDB Project. See LICENSE for more information.
 
 #include "RemoteParty.h"
+#include "Aggregation.h"
 #include "Enclave.h"
+#include "Index.h"
 #include "Ledger.h"
+#include "QueryPlanner.h"
 #include "TransactionProxy.h"
 #include "PendingBitstreamResponse.h"
 #include "RemoteParties.h"
@@ -26,6 +29,48 @@
 namespace credb::trusted
 {
 
+/**
+ * Write the (projected) objects returned by an iterator, prefixed by their number
+ */
+inline void write_objects(bitstream &output, ObjectListIterator &it, const std::vector<std::string> &projection, int32_t limit)
+{
+    uint32_t size = 0;
+    uint32_t size_pos = output.pos();
+    output << size;
+
+    std::string key;
+    ObjectEventHandle hdl;
+
+    auto eid = it.next(key, hdl);
+
+    for(; hdl.valid(); eid = it.next(key, hdl))
+    {
+        size += 1;
+        output << key << eid;
+
+        json::Document value = hdl.value();
+        if(!projection.empty())
+        {
+            json::Document filtered(value, projection);
+            output << filtered;
+        }
+        else
+        {
+            output << value;
+        }
+
+        if(limit > 0 && size == static_cast<uint32_t>(limit))
+        {
+            break;
+        }
+    }
+
+    uint32_t end_pos = output.pos();
+    output.move_to(size_pos);
+    output << size;
+    output.move_to(end_pos);
+}
+
 RemoteParty::RemoteParty(Enclave &enclave, remote_party_id identifier)
 : m_enclave(enclave), m_remote_parties(m_enclave.remote_parties()), m_ledger(m_enclave.ledger()),
   m_task_manager(m_enclave.task_manager()), m_local_identifier(identifier), m_identity(nullptr)
@@ -41,6 +86,52 @@ RemoteParty::~RemoteParty()
 RemoteParty::~RemoteParty() = default;
 #endif
 
+void RemoteParty::close_idle_cursors()
+{
+    const auto now = QueryCursor::current_time();
+    std::vector<std::unique_ptr<QueryCursor>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(m_cursor_mutex);
+
+        for(auto it = m_cursors.begin(); it != m_cursors.end();)
+        {
+            if(it->second->is_idle(now))
+            {
+                expired.emplace_back(std::move(it->second));
+                it = m_cursors.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    if(!expired.empty())
+    {
+        log_debug("Closed " + std::to_string(expired.size()) + " idle cursor(s)");
+    }
+}
+
+void RemoteParty::release_idle_snapshots()
+{
+    const auto now = QueryCursor::current_time();
+    std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+
+    for(auto it = m_snapshots.begin(); it != m_snapshots.end();)
+    {
+        if(now >= it->second.last_used + SNAPSHOT_IDLE_TIMEOUT)
+        {
+            it = m_snapshots.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
 #ifdef FAKE_ENCLAVE
 credb_status_t RemoteParty::decrypt(const uint8_t *in_data, uint32_t in_len, bitstream &inner)
 {
@@ -305,6 +396,11 @@ void RemoteParty::handle_request_downstream_mode(bitstream &input,
         handle_request_get_object(input, op_context, output, false);
         break;
     }
+    case OperationType::GetObjects:
+    {
+        handle_request_get_objects(input, op_context, output, false);
+        break;
+    }
     case OperationType::HasObject:
     {
         handle_request_has_object(input, op_context, output);
@@ -340,6 +436,8 @@ void RemoteParty::handle_request_downstream_mode(bitstream &input,
     case OperationType::DiffVersions:
     case OperationType::AddToObject:
     case OperationType::PutObject:
+    case OperationType::PutObjects:
+    case OperationType::BulkLoad:
     case OperationType::PutObjectWithoutKey:
     case OperationType::CreateIndex:
     case OperationType::CountObjects:
@@ -348,6 +446,17 @@ void RemoteParty::handle_request_downstream_mode(bitstream &input,
     case OperationType::Clear:
     case OperationType::GetObjectHistory: // TODO handle downstream
     case OperationType::FindObjects: // TODO handle downstream
+    case OperationType::ExplainQuery:
+    case OperationType::CreateOrderedIndex:
+    case OperationType::ScanObjects:
+    case OperationType::OpenCursor:
+    case OperationType::FetchCursor:
+    case OperationType::CloseCursor:
+    case OperationType::Aggregate:
+    case OperationType::LookupObjects:
+    case OperationType::GetSnapshot: // Reads at a snapshot must go to the ledger it was taken from
+    case OperationType::GetObjectsAtSnapshot:
+    case OperationType::ReleaseSnapshot:
     case OperationType::ExecuteTransaction:
     case OperationType::OrderEvents: // TODO handle downstream
     {
@@ -482,6 +591,37 @@ void RemoteParty::handle_request_upstream_mode(bitstream &input,
         writer.write_integer("num_files", eio.num_files());
         writer.write_integer("total_file_size", eio.total_file_size());
         writer.write_integer("num_collections", m_ledger.num_collections());
+
+        size_t filter_negatives = 0;
+        size_t filter_false_positives = 0;
+
+        writer.start_map("index_build_progress");
+
+        for(auto &[name, collection] : m_ledger.collections())
+        {
+            filter_negatives += collection.primary_index().num_filter_negatives();
+            filter_false_positives += collection.primary_index().num_filter_false_positives();
+
+            for(auto &[index_name, index] : collection.secondary_indexes())
+            {
+                if(!index->is_ready())
+                {
+                    writer.write_float(name + "." + index_name, index->build_progress());
+                }
+            }
+        }
+
+        writer.end_map();
+
+        // Fraction of lookups for missing keys that the Bloom filters could not rule out
+        const auto num_misses = filter_negatives + filter_false_positives;
+        const double false_positive_rate = num_misses > 0 ? static_cast<double>(filter_false_positives) / static_cast<double>(num_misses) : 0.0;
+
+        writer.write_integer("index_filter_negatives", filter_negatives);
+        writer.write_integer("index_filter_false_positives", filter_false_positives);
+        writer.write_float("index_filter_false_positive_rate", false_positive_rate);
+
+        m_enclave.transaction_manager().contention().write(writer, "transactions");
         writer.end_map();
 
         output << writer.make_document();
@@ -681,6 +821,65 @@ void RemoteParty::handle_request_upstream_mode(bitstream &input,
         output << event_id;
         break;
     }
+    case OperationType::PutObjects:
+    {
+        std::string collection;
+        uint32_t num_objects = 0;
+        input >> collection >> num_objects;
+
+        std::vector<std::pair<std::string, json::Document>> objects;
+        objects.reserve(num_objects);
+
+        for(uint32_t i = 0; i < num_objects; ++i)
+        {
+            std::string key;
+            input >> key;
+            objects.emplace_back(std::move(key), json::Document(input));
+        }
+
+        auto event_ids = m_ledger.put_many(op_context, collection, objects);
+        output << static_cast<uint32_t>(event_ids.size());
+
+        for(auto &eid : event_ids)
+        {
+            output << eid;
+        }
+
+        break;
+    }
+    case OperationType::BulkLoad:
+    {
+        std::string collection;
+        uint32_t num_objects = 0;
+        input >> collection >> num_objects;
+
+        std::vector<std::pair<std::string, json::Document>> objects;
+        objects.reserve(num_objects);
+
+        for(uint32_t i = 0; i < num_objects; ++i)
+        {
+            std::string key;
+            input >> key;
+            objects.emplace_back(std::move(key), json::Document(input));
+        }
+
+        try
+        {
+            auto event_ids = m_ledger.bulk_load(op_context, collection, objects);
+            output << true << static_cast<uint32_t>(event_ids.size());
+
+            for(auto &eid : event_ids)
+            {
+                output << eid;
+            }
+        }
+        catch(std::runtime_error &e)
+        {
+            output << false << std::string(e.what());
+        }
+
+        break;
+    }
     case OperationType::RemoveObject:
     {
         std::string collection, key;
@@ -733,6 +932,37 @@ void RemoteParty::handle_request_upstream_mode(bitstream &input,
         handle_request_get_object(input, op_context, output, false);
         break;
     }
+    case OperationType::GetObjects:
+    {
+        handle_request_get_objects(input, op_context, output, false);
+        break;
+    }
+    case OperationType::GetObjectsAtSnapshot:
+    {
+        handle_request_get_objects(input, op_context, output, true);
+        break;
+    }
+    case OperationType::GetSnapshot:
+    {
+        auto snapshot = std::make_shared<const LedgerSnapshot>(m_ledger.get_snapshot());
+        const auto now = QueryCursor::current_time();
+
+        std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+        auto snapshot_id = m_next_snapshot_id++;
+        m_snapshots.emplace(snapshot_id, open_snapshot_t{std::move(snapshot), now});
+
+        output << snapshot_id;
+        break;
+    }
+    case OperationType::ReleaseSnapshot:
+    {
+        snapshot_id_t snapshot_id;
+        input >> snapshot_id;
+
+        std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+        output << (m_snapshots.erase(snapshot_id) > 0);
+        break;
+    }
     case OperationType::GetObjectWithWitness:
     {
         handle_request_get_object(input, op_context, output, true);
@@ -747,12 +977,87 @@ void RemoteParty::handle_request_upstream_mode(bitstream &input,
         output << m_ledger.count_objects(op_context, collection, predicates);
         break;
     }
+    case OperationType::ExplainQuery:
+    {
+        std::string collection;
+        json::Document predicates("");
+        std::vector<std::string> projection;
+        int32_t limit;
+
+        input >> collection >> predicates >> projection >> limit;
+
+        output << m_ledger.explain(collection, predicates, projection, limit);
+        break;
+    }
+    case OperationType::Aggregate:
+    {
+        std::string collection, group_by;
+        json::Document predicates(""), aggregates("");
+
+        input >> collection >> predicates >> aggregates >> group_by;
+
+        try
+        {
+            Aggregation aggregation(aggregates, group_by);
+            m_ledger.aggregate(op_context, collection, predicates, aggregation);
+
+            output << true << aggregation.result();
+        }
+        catch(std::runtime_error &e)
+        {
+            output << false << std::string(e.what());
+        }
+        break;
+    }
+    case OperationType::LookupObjects:
+    {
+        std::string collection;
+        json::Document predicates("");
+        std::vector<std::string> projection;
+        int32_t limit;
+        LookupJoin join;
+
+        input >> collection >> predicates >> projection >> limit;
+        input >> join.local_path >> join.foreign_collection >> join.foreign_path >> join.into;
+
+        if(limit == 0)
+        {
+            log_fatal("Got invalid value for limit");
+        }
+
+        std::vector<ScanResult> objects;
+
+        try
+        {
+            objects = m_ledger.find_join(op_context, collection, predicates, projection, limit, join);
+        }
+        catch(std::runtime_error &e)
+        {
+            log_error(std::string("Lookup failed: ") + e.what());
+        }
+
+        output << static_cast<uint32_t>(objects.size());
+
+        for(auto &obj : objects)
+        {
+            output << obj.key << obj.eid << obj.value;
+        }
+
+        break;
+    }
     case OperationType::CreateIndex:
     {
         std::string collection, name;
-        std::vector<std::string> paths;
-        input >> collection >> name >> paths;
-        output << m_ledger.create_index(collection, name, paths);
+        std::vector<std::string> paths, include;
+        input >> collection >> name >> paths >> include;
+        output << m_ledger.create_index(collection, name, paths, include);
+        break;
+    }
+    case OperationType::CreateOrderedIndex:
+    {
+        std::string collection;
+        input >> collection;
+        output << m_ledger.create_ordered_index(collection);
         break;
     }
     case OperationType::DropIndex:
@@ -775,51 +1080,188 @@ void RemoteParty::handle_request_upstream_mode(bitstream &input,
         json::Document predicates("");
         std::vector<std::string> projection;
         int32_t limit;
+        std::string sort;
 
-        input >> collection >> predicates >> projection >> limit;
+        input >> collection >> predicates >> projection >> limit >> sort;
 
         if(limit == 0)
         {
             log_fatal("Got invalid value for limit");
         }
 
-        auto it = m_ledger.find(op_context, collection, predicates);
+        if(!sort.empty())
+        {
+            std::vector<ScanResult> objects;
+
+            try
+            {
+                objects = m_ledger.find_sorted(op_context, collection, predicates, projection, sort, limit);
+            }
+            catch(std::runtime_error &e)
+            {
+                log_error(std::string("Sorted find failed: ") + e.what());
+            }
 
-        uint32_t size = 0;
-        uint32_t size_pos = output.pos();
-        output << size;
+            output << static_cast<uint32_t>(objects.size());
 
-        std::string key;
-        ObjectEventHandle hdl;
+            for(auto &obj : objects)
+            {
+                output << obj.key << obj.eid << obj.value;
+            }
 
-        auto eid = it.next(key, hdl);
+            break;
+        }
 
-        for(; hdl.valid(); eid = it.next(key, hdl))
+        auto plan = m_ledger.plan_query(collection, predicates, projection, limit);
+
+        if(plan.covering)
         {
-            size += 1;
-            output << key << eid;
+            // Answer directly from the index without reading any objects
+            auto entries = m_ledger.find_covered(op_context, collection, predicates, plan);
+            output << static_cast<uint32_t>(entries.size());
 
-            json::Document value = hdl.value();
-            if(!projection.empty())
+            for(auto &entry : entries)
             {
-                json::Document filtered(value, projection);
-                output << filtered;
+                json::Document filtered(entry.value, projection);
+                output << entry.key << entry.eid << filtered;
             }
-            else
+
+            break;
+        }
+
+        if(m_ledger.use_parallel_scan(collection, plan))
+        {
+            auto objects = m_ledger.find_parallel(op_context, collection, predicates, projection, limit);
+            output << static_cast<uint32_t>(objects.size());
+
+            for(auto &obj : objects)
+            {
+                output << obj.key << obj.eid << obj.value;
+            }
+
+            break;
+        }
+
+        auto it = m_ledger.find(op_context, collection, predicates, plan);
+        write_objects(output, it, projection, limit);
+        break;
+    }
+    case OperationType::OpenCursor:
+    {
+        std::string collection;
+        json::Document predicates("");
+        std::vector<std::string> projection;
+        int32_t limit;
+        uint32_t batch_size;
+
+        input >> collection >> predicates >> projection >> limit >> batch_size;
+
+        if(limit == 0 || batch_size == 0)
+        {
+            log_error("Got invalid value for limit or batch size");
+            output << false;
+            break;
+        }
+
+        close_idle_cursors();
+
+        std::unique_ptr<QueryCursor> cursor(new QueryCursor(op_context, m_ledger, collection, predicates, std::move(projection), limit));
+        cursor_id_t cursor_id;
+
+        {
+            std::lock_guard<std::mutex> lock(m_cursor_mutex);
+            cursor_id = m_next_cursor_id++;
+        }
+
+        output << true << cursor_id;
+        bool has_more = cursor->write_batch(output, batch_size);
+        output << has_more;
+
+        if(has_more)
+        {
+            std::lock_guard<std::mutex> lock(m_cursor_mutex);
+            m_cursors.emplace(cursor_id, std::move(cursor));
+        }
+
+        break;
+    }
+    case OperationType::FetchCursor:
+    {
+        cursor_id_t cursor_id;
+        uint32_t batch_size;
+
+        input >> cursor_id >> batch_size;
+
+        close_idle_cursors();
+
+        std::unique_ptr<QueryCursor> cursor;
+
+        {
+            std::lock_guard<std::mutex> lock(m_cursor_mutex);
+            auto it = m_cursors.find(cursor_id);
+
+            if(it != m_cursors.end())
             {
-                output << value;
+                cursor = std::move(it->second);
+                m_cursors.erase(it);
             }
+        }
+
+        if(!cursor || batch_size == 0)
+        {
+            output << false;
+            break;
+        }
+
+        output << true << cursor_id;
+        bool has_more = cursor->write_batch(output, batch_size);
+        output << has_more;
+
+        if(has_more)
+        {
+            std::lock_guard<std::mutex> lock(m_cursor_mutex);
+            m_cursors.emplace(cursor_id, std::move(cursor));
+        }
+
+        break;
+    }
+    case OperationType::CloseCursor:
+    {
+        cursor_id_t cursor_id;
+        input >> cursor_id;
+
+        std::unique_ptr<QueryCursor> cursor;
 
-            if(limit > 0 && size == static_cast<uint32_t>(limit))
+        {
+            std::lock_guard<std::mutex> lock(m_cursor_mutex);
+            auto it = m_cursors.find(cursor_id);
+
+            if(it != m_cursors.end())
             {
-                break;
+                cursor = std::move(it->second);
+                m_cursors.erase(it);
             }
         }
 
-        uint32_t end_pos = output.pos();
-        output.move_to(size_pos);
-        output << size;
-        output.move_to(end_pos);
+        // the cursor is destroyed outside of the critical section
+        output << static_cast<bool>(cursor);
+        break;
+    }
+    case OperationType::ScanObjects:
+    {
+        std::string collection, start_key, end_key;
+        std::vector<std::string> projection;
+        int32_t limit;
+
+        input >> collection >> start_key >> end_key >> projection >> limit;
+
+        if(limit == 0)
+        {
+            log_fatal("Got invalid value for limit");
+        }
+
+        auto it = m_ledger.scan(op_context, collection, start_key, end_key);
+        write_objects(output, it, projection, limit);
         break;
     }
     case OperationType::TransactionAbort:
@@ -867,10 +1309,22 @@ void RemoteParty::handle_request_upstream_mode(bitstream &input,
                 log_fatal("Cannot prepare: not a remote transaction");
             }
 
-            bool res = false;
+            PrepareVote vote = PrepareVote::Abort;
 
             try {
-                res = tx->prepare(generate_witness);
+                if(tx->prepare(generate_witness))
+                {
+                    if(tx->is_read_only() && !generate_witness)
+                    {
+                        // Nothing to write, so the outcome of the transaction doesn't matter to us
+                        tx->commit(false);
+                        vote = PrepareVote::ReadOnly;
+                    }
+                    else
+                    {
+                        vote = PrepareVote::Commit;
+                    }
+                }
             }
             catch(std::runtime_error &e) {
                 log_debug(e.what());
@@ -879,11 +1333,18 @@ void RemoteParty::handle_request_upstream_mode(bitstream &input,
                 // not an error, but we need to abort
             }
 
-            output << res;
+            // The root never contacts participants that voted abort again (presumed abort),
+            // so give up our locks now. A failed prepare already did that.
+            if(vote == PrepareVote::Abort && !tx->is_done())
+            {
+                tx->abort();
+            }
+
+            output << static_cast<uint8_t>(vote);
         }
         else
         {
-            output << false;
+            output << static_cast<uint8_t>(PrepareVote::Abort);
         }
 
         break;
@@ -1086,4 +1547,57 @@ void RemoteParty::handle_request_get_object(bitstream &input, const OpContext &o
     }
 }
 
+void RemoteParty::handle_request_get_objects(bitstream &input, const OpContext &op_context, bitstream &output, bool at_snapshot)
+{
+    std::string collection;
+    std::vector<std::string> keys;
+    input >> collection >> keys;
+
+    std::vector<ScanResult> objects;
+
+    if(at_snapshot)
+    {
+        snapshot_id_t snapshot_id;
+        input >> snapshot_id;
+
+        std::shared_ptr<const LedgerSnapshot> snapshot;
+
+        {
+            std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+            auto it = m_snapshots.find(snapshot_id);
+
+            if(it != m_snapshots.end())
+            {
+                snapshot = it->second.snapshot;
+                it->second.last_used = QueryCursor::current_time();
+            }
+        }
+
+        if(!snapshot)
+        {
+            // The client will notice that the result is incomplete
+            log_debug("No such snapshot: " + std::to_string(snapshot_id));
+            output << static_cast<uint32_t>(0);
+            return;
+        }
+
+        objects = m_ledger.get_many(op_context, collection, keys, "", nullptr, snapshot.get());
+    }
+    else
+    {
+        objects = m_ledger.get_many(op_context, collection, keys);
+    }
+    output << static_cast<uint32_t>(objects.size());
+
+    for(auto &obj : objects)
+    {
+        output << obj.eid;
+
+        if(obj.eid)
+        {
+            output << obj.value;
+        }
+    }
+}
+
 } // namespace credb::trusted
@@ -13,12 +13,15 @@
 #endif
 
 #include "OpContext.h"
+#include "QueryCursor.h"
 #include "util/OperationType.h"
 #include "util/MessageType.h"
 #include "util/defines.h"
 #include "util/status.h"
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <bitstream.h>
 
 namespace credb::trusted
@@ -29,6 +32,9 @@ class Enclave;
 class RemoteParties;
 class TaskManager;
 class Ledger;
+class LedgerSnapshot;
+
+using snapshot_id_t = uint32_t;
 
 class RemoteParty : public std::enable_shared_from_this<RemoteParty>
 {
@@ -96,6 +102,16 @@ public:
      */
     void disconnect();
 
+    /**
+     * Close all cursors of this remote party that have not been used for a while
+     */
+    void close_idle_cursors();
+
+    /**
+     * Release all snapshots of this remote party that have not been used for a while
+     */
+    void release_idle_snapshots();
+
 protected:
     void set_identity(const std::string &name);
 
@@ -108,6 +124,7 @@ protected:
     void handle_request_has_object(bitstream &input, const OpContext &op_context, bitstream &output);
     void handle_request_check_object(bitstream &input, const OpContext &op_context, bitstream &output);
     void handle_request_get_object(bitstream &input, const OpContext &op_context, bitstream &output, bool generate_witness);
+    void handle_request_get_objects(bitstream &input, const OpContext &op_context, bitstream &output, bool at_snapshot);
 
     void handle_request_upstream_mode(bitstream &input,
                                       const OpContext &op_context,
@@ -148,6 +165,26 @@ private:
     Identity *m_identity;
 
     sgx_ra_context_t m_attestation_context = -1;
+
+    /// Cursors are removed from this map while they are in use
+    std::unordered_map<cursor_id_t, std::unique_ptr<QueryCursor>> m_cursors;
+    cursor_id_t m_next_cursor_id = 1;
+    std::mutex m_cursor_mutex;
+
+    /// A snapshot held on behalf of a snapshot transaction of the remote party
+    struct open_snapshot_t
+    {
+        std::shared_ptr<const LedgerSnapshot> snapshot;
+        uint64_t last_used;
+    };
+
+    /// Snapshots that have not been used for this long (in milliseconds) get released
+    static constexpr uint64_t SNAPSHOT_IDLE_TIMEOUT = 10 * 60 * 1000;
+
+    /// The remote party only knows the identifiers, so it can't read at a position it made up
+    std::unordered_map<snapshot_id_t, open_snapshot_t> m_snapshots;
+    snapshot_id_t m_next_snapshot_id = 1;
+    std::mutex m_snapshot_mutex;
 };
 
 inline bitstream RemoteParty::generate_op_request(taskid_t task_id, operation_id_t op_id, OperationType op_type)
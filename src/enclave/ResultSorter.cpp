@@ -0,0 +1,131 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "ResultSorter.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace credb::trusted
+{
+
+ResultSorter::ResultSorter(const std::string &sort, int32_t limit)
+    : m_path(sort), m_limit(limit)
+{
+    if(!m_path.empty() && m_path[0] == '-')
+    {
+        m_descending = true;
+        m_path = m_path.substr(1);
+    }
+
+    if(m_path.empty())
+    {
+        throw std::runtime_error("Invalid sort order: no path given");
+    }
+}
+
+bool ResultSorter::before(const entry_t &a, const entry_t &b) const
+{
+    if(a.sort_key < b.sort_key)
+    {
+        return !m_descending;
+    }
+    else if(b.sort_key < a.sort_key)
+    {
+        return m_descending;
+    }
+    else
+    {
+        return a.object.key < b.object.key;
+    }
+}
+
+void ResultSorter::add(const std::string &key, event_id_t eid, const json::Document &value, const std::vector<std::string> &projection)
+{
+    entry_t entry;
+
+    if(by_key())
+    {
+        entry.sort_key.type = ScalarValue::Type::String;
+        entry.sort_key.string = key;
+    }
+    else
+    {
+        json::Document view(value, m_path);
+        entry.sort_key = ScalarValue::read(view);
+    }
+
+    entry.object.key = key;
+    entry.object.eid = eid;
+
+    // Check before copying the value, most objects won't make it into the result
+    if(m_limit > 0 && m_entries.size() == static_cast<size_t>(m_limit) && !before(entry, m_entries.front()))
+    {
+        return;
+    }
+
+    if(projection.empty())
+    {
+        entry.object.value = value.duplicate();
+    }
+    else
+    {
+        json::Document filtered(value, projection);
+        entry.object.value = filtered.duplicate();
+    }
+
+    insert(std::move(entry));
+}
+
+void ResultSorter::insert(entry_t &&entry)
+{
+    auto cmp = [this](const entry_t &a, const entry_t &b) { return before(a, b); };
+
+    if(m_limit <= 0)
+    {
+        m_entries.emplace_back(std::move(entry));
+        return;
+    }
+
+    if(m_entries.size() == static_cast<size_t>(m_limit))
+    {
+        if(!before(entry, m_entries.front()))
+        {
+            return;
+        }
+
+        std::pop_heap(m_entries.begin(), m_entries.end(), cmp);
+        m_entries.pop_back();
+    }
+
+    m_entries.emplace_back(std::move(entry));
+    std::push_heap(m_entries.begin(), m_entries.end(), cmp);
+}
+
+void ResultSorter::merge(ResultSorter &other)
+{
+    for(auto &entry : other.m_entries)
+    {
+        insert(std::move(entry));
+    }
+
+    other.m_entries.clear();
+}
+
+std::vector<ScanResult> ResultSorter::result()
+{
+    std::sort(m_entries.begin(), m_entries.end(), [this](const entry_t &a, const entry_t &b) { return before(a, b); });
+
+    std::vector<ScanResult> result;
+    result.reserve(m_entries.size());
+
+    for(auto &entry : m_entries)
+    {
+        result.emplace_back(std::move(entry.object));
+    }
+
+    m_entries.clear();
+    return result;
+}
+
+} // namespace credb::trusted
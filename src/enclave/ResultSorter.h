@@ -0,0 +1,79 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+#include "Ledger.h"
+#include "ScalarValue.h"
+
+namespace credb::trusted
+{
+
+/**
+ * Orders query results by the value at a path
+ *
+ * The sort order is specified as a path, optionally prefixed with '-' for descending order.
+ * The special path SORT_BY_KEY orders by object key. Objects that don't contain the path come first.
+ * Ties are broken by key, so the result is deterministic.
+ *
+ * If a limit is set, only the best limit objects are kept (in a heap) while results are added
+ */
+class ResultSorter
+{
+public:
+    static constexpr const char *SORT_BY_KEY = "$key";
+
+    ResultSorter(const std::string &sort, int32_t limit = -1);
+
+    const std::string &path() const { return m_path; }
+
+    bool descending() const { return m_descending; }
+
+    bool by_key() const { return m_path == SORT_BY_KEY; }
+
+    /**
+     * Add a matching object
+     *
+     * @param projection
+     *      Only keep these fields of the object (if not empty)
+     */
+    void add(const std::string &key, event_id_t eid, const json::Document &value, const std::vector<std::string> &projection);
+
+    /**
+     * Combine with results collected by another sorter with the same sort order and limit
+     */
+    void merge(ResultSorter &other);
+
+    /**
+     * Get all results in order
+     *
+     * @note This empties the sorter
+     */
+    std::vector<ScanResult> result();
+
+private:
+    struct entry_t
+    {
+        ScalarValue sort_key;
+        ScanResult object;
+    };
+
+    /// Does a belong in front of b?
+    bool before(const entry_t &a, const entry_t &b) const;
+
+    void insert(entry_t &&entry);
+
+    std::string m_path;
+    bool m_descending = false;
+    int32_t m_limit;
+
+    /// If there is a limit this is a heap with the last result in front
+    std::vector<entry_t> m_entries;
+};
+
+} // namespace credb::trusted
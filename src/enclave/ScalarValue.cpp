@@ -0,0 +1,181 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "ScalarValue.h"
+
+#include <ctime>
+
+namespace credb::trusted
+{
+
+namespace
+{
+
+/// Reads the value of a document that is not a map or array
+class ScalarReader : public json::Iterator
+{
+public:
+    void handle_datetime(const std::string &key, const tm &value) override
+    {
+        (void)key;
+        (void)value;
+    }
+
+    void handle_string(const std::string &key, const std::string &value) override
+    {
+        (void)key;
+        is_string = true;
+        string = value;
+    }
+
+    void handle_integer(const std::string &key, int64_t value) override
+    {
+        (void)key;
+        is_integer = true;
+        integer = value;
+    }
+
+    void handle_float(const std::string &key, const double value) override
+    {
+        (void)key;
+        is_float = true;
+        floating = value;
+    }
+
+    void handle_boolean(const std::string &key, const bool value) override
+    {
+        (void)key;
+        (void)value;
+    }
+
+    void handle_null(const std::string &key) override { (void)key; }
+
+    void handle_map_start(const std::string &key) override { (void)key; }
+
+    void handle_map_end() override {}
+
+    void handle_array_start(const std::string &key) override { (void)key; }
+
+    void handle_array_end() override {}
+
+    void handle_binary(const std::string &key, const uint8_t *data, uint32_t len) override
+    {
+        (void)key;
+        (void)data;
+        (void)len;
+    }
+
+    bool is_string = false;
+    bool is_integer = false;
+    bool is_float = false;
+
+    std::string string;
+    int64_t integer = 0;
+    double floating = 0.0;
+};
+
+} // namespace
+
+bool ScalarValue::operator<(const ScalarValue &other) const
+{
+    if(type == Type::None || other.type == Type::None)
+    {
+        return type == Type::None && other.type != Type::None;
+    }
+
+    if(is_number() && other.is_number())
+    {
+        if(type == Type::Integer && other.type == Type::Integer)
+        {
+            return integer < other.integer;
+        }
+
+        return as_float() < other.as_float();
+    }
+    else if(is_number() || other.is_number())
+    {
+        return is_number();
+    }
+    else
+    {
+        return string < other.string;
+    }
+}
+
+bool ScalarValue::operator==(const ScalarValue &other) const
+{
+    if(type != other.type)
+    {
+        return false;
+    }
+
+    switch(type)
+    {
+    case Type::Integer:
+        return integer == other.integer;
+    case Type::Float:
+        return floating == other.floating;
+    case Type::String:
+        return string == other.string;
+    default:
+        return true;
+    }
+}
+
+void ScalarValue::write(json::Writer &writer, const std::string &key) const
+{
+    switch(type)
+    {
+    case Type::Integer:
+        writer.write_integer(key, integer);
+        break;
+    case Type::Float:
+        writer.write_float(key, floating);
+        break;
+    case Type::String:
+        writer.write_string(key, string);
+        break;
+    default:
+        writer.write_null(key);
+    }
+}
+
+ScalarValue ScalarValue::read(const json::Document &document)
+{
+    ScalarValue result;
+
+    if(document.empty())
+    {
+        return result;
+    }
+
+    auto type = document.get_type();
+
+    if(type == json::ObjectType::Map || type == json::ObjectType::Array)
+    {
+        return result;
+    }
+
+    ScalarReader reader;
+    document.iterate(reader);
+
+    if(reader.is_integer)
+    {
+        result.type = Type::Integer;
+        result.integer = reader.integer;
+    }
+    else if(reader.is_float)
+    {
+        result.type = Type::Float;
+        result.floating = reader.floating;
+    }
+    else if(reader.is_string)
+    {
+        result.type = Type::String;
+        result.string = reader.string;
+    }
+
+    return result;
+}
+
+} // namespace credb::trusted
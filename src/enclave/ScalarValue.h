@@ -0,0 +1,52 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <string>
+#include <json/json.h>
+
+namespace credb::trusted
+{
+
+/**
+ * A number or string read from a document
+ *
+ * Used where values of objects need to be ordered or combined (e.g. sorting and aggregation)
+ */
+struct ScalarValue
+{
+    enum class Type
+    {
+        /// Missing or not a number/string
+        None,
+        Integer,
+        Float,
+        String
+    };
+
+    Type type = Type::None;
+    json::integer_t integer = 0;
+    json::float_t floating = 0.0;
+    std::string string;
+
+    bool is_number() const { return type == Type::Integer || type == Type::Float; }
+
+    json::float_t as_float() const { return type == Type::Integer ? static_cast<json::float_t>(integer) : floating; }
+
+    /**
+     * Total order: missing values first, then numbers, then strings
+     */
+    bool operator<(const ScalarValue &other) const;
+
+    /**
+     * Values are only equal if they have the same type (i.e., 1 and 1.0 are not)
+     */
+    bool operator==(const ScalarValue &other) const;
+
+    void write(json::Writer &writer, const std::string &key) const;
+
+    static ScalarValue read(const json::Document &document);
+};
+
+} // namespace credb::trusted
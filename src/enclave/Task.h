@@ -33,6 +33,13 @@ public:
 
     virtual void work() = 0;
 
+    /**
+     * Continue a background task that is not driven by operation responses
+     *
+     * @see TaskManager::run_background_task
+     */
+    virtual void resume() {}
+
     void suspend();
 
 protected:
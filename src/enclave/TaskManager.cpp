@@ -29,4 +29,35 @@ void TaskManager::unregister_task(taskid_t identifier)
     }
 }
 
+void TaskManager::register_background_task(std::shared_ptr<Task> task)
+{
+    std::lock_guard<std::mutex> task_lock(m_task_mutex);
+    m_background_tasks.emplace_back(std::move(task));
+}
+
+bool TaskManager::run_background_task()
+{
+    std::unique_lock<std::mutex> task_lock(m_task_mutex);
+
+    if(m_background_tasks.empty())
+    {
+        return false;
+    }
+
+    // Remove the task while it runs so no other thread resumes it concurrently
+    auto task = m_background_tasks.front();
+    m_background_tasks.pop_front();
+
+    task_lock.unlock();
+    task->resume();
+    task_lock.lock();
+
+    if(!task->is_done())
+    {
+        m_background_tasks.emplace_back(std::move(task));
+    }
+
+    return !m_background_tasks.empty();
+}
+
 } // namespace credb::trusted
@@ -24,6 +24,20 @@ public:
     void register_task(std::shared_ptr<Task> task);
     void unregister_task(taskid_t identifier);
 
+    /**
+     * Register a long running task (e.g. an IndexBuilder)
+     *
+     * Background tasks are resumed by the maintenance thread (see Enclave::run_maintenance)
+     */
+    void register_background_task(std::shared_ptr<Task> task);
+
+    /**
+     * Resume the next background task (if any) for a single slice of work
+     *
+     * @return true if there are background tasks left
+     */
+    bool run_background_task();
+
     TaskPtr get_task(taskid_t identifier)
     {
         std::lock_guard<std::mutex> task_lock(m_task_mutex);
@@ -40,6 +54,7 @@ public:
 private:
     Counter<taskid_t> m_tid_counter;
     std::unordered_map<taskid_t, std::shared_ptr<Task>> m_tasks;
+    std::list<std::shared_ptr<Task>> m_background_tasks;
 
     std::mutex m_task_mutex;
 };
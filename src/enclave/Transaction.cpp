@@ -21,7 +21,14 @@ Transaction::Transaction(IsolationLevel isolation, Ledger &ledger_, TransactionL
 {
 }
 
-Transaction::~Transaction() = default;
+Transaction::~Transaction()
+{
+    // Operations live in the arena, so their destructors must be invoked manually
+    for(auto op: m_ops)
+    {
+        op->~operation_info_t();
+    }
+}
 
 void Transaction::init_task(taskid_t tid, const OpContext &context)
 {
@@ -38,6 +45,7 @@ void Transaction::abort()
           || m_state == TransactionState::Prepared)
     {
         m_state = TransactionState::Aborted;
+        m_transaction_mgr.contention().record_abort(m_conflict);
         cleanup();
     }
     else
@@ -48,69 +56,287 @@ void Transaction::abort()
 
 void Transaction::cleanup()
 {
-    if(!m_lock_handle.has_parent()
-       && m_state == TransactionState::Committed)
+    for(auto op: m_ops)
     {
-        for(auto &[shard, lock_type] : m_shard_lock_types)
+        op->~operation_info_t();
+    }
+
+    m_lock_handle.clear();
+    release_locks();
+    m_ops.clear();
+    m_arena.clear();
+    m_transaction_mgr.remove_transaction(*this);
+}
+
+void Transaction::set_read_lock(const std::string &collection, const std::string &full_path, shard_id_t sid)
+{
+    auto [key, path] = parse_path(full_path);
+    (void)path;
+
+    key_lock_t lock;
+    lock.shard = sid;
+    lock.type = LockType::Read;
+
+    m_key_locks.emplace(std::pair(collection, key), lock);
+}
+
+void Transaction::set_write_lock(const std::string &collection, const std::string &full_path, shard_id_t sid)
+{
+    auto [key, path] = parse_path(full_path);
+    (void)path;
+
+    auto &lock = m_key_locks[std::pair(collection, key)];
+    lock.shard = sid;
+    lock.type = LockType::Write;
+
+    m_write_shards.insert(sid);
+}
+
+void Transaction::set_predicate_lock(shard_id_t sid)
+{
+    m_predicate_locks.emplace(sid, false);
+}
+
+void Transaction::set_conflict(const std::string &error, const std::string &collection, const std::string &full_path)
+{
+    auto [key, path] = parse_path(full_path);
+    (void)path;
+
+    set_error(error);
+    m_conflict = true;
+
+    if(!m_conflict_recorded)
+    {
+        m_conflict_recorded = true;
+        m_transaction_mgr.contention().record_conflict(ledger.get_shard(collection, key), collection, key);
+    }
+}
+
+void Transaction::set_conflict(const std::string &error)
+{
+    set_error(error);
+    m_conflict = true;
+}
+
+bool Transaction::acquire_locks()
+{
+    auto &key_locks = m_transaction_mgr.key_locks();
+    auto &commit_tracker = m_transaction_mgr.commit_tracker();
+
+    for(auto &[id, lock] : m_key_locks)
+    {
+        auto &[collection, key] = id;
+
+        if(lock.held && lock.type == LockType::Write && lock.held_type == LockType::Read)
+        {
+            // Upgrade: give up the read lock first, so that we don't conflict with ourselves
+            key_locks.unlock_key(this, lock.shard, collection, key, LockType::Read);
+            lock.held = false;
+        }
+
+        if(!lock.held)
         {
-            if(lock_type == LockType::Write)
+            if(!key_locks.try_lock_key(this, lock.shard, collection, key, lock.type))
             {
-                ledger.organize_ledger(shard);
+                set_conflict("Lock contention", collection, key);
+                return false;
             }
+
+            lock.held = true;
+            lock.held_type = lock.type;
+
+            // The previous holder might still be committing
+            commit_tracker.get_dependencies(collection, key, m_dependencies);
         }
     }
 
-    for(auto op: m_ops)
+    for(auto &[sid, held] : m_predicate_locks)
     {
-        delete op;
+        if(held)
+        {
+            continue;
+        }
+
+        if(!key_locks.try_lock_shard(this, sid))
+        {
+            set_conflict("Lock contention");
+
+            if(!m_conflict_recorded)
+            {
+                m_conflict_recorded = true;
+                m_transaction_mgr.contention().record_conflict(sid);
+            }
+
+            return false;
+        }
+
+        held = true;
+        commit_tracker.get_dependencies(sid, m_dependencies);
     }
 
-    m_lock_handle.clear();
-    m_ops.clear();
-    m_transaction_mgr.remove_transaction(*this);
+    return true;
 }
 
-void Transaction::set_read_lock(shard_id_t sid)
+void Transaction::release_locks()
 {
-    if(!m_shard_lock_types.count(sid))
+    auto &key_locks = m_transaction_mgr.key_locks();
+
+    for(auto &[id, lock] : m_key_locks)
     {
-        m_shard_lock_types[sid] = LockType::Read;
+        if(lock.held)
+        {
+            key_locks.unlock_key(this, lock.shard, id.first, id.second, lock.held_type);
+            lock.held = false;
+        }
+    }
+
+    for(auto &[sid, held] : m_predicate_locks)
+    {
+        if(held)
+        {
+            key_locks.unlock_shard(this, sid);
+            held = false;
+        }
     }
 }
 
-void Transaction::set_write_lock(shard_id_t sid)
+commit_seq_t Transaction::release_locks_early()
 {
-    m_shard_lock_types[sid] = LockType::Write;
+    commit_seq_t seq = INVALID_COMMIT_SEQ;
+
+    if(!m_write_shards.empty())
+    {
+        std::vector<std::pair<std::string, std::string>> written_keys;
+
+        for(auto &[id, lock] : m_key_locks)
+        {
+            if(lock.type == LockType::Write)
+            {
+                written_keys.push_back(id);
+            }
+        }
+
+        // Register before unlocking so that the next holder of our locks sees the dependency
+        seq = m_transaction_mgr.commit_tracker().start(m_write_shards, written_keys);
+    }
+
+    m_lock_handle.clear();
+    release_locks();
+
+    return seq;
 }
 
 bool Transaction::check_repeatable_read(ObjectEventHandle &obj,
                            const std::string &collection,
                            const std::string &full_path,
-                           shard_id_t sid,
                            const event_id_t &expected_eid,
                            taskid_t task)
 {
     auto [key, path] = parse_path(full_path);
     (void)path; //if eid hasn't changed value hasn't change either so no need to check path
 
-    const LockType lock_type = m_shard_lock_types[sid];
     event_id_t latest_eid;
 
-    obj = ledger.get_latest_version(get_op_context(task), collection, key, "", latest_eid, m_lock_handle, lock_type);
+    obj = ledger.get_latest_version(get_op_context(task), collection, key, "", latest_eid, m_lock_handle, LockType::Read);
 
     if(!obj.valid() || latest_eid != expected_eid)
     {
-        set_error("Non-repeatable read: key [" + key + "] reads outdated value");
+        set_conflict("Non-repeatable read: key [" + key + "] reads outdated value", collection, key);
         return false;
     }
 
     return true;
 }
 
+bool Transaction::is_read_only() const
+{
+    return m_write_shards.empty();
+}
+
+bool Transaction::validate_operation(operation_info_t &op, bool generate_witness)
+{
+    // Other transactions only hold shard locks while they apply their writes,
+    // so contention here is short-lived and worth another try.
+    // This is not possible once the operation started writing the witness.
+    constexpr uint32_t MAX_ATTEMPTS = 3;
+
+    for(uint32_t attempt = 1; ; ++attempt)
+    {
+        try
+        {
+            bool result = op.validate(generate_witness);
+            m_lock_handle.clear();
+            return result;
+        }
+        catch(const would_block_exception &e)
+        {
+            m_lock_handle.clear();
+
+            if(generate_witness || attempt >= MAX_ATTEMPTS)
+            {
+                set_conflict("Lock contention");
+                return false;
+            }
+
+            // Give the holder a chance to finish before trying again
+            ContentionManager::backoff(attempt);
+        }
+    }
+}
+
 void Transaction::register_operation(operation_info_t *op)
 {
     m_ops.push_back(op);
-    op->collect_shard_lock_type();
+    op->collect_locks();
+
+    if(m_pessimistic)
+    {
+        wait_for_locks();
+    }
+}
+
+void Transaction::lock_before_read(const std::string &collection, const std::string &full_path, LockType type)
+{
+    if(!m_pessimistic)
+    {
+        return;
+    }
+
+    auto [key, path] = parse_path(full_path);
+    (void)path;
+
+    auto sid = ledger.get_shard(collection, key);
+
+    if(type == LockType::Write)
+    {
+        set_write_lock(collection, key, sid);
+    }
+    else
+    {
+        set_read_lock(collection, key, sid);
+    }
+
+    wait_for_locks();
+}
+
+void Transaction::wait_for_locks()
+{
+    // Other transactions only hold their locks briefly, so wait for them
+    constexpr uint32_t MAX_LOCK_ATTEMPTS = 10;
+
+    for(uint32_t attempt = 1; !acquire_locks(); ++attempt)
+    {
+        if(attempt >= MAX_LOCK_ATTEMPTS)
+        {
+            throw transaction_conflict_error(error());
+        }
+
+        ContentionManager::backoff(attempt);
+    }
+
+    // We got the locks after all
+    m_error.clear();
+    m_conflict = false;
 }
 
 bool Transaction::prepare(bool generate_witness)
@@ -120,18 +346,31 @@ bool Transaction::prepare(bool generate_witness)
         throw std::runtime_error("Cannot prepare: invalid state");
     }
 
-    // first acquire locks for all pending shards to ensure atomicity
-    try
+    if(isolation_level() == IsolationLevel::Snapshot)
     {
-        for(auto &[shard_no, lock_type] : m_shard_lock_types)
+        // All reads happened at the same snapshot, so there is nothing to lock or validate
+        if(!is_read_only())
+        {
+            set_error("Snapshot transactions cannot write");
+        }
+        else if(generate_witness)
         {
-            m_lock_handle.get_shard(shard_no, lock_type);
+            set_error("Snapshot transactions cannot generate witnesses");
         }
+        else
+        {
+            m_state = TransactionState::Prepared;
+            return true;
+        }
+
+        this->abort();
+        return false;
     }
-    catch(const would_block_exception& e)
+
+    // first lock everything we accessed so no other transaction can interfere until we commit
+    // We can't wait here as it may cause a deadlock
+    if(!acquire_locks())
     {
-        // We can't wait here as it may cause a deadlock
-        set_error("Lock contention");
         this->abort();
         return false;
     }
@@ -154,6 +393,9 @@ bool Transaction::prepare(bool generate_witness)
         case IsolationLevel::Serializable:
             writer.write_string("isolation", "Serializable");
             break;
+        case IsolationLevel::Snapshot:
+            // not reachable; see above
+            break;
         }
         writer.start_array(Witness::OP_FIELD_NAME);
     }
@@ -163,7 +405,7 @@ bool Transaction::prepare(bool generate_witness)
     // validate reads
     for(auto op : m_ops)
     {
-        if(!op->validate(generate_witness))
+        if(!validate_operation(*op, generate_witness))
         {
             result = false;
             break;
@@ -189,6 +431,26 @@ Witness Transaction::commit(bool generate_witness)
         throw std::runtime_error("Cannot commit: invalid state");
     }
 
+    if(isolation_level() == IsolationLevel::Snapshot)
+    {
+        // Nothing changed, so there is nothing to record in the transaction ledger either
+        m_state = TransactionState::Committed;
+        m_transaction_mgr.contention().record_commit();
+        cleanup();
+        return Witness();
+    }
+
+    // Writes must become visible atomically, so hold all affected shards while applying them.
+    // Nobody waits for a shard lock while holding a lock to a higher shard, so blocking here is fine.
+    m_lock_handle.set_blocking(true);
+
+    for(auto shard : m_write_shards)
+    {
+        m_lock_handle.get_shard(shard, LockType::Write);
+    }
+
+    m_lock_handle.set_blocking(false);
+
     std::set<event_id_t> read_set, write_set;
     std::array<uint16_t, NUM_SHARDS> write_shards;
     write_shards.fill(0);
@@ -217,6 +479,19 @@ Witness Transaction::commit(bool generate_witness)
         op->do_write(transaction_ref, generate_witness);
     }
 
+    if(!m_lock_handle.has_parent())
+    {
+        for(auto shard : m_write_shards)
+        {
+            ledger.organize_ledger(shard);
+        }
+    }
+
+    // The writes are applied and recorded in the transaction ledger.
+    // Let other transactions proceed while we finish up.
+    auto &commit_tracker = m_transaction_mgr.commit_tracker();
+    CommitGuard commit_guard(commit_tracker, release_locks_early());
+
     Witness witness;
     
     if(generate_witness)
@@ -241,7 +516,12 @@ Witness Transaction::commit(bool generate_witness)
         }
     }
 
+    // Don't acknowledge the commit before all transactions we depend on are done
+    commit_tracker.wait(m_dependencies);
+    commit_guard.finish();
+
     m_state = TransactionState::Committed;
+    m_transaction_mgr.contention().record_commit();
     cleanup();
     return witness;
 }
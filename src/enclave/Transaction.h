@@ -5,10 +5,13 @@
 
 #include <json/Writer.h>
 #include <map>
+#include <set>
 #include <unordered_set>
 
 #include "credb/IsolationLevel.h"
 #include "credb/Witness.h"
+#include "Arena.h"
+#include "CommitTracker.h"
 #include "LockHandle.h"
 #include "util/Identity.h"
 #include "Task.h"
@@ -34,6 +37,19 @@ enum class TransactionState : uint8_t
     Aborted
 };
 
+/**
+ * The answer of a participant to the first phase of a distributed commit
+ */
+enum class PrepareVote : uint8_t
+{
+    Abort,
+    Commit,
+
+    /// The participant did not write anything and has already committed.
+    /// It does not take part in the second phase.
+    ReadOnly
+};
+
 /**
  * Server-side logic for transaction processing
  */
@@ -73,6 +89,37 @@ public:
         m_error = error;
     }
 
+    /**
+     * Set an error that was caused by a conflict with another transaction
+     *
+     * The key is reported to the contention statistics (only for the first conflict of the transaction)
+     */
+    void set_conflict(const std::string &error, const std::string &collection, const std::string &full_path);
+
+    /**
+     * Set an error that was caused by a conflict with another transaction, but cannot be attributed to a key
+     */
+    void set_conflict(const std::string &error);
+
+    /**
+     * Did the transaction fail because of a conflict with another transaction?
+     */
+    bool is_conflict() const
+    {
+        return m_conflict;
+    }
+
+    /**
+     * Acquire locks as soon as an operation is registered instead of during prepare
+     *
+     * This is used for transactions that aborted repeatedly.
+     * Once locked, no other transaction can invalidate the reads of this transaction.
+     */
+    void set_pessimistic(bool val)
+    {
+        m_pessimistic = val;
+    }
+
     /**
      * Did an error occur?
      */
@@ -148,29 +195,60 @@ public:
     void get_output(bitstream &output);
 
     /**
-     * Sets a read lock for a shard to read if no lock for it has been set yet
+     * Sets a read lock for an object if no lock for it has been set yet
+     *
+     * @param full_path
+     *     The key of the object. A path within the object is ignored.
      */ 
-    void set_read_lock(shard_id_t sid);
+    void set_read_lock(const std::string &collection, const std::string &full_path, shard_id_t sid);
 
     /**
-     * Sets a write lock for a shard
+     * Sets a write lock for an object
+     */
+    void set_write_lock(const std::string &collection, const std::string &full_path, shard_id_t sid);
+
+    /**
+     * Lock all objects of a shard for reading
+     *
+     * @note Only use this for range predicates that cannot be expressed as a set of keys
      */
-    void set_write_lock(shard_id_t sid);
+    void set_predicate_lock(shard_id_t sid);
 
     bool check_repeatable_read(ObjectEventHandle &obj,
                            const std::string &collection,
                            const std::string &full_path,
-                           shard_id_t sid,
                            const event_id_t &expected_eid,
                            taskid_t task);
 
+    /**
+     * Allocate a new operation for this transaction
+     *
+     * The operation lives in the transaction's arena and is freed together with all other operations on commit or abort.
+     * The transaction is passed to the constructor as first argument.
+     */
+    template<typename T, typename... Args>
+    T* new_operation(Args&&... args)
+    {
+        return m_arena.create<T>(*this, std::forward<Args>(args)...);
+    }
+
     /**
      * Add a new operation that is associated with this transaction
      *
      * @param op
-     *      The operation structure. Memory will be managed by the transaction object from here on
+     *      The operation structure. It must have been created using new_operation()
      */
     void register_operation(operation_info_t *op);
+
+    /**
+     * Lock an object before reading it, if this transaction uses pessimistic locking
+     *
+     * Operations are registered after they have read, so their locks alone would not protect the value that was read.
+     * Does nothing for optimistic transactions; their reads are validated in prepare() instead.
+     *
+     * @throw transaction_conflict_error if the lock could not be acquired
+     */
+    void lock_before_read(const std::string &collection, const std::string &full_path, LockType type = LockType::Read);
     
     json::Writer writer;
 
@@ -200,6 +278,11 @@ public:
         return m_children;
     }
 
+    /**
+     * Does this transaction only read?
+     */
+    bool is_read_only() const;
+
     /**
      * Is this a distributed transaction that spans multiple nodes?
      */
@@ -211,6 +294,37 @@ public:
 private:
     void cleanup();
 
+    /**
+     * Acquire all key and predicate locks that are not held yet without blocking
+     *
+     * @note Locks that were acquired are kept on failure
+     * @return false if another transaction holds a conflicting lock
+     */
+    bool acquire_locks();
+
+    /**
+     * Acquire all locks, waiting for other transactions to release theirs
+     *
+     * @throw transaction_conflict_error if they do not do so in time
+     */
+    void wait_for_locks();
+
+    void release_locks();
+
+    /**
+     * Release all locks once the writes have been applied, before the commit has finished
+     *
+     * @return the sequence number of this transaction in the CommitTracker
+     */
+    commit_seq_t release_locks_early();
+
+    /**
+     * Validate a single operation
+     *
+     * Shard locks are only held while the operation looks at the ledger
+     */
+    bool validate_operation(operation_info_t &op, bool generate_witness);
+
     const IsolationLevel m_isolation;
 
     std::map<taskid_t, OpContext> m_op_contexts; 
@@ -221,11 +335,44 @@ private:
 
     LockHandle m_lock_handle;
 
-   /**
-     * Keep a list of all locks that need to be acquired
+    struct key_lock_t
+    {
+        shard_id_t shard;
+
+        /// The type of lock needed
+        LockType type;
+
+        bool held = false;
+
+        /// The type of lock currently held (if any)
+        LockType held_type = LockType::Read;
+    };
+
+    /// All objects accessed by this transaction, identified by (collection, key)
+    std::map<std::pair<std::string, std::string>, key_lock_t> m_key_locks;
+
+    /**
+     * Shards that are locked as a whole because of range predicates
+     * Maps to whether the lock is currently held
+     */
+    std::map<shard_id_t, bool> m_predicate_locks;
+
+    /**
+     * Shards that are write-locked while applying the writes
      * @note this needs to be ordered so we don't deadlock
      */
-    std::map<shard_id_t, LockType> m_shard_lock_types;
+    std::set<shard_id_t> m_write_shards;
+
+    /// Transactions that released locks we hold before they finished committing
+    std::set<commit_seq_t> m_dependencies;
+
+    bool m_pessimistic = false;
+
+    bool m_conflict = false;
+
+    /// Has a conflict already been reported to the contention statistics?
+    /// Pessimistic retries would otherwise count the same conflict many times
+    bool m_conflict_recorded = false;
 
     std::string m_error;
 
@@ -246,6 +393,9 @@ private:
      */
     std::unordered_set<identity_uid_t> m_children;
 
+    /// Holds the operations of this transaction
+    Arena m_arena;
+
     std::vector<operation_info_t*> m_ops;
 
     std::unordered_set<identity_uid_t> m_call_set;
@@ -5,6 +5,7 @@
 #include "TransactionManager.h"
 #include "RemoteParties.h"
 #include "PendingWitnessResponse.h"
+#include "PendingVoteResponse.h"
 #include "Peer.h"
 #include "Task.h"
 #include "logging.h"
@@ -23,7 +24,7 @@ bool TransactionExecutor::phase_one(bool generate_witness)
         throw std::runtime_error("Cannot commit remote transaction");
     }
 
-    std::vector<PendingBooleanResponse> responses;
+    std::vector<std::pair<identity_uid_t, PendingVoteResponse>> responses;
 
     if(tx.is_distributed())
     {
@@ -49,8 +50,8 @@ bool TransactionExecutor::phase_one(bool generate_witness)
                 peer->lock();
 
                 peer->send(req);
-                PendingBooleanResponse pending(op_id, *peer);
-                responses.emplace_back(std::move(pending));
+                PendingVoteResponse pending(op_id, *peer);
+                responses.emplace_back(child, std::move(pending));
 
                 peer->unlock();
             }
@@ -67,12 +68,23 @@ bool TransactionExecutor::phase_one(bool generate_witness)
         success = false;
     }
 
-    if(tx.is_distributed())
+    // All requests are out already, so this only waits for the slowest participant
+    for(auto &[child, pending] : responses)
     {
-        //NOLINTNEXTLINE
-        if(!wait_for(responses, *m_task))
+        wait_for(pending, *m_task);
+
+        switch(pending.result())
         {
+        case PrepareVote::Commit:
+            break;
+        case PrepareVote::ReadOnly:
+            m_finished_children.insert(child);
+            break;
+        case PrepareVote::Abort:
+            // The participant already aborted its part (presumed abort)
+            m_finished_children.insert(child);
             success = false;
+            break;
         }
     }
 
@@ -98,6 +110,11 @@ void TransactionExecutor::abort()
 
     for(auto &child: tx.children())
     {
+        if(m_finished_children.count(child))
+        {
+            continue;
+        }
+
         auto peer = m_remote_parties.find_by_uid<Peer>(child);
 
         if(!peer)
@@ -152,6 +169,12 @@ Witness TransactionExecutor::phase_two(bool generate_witness)
 
     for(auto &child: tx.children())
     {
+        if(m_finished_children.count(child))
+        {
+            // voted read-only during the first phase
+            continue;
+        }
+
         auto peer = m_remote_parties.find_by_uid<Peer>(child);
 
         if(!peer)
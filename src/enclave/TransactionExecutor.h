@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <unordered_set>
+
 #include "Transaction.h"
 
 namespace credb::trusted
@@ -50,6 +52,12 @@ private:
 
     /// The associated task that is executing the transaction
     Task *m_task;
+
+    /**
+     * Participants that are done after the first phase,
+     * because they voted read-only or aborted on their own
+     */
+    std::unordered_set<identity_uid_t> m_finished_children;
 };
 
 } // namespace credb::trusted
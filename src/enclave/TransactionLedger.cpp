@@ -13,26 +13,82 @@ TransactionLedger::TransactionLedger(BufferManager &buffer_manager)
     generate_block();
 }
 
-void TransactionLedger::organize_ledger()
+bool TransactionLedger::organize_ledger()
 {
-    m_mutex.lock();
-
     auto pending = get_block(m_pending_block_id);
 
     // Wait until we have reached at least min block size
     if(pending->get_data_size() < MIN_BLOCK_SIZE)
     {
-        m_mutex.unlock();
-        return;
+        return false;
     }
-    
+
     generate_block();
     auto newb = get_block(m_pending_block_id);
-    m_mutex.unlock();
 
     pending->seal();
     pending->flush_page();
     newb->flush_page();
+
+    return true;
+}
+
+void TransactionLedger::lead_group(std::unique_lock<std::mutex> &lock)
+{
+    m_has_leader = true;
+
+    std::vector<queued_record_t*> group;
+    group.swap(m_queue);
+
+    lock.unlock();
+
+    // Everything below must happen no matter what, otherwise the waiters of this group
+    // (and all future callers of insert) would block forever
+    std::exception_ptr error;
+    PageHandle<TransactionBlock> block;
+
+    try
+    {
+        // Readers only need the block lock, so hold it once for the entire group
+        block = get_pending_block(LockType::Write);
+
+        for(auto record : group)
+        {
+            auto idx = block->insert(record->document);
+
+            record->position = {block->identifier(), idx};
+            m_num_pending_events = idx;
+
+            if(organize_ledger())
+            {
+                block->write_unlock();
+                block.clear();
+                block = get_pending_block(LockType::Write);
+            }
+        }
+    }
+    catch(...)
+    {
+        error = std::current_exception();
+    }
+
+    if(block)
+    {
+        block->write_unlock();
+    }
+
+    lock.lock();
+
+    for(auto record : group)
+    {
+        // The entire group fails if one of the records could not be appended
+        record->error = error;
+        record->done = true;
+    }
+
+    // Let the next group (if any) choose its leader
+    m_has_leader = false;
+    m_queue_condition.notify_all();
 }
 
 ledger_pos_t TransactionLedger::insert(const std::map<taskid_t, OpContext> &op_contexts, identity_uid_t tx_root, transaction_id_t tx_id, const op_set_t &local_ops, const std::map<identity_uid_t, op_set_t> &remote_ops)
@@ -83,22 +139,31 @@ ledger_pos_t TransactionLedger::insert(const std::map<taskid_t, OpContext> &op_c
     }
     writer.end_array();
     writer.end_array();
- 
-    auto block = get_pending_block(LockType::Write);
 
-    auto doc = writer.make_document();
-    auto idx = block->insert(doc);
+    queued_record_t record(writer.make_document());
+
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    m_queue.push_back(&record);
 
-    ledger_pos_t pos = {block->identifier(), idx};
-    m_num_pending_events = idx;
+    while(!record.done)
+    {
+        if(m_has_leader)
+        {
+            // Our record will be appended by the current or the next leader
+            m_queue_condition.wait(lock);
+        }
+        else
+        {
+            lead_group(lock);
+        }
+    }
 
-    if(block->get_data_size() >= MIN_BLOCK_SIZE)
+    if(record.error)
     {
-        organize_ledger();
+        std::rethrow_exception(record.error);
     }
 
-    block->write_unlock();
-    return pos;
+    return record.position;
 }
 
 TransactionHandle TransactionLedger::get(ledger_pos_t pos)
@@ -3,8 +3,12 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
 #include "util/event_id_hash.h"
 #include "ledger_pos.h"
@@ -26,6 +30,9 @@ public:
 
 /**
  * A registry of all committed transactions and their dependencies
+ *
+ * Commits are grouped: concurrent callers of insert() queue their records,
+ * and whoever finds no other thread appending becomes the leader and appends the entire queue at once.
  */
 class TransactionLedger
 {
@@ -37,6 +44,32 @@ public:
     TransactionHandle get(ledger_pos_t pos);
 
 private:
+    /// A record waiting to be appended by the current leader
+    struct queued_record_t
+    {
+        explicit queued_record_t(json::Document &&document_)
+            : document(std::move(document_))
+        {
+        }
+
+        json::Document document;
+        ledger_pos_t position = INVALID_LEDGER_POS;
+        bool done = false;
+
+        /// Set if the group this record belongs to failed
+        std::exception_ptr error;
+    };
+
+    /**
+     * Append all queued records to the ledger
+     *
+     * @param lock
+     *      Lock to m_queue_mutex. Released while appending.
+     *
+     * @note Does not throw. If appending fails, the error is handed to every record of the group.
+     */
+    void lead_group(std::unique_lock<std::mutex> &lock);
+
     PageHandle<TransactionBlock> get_pending_block(LockType lock_type)
     {
         while(true)
@@ -73,16 +106,22 @@ private:
         return hdl;
     }
 
-    std::mutex m_mutex;
-
     BufferManager &m_buffer_manager;
 
+    std::mutex m_queue_mutex;
+    std::condition_variable_any m_queue_condition;
+    std::vector<queued_record_t*> m_queue;
+
+    /// Is some thread appending records right now?
+    bool m_has_leader = false;
+
     /**
-     * check if we should generate a new pending blokc
+     * Seal the pending block and start a new one, if it is big enough
      *
-     * note: you must hold a write lock to the pending block
+     * note: only the leader may call this and it must hold a write lock to the pending block
+     * @return true if the pending block changed
      */
-    void organize_ledger();
+    bool organize_ledger();
 
     void generate_block();
 
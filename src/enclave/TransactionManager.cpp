@@ -9,56 +9,71 @@ namespace credb::trusted
 
 TransactionManager::~TransactionManager()
 {
-    while(true)
+    for(auto &shard : m_shards)
     {
-        m_mutex.lock();
-        
-        TransactionPtr tx;
-        auto it = m_transactions.begin();
-
-        if(it == m_transactions.end())
-        {
-            tx = nullptr;
-        }
-        else
+        while(true)
         {
-            tx = it->second;
-        }
-        m_mutex.unlock();
+            TransactionPtr tx;
 
-        if(tx == nullptr)
-        {
-            //done
-            break;
-        }
-        else
-        {
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                auto it = shard.transactions.begin();
+
+                if(it != shard.transactions.end())
+                {
+                    tx = it->second;
+                }
+            }
+
+            if(tx == nullptr)
+            {
+                //done
+                break;
+            }
+
+            // this will remove the transaction from the shard
             tx->abort();
         }
     }
 }
 
-TransactionPtr TransactionManager::init_local_transaction(IsolationLevel isolation_level)
+size_t TransactionManager::num_pending_transactions() const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t result = 0;
 
+    for(auto &shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        result += shard.transactions.size();
+    }
+
+    return result;
+}
+
+TransactionPtr TransactionManager::init_local_transaction(IsolationLevel isolation_level)
+{
     auto uid = m_enclave.identity().get_unique_id();
     auto lid = m_id_counter.next();
 
+    // Identifiers are unique, so the transaction can be created before taking the lock
     auto tx = std::make_shared<Transaction>(isolation_level, m_enclave.ledger(), m_enclave.transaction_ledger(), *this, uid, lid, false);
 
-    m_transactions[std::pair(uid, lid)] = tx;
+    auto &shard = get_shard(uid, lid);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    shard.transactions[std::pair(uid, lid)] = tx;
     return tx;
 }
 
 TransactionPtr TransactionManager::init_remote_transaction(identity_uid_t transaction_root, transaction_id_t transaction_id, IsolationLevel isolation_level)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &shard = get_shard(transaction_root, transaction_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
 
     // Check if it was already initialized
-    auto it = m_transactions.find({transaction_root, transaction_id});
+    auto it = shard.transactions.find({transaction_root, transaction_id});
 
-    if(it == m_transactions.end())
+    if(it == shard.transactions.end())
     {
         auto &identity_db = m_enclave.identity_database();
 
@@ -69,7 +84,7 @@ TransactionPtr TransactionManager::init_remote_transaction(identity_uid_t transa
 
         auto tx = std::make_shared<Transaction>(isolation_level, m_enclave.ledger(), m_enclave.transaction_ledger(), *this, transaction_root, transaction_id, true);
 
-        m_transactions[std::pair(transaction_root, transaction_id)] = tx;
+        shard.transactions[std::pair(transaction_root, transaction_id)] = tx;
         return tx;
     }
     else
@@ -80,11 +95,12 @@ TransactionPtr TransactionManager::init_remote_transaction(identity_uid_t transa
 
 TransactionPtr TransactionManager::get(const identity_uid_t node_id, const transaction_id_t tx_id)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &shard = get_shard(node_id, tx_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
 
-    auto it = m_transactions.find({node_id, tx_id});
+    auto it = shard.transactions.find({node_id, tx_id});
 
-    if(it == m_transactions.end())
+    if(it == shard.transactions.end())
     {
         return {nullptr};
     }
@@ -96,19 +112,20 @@ TransactionPtr TransactionManager::get(const identity_uid_t node_id, const trans
 
 void TransactionManager::remove_transaction(Transaction &tx)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-
     auto node_id = tx.get_root();
     auto tx_id = tx.identifier();
 
-    auto it = m_transactions.find({node_id, tx_id});
+    auto &shard = get_shard(node_id, tx_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.transactions.find({node_id, tx_id});
 
-    if(it == m_transactions.end())
+    if(it == shard.transactions.end())
     {
         throw std::runtime_error("Cannot remove; no such transaction!");
     }
 
-    m_transactions.erase(it);
+    shard.transactions.erase(it);
 }
 
 } // namespace credb::trusted
@@ -3,8 +3,13 @@
 
 #pragma once
 
+#include <array>
+#include <mutex>
 #include <unordered_map>
 #include "Transaction.h"
+#include "CommitTracker.h"
+#include "ContentionManager.h"
+#include "KeyLockTable.h"
 #include "util/pair_hash.h"
 #include "Counter.h"
 #include "util/Identity.h"
@@ -34,20 +39,62 @@ public:
     /// This is automatically called once you commit or abort a transaction
     void remove_transaction(Transaction &tx);
 
-    size_t num_pending_transactions() const
+    size_t num_pending_transactions() const;
+
+    /**
+     * Locks of all transactions that are currently prepared
+     */
+    KeyLockTable& key_locks()
+    {
+        return m_key_locks;
+    }
+
+    /**
+     * Transactions that released their locks early and have not finished committing yet
+     */
+    CommitTracker& commit_tracker()
     {
-        return m_transactions.size();
+        return m_commit_tracker;
+    }
+
+    /**
+     * Statistics about aborts and the retry policy for programs
+     */
+    ContentionManager& contention()
+    {
+        return m_contention;
     }
 
 private:
-    std::mutex m_mutex;
+    static constexpr size_t NUM_SHARDS = 32;
+
+    using transaction_map_t = std::unordered_map<std::pair<identity_uid_t, transaction_id_t>, TransactionPtr, pair_hash>;
+
+    /**
+     * Transactions are spread across shards so that concurrent transactions don't contend on a single lock
+     */
+    struct shard_t
+    {
+        mutable std::mutex mutex;
+        transaction_map_t transactions;
+    };
+
+    shard_t& get_shard(identity_uid_t root, transaction_id_t tx_id)
+    {
+        return m_shards[pair_hash{}(std::pair(root, tx_id)) % NUM_SHARDS];
+    }
 
     Enclave &m_enclave;
 
     Counter<uint32_t> m_id_counter;
 
-    std::unordered_map<std::pair<identity_uid_t, transaction_id_t>, TransactionPtr, pair_hash> m_transactions;
+    std::array<shard_t, NUM_SHARDS> m_shards;
+
+    KeyLockTable m_key_locks;
+
+    CommitTracker m_commit_tracker;
 
+    ContentionManager m_contention;
 };
 
 }
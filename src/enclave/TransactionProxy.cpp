@@ -52,19 +52,19 @@ operation_info_t* TransactionProxy::new_operation_info_from_req(bitstream &req)
     switch(op)
     {
     case OperationType::GetObject:
-        return new get_info_t(tx, req, identifier());
+        return tx.new_operation<get_info_t>(req, identifier());
     case OperationType::HasObject:
-        return new has_obj_info_t(tx, req, identifier());
+        return tx.new_operation<has_obj_info_t>(req, identifier());
     case OperationType::CheckObject:
-        return new check_obj_info_t(tx, req, identifier());
+        return tx.new_operation<check_obj_info_t>(req, identifier());
     case OperationType::PutObject:
-        return new put_info_t(tx, req, identifier());
+        return tx.new_operation<put_info_t>(req, identifier());
     case OperationType::AddToObject:
-        return new add_info_t(tx, req, identifier());
+        return tx.new_operation<add_info_t>(req, identifier());
     case OperationType::FindObjects:
-        return new find_info_t(tx, req, identifier());
+        return tx.new_operation<find_info_t>(req, identifier());
     case OperationType::RemoveObject:
-        return new remove_info_t(tx, req, identifier());
+        return tx.new_operation<remove_info_t>(req, identifier());
     default:
         get_transaction().set_error("Unknown OperationType " + std::to_string(static_cast<uint8_t>(op)));
         log_error(get_transaction().error());
@@ -0,0 +1,142 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "WorkerPool.h"
+
+#include <exception>
+
+namespace credb::trusted
+{
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::run_worker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_num_workers += 1;
+
+    while(!m_stopped)
+    {
+        if(m_jobs.empty())
+        {
+            m_condition.wait(lock);
+            continue;
+        }
+
+        auto job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+
+    m_num_workers -= 1;
+}
+
+void WorkerPool::stop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    m_condition.notify_all();
+}
+
+bool WorkerPool::run_pending_job()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if(m_jobs.empty())
+    {
+        return false;
+    }
+
+    auto job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+
+    lock.unlock();
+    job();
+
+    return true;
+}
+
+void WorkerPool::run_all(std::vector<job_t> &jobs)
+{
+    if(jobs.empty())
+    {
+        return;
+    }
+
+    std::mutex batch_mutex;
+    std::condition_variable_any batch_condition;
+    size_t remaining = jobs.size();
+    std::exception_ptr error = nullptr;
+
+    auto wrap = [&](job_t &job) -> job_t {
+        return [&, job = std::move(job)]() {
+            std::exception_ptr job_error = nullptr;
+
+            try
+            {
+                job();
+            }
+            catch(...)
+            {
+                job_error = std::current_exception();
+            }
+
+            std::unique_lock<std::mutex> lock(batch_mutex);
+
+            if(job_error && !error)
+            {
+                error = job_error;
+            }
+
+            remaining -= 1;
+
+            if(remaining == 0)
+            {
+                batch_condition.notify_all();
+            }
+        };
+    };
+
+    // The calling thread executes the first job itself
+    auto first = wrap(jobs[0]);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        for(size_t i = 1; i < jobs.size(); ++i)
+        {
+            m_jobs.emplace_back(wrap(jobs[i]));
+        }
+
+        m_condition.notify_all();
+    }
+
+    first();
+
+    // Help with the remaining work instead of just waiting
+    while(run_pending_job())
+    {
+    }
+
+    std::unique_lock<std::mutex> lock(batch_mutex);
+
+    while(remaining > 0)
+    {
+        batch_condition.wait(lock);
+    }
+
+    jobs.clear();
+
+    if(error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace credb::trusted
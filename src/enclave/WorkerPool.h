@@ -0,0 +1,72 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace credb
+{
+namespace trusted
+{
+
+/**
+ * Runs independent jobs (e.g. parts of a scan) on multiple threads
+ *
+ * Enclaves cannot spawn threads. Instead, the untrusted part donates threads by calling credb_run_worker.
+ * The thread submitting a batch of jobs always helps executing them, so batches also complete if there are no workers.
+ */
+class WorkerPool
+{
+public:
+    using job_t = std::function<void()>;
+
+    WorkerPool() = default;
+    WorkerPool(const WorkerPool &other) = delete;
+
+    ~WorkerPool();
+
+    /**
+     * Execute jobs from the queue until stop() is called
+     *
+     * @note this is invoked by threads of the untrusted part
+     */
+    void run_worker();
+
+    /**
+     * Make all workers return
+     */
+    void stop();
+
+    /**
+     * Execute all jobs and wait for them to finish
+     *
+     * @throws the first exception raised by any of the jobs
+     */
+    void run_all(std::vector<job_t> &jobs);
+
+    /**
+     * Number of threads currently serving the pool
+     */
+    size_t num_workers() const { return m_num_workers; }
+
+private:
+    /// Run the next job on the calling thread (if any)
+    bool run_pending_job();
+
+    std::list<job_t> m_jobs;
+
+    std::mutex m_mutex;
+    std::condition_variable_any m_condition;
+
+    std::atomic<size_t> m_num_workers = {0};
+    bool m_stopped = false;
+};
+
+} // namespace trusted
+} // namespace credb
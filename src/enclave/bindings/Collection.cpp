@@ -66,6 +66,41 @@ cow::ValuePtr Collection::get_member(const std::string &name)
             return mem.create_from_document(value);
         });
     }
+    else if(name == "get_many")
+    {
+        return make_value<Function>(mem, [&](const std::vector<ValuePtr> &args) -> ValuePtr {
+            if(args.size() != 1 || args[0]->type() != ValueType::List)
+            {
+                throw std::runtime_error("Invalid arguments");
+            }
+
+            std::vector<std::string> keys;
+            for(auto arg : value_cast<List>(args[0])->elements())
+            {
+                keys.push_back(unpack_string(arg));
+            }
+
+            auto objects = m_ledger.get_many(m_op_context, m_name, keys, "", &m_lock_handle);
+
+            // Only objects that exist are returned, as (key, value) tuples
+            auto list = mem.create_list();
+
+            for(auto &obj : objects)
+            {
+                if(!obj.eid)
+                {
+                    continue;
+                }
+
+                auto t = mem.create_tuple();
+                t->append(mem.create_string(obj.key));
+                t->append(mem.create_from_document(obj.value));
+                list->append(t);
+            }
+
+            return list;
+        });
+    }
     else if(name == "has_object")
     {
         return make_value<Function>(mem, [&](const std::vector<ValuePtr> &args) -> ValuePtr {
@@ -82,17 +117,127 @@ cow::ValuePtr Collection::get_member(const std::string &name)
     }
     else if(name == "find")
     {
+        // Same arguments as Collection::find in the client API: (predicates, projection, limit, sort)
         return make_value<Function>(mem, [&](const std::vector<ValuePtr> &args) -> ValuePtr {
-            // FIXME support passing predicates
-            if(!args.empty())
+            if(args.size() > 4)
             {
                 throw std::runtime_error("Invalid number of arguments");
             }
 
             json::Document predicates("");
+            std::vector<std::string> projection;
+            int32_t limit = -1;
+            std::string sort;
+
+            if(args.size() > 0)
+            {
+                predicates = cow::value_to_document(args[0]);
+            }
+
+            if(args.size() > 1)
+            {
+                if(args[1]->type() != ValueType::List)
+                {
+                    throw std::runtime_error("Invalid arguments");
+                }
+
+                for(auto arg : value_cast<List>(args[1])->elements())
+                {
+                    projection.push_back(unpack_string(arg));
+                }
+            }
+
+            if(args.size() > 2)
+            {
+                limit = unpack_integer(args[2]);
+            }
+
+            if(args.size() > 3)
+            {
+                sort = unpack_string(args[3]);
+            }
+
+            if(projection.empty() && limit <= 0 && sort.empty())
+            {
+                auto it = m_ledger.find(m_op_context, m_name, predicates, &m_lock_handle);
+                return cow::make_value<ObjectListIterator>(mem, std::move(it));
+            }
+
+            auto list = mem.create_list();
+
+            if(!sort.empty())
+            {
+                // Sorted results have to be collected first
+                auto objects = m_ledger.find_sorted(m_op_context, m_name, predicates, projection, sort, limit, &m_lock_handle);
+
+                for(auto &obj : objects)
+                {
+                    auto t = mem.create_tuple();
+                    t->append(mem.create_string(obj.key));
+                    t->append(mem.create_from_document(obj.value));
+                    list->append(t);
+                }
+
+                return list;
+            }
 
             auto it = m_ledger.find(m_op_context, m_name, predicates, &m_lock_handle);
 
+            std::string key;
+            ObjectEventHandle hdl;
+            int32_t count = 0;
+
+            for(it.next(key, hdl); hdl.valid() && (limit <= 0 || count < limit); it.next(key, hdl))
+            {
+                json::Document value = hdl.value();
+
+                auto t = mem.create_tuple();
+                t->append(mem.create_string(key));
+
+                if(projection.empty())
+                {
+                    t->append(mem.create_from_document(value));
+                }
+                else
+                {
+                    json::Document filtered(value, projection);
+                    t->append(mem.create_from_document(filtered));
+                }
+
+                list->append(t);
+                count += 1;
+            }
+
+            return list;
+        });
+    }
+    else if(name == "scan")
+    {
+        return make_value<Function>(mem, [&](const std::vector<ValuePtr> &args) -> ValuePtr {
+            if(args.empty() || args.size() > 2)
+            {
+                throw std::runtime_error("Invalid number of arguments");
+            }
+
+            auto start_key = unpack_string(args[0]);
+            auto end_key = args.size() > 1 ? unpack_string(args[1]) : std::string();
+
+            auto it = m_ledger.scan(m_op_context, m_name, start_key, end_key, &m_lock_handle);
+
+            return cow::make_value<ObjectListIterator>(mem, std::move(it));
+        });
+    }
+    else if(name == "scan_prefix")
+    {
+        return make_value<Function>(mem, [&](const std::vector<ValuePtr> &args) -> ValuePtr {
+            if(args.size() != 1)
+            {
+                throw std::runtime_error("Invalid number of arguments");
+            }
+
+            auto prefix = unpack_string(args[0]);
+            auto it = m_ledger.scan_prefix(m_op_context, m_name, prefix, &m_lock_handle);
+
             return cow::make_value<ObjectListIterator>(mem, std::move(it));
         });
     }
@@ -58,12 +58,20 @@ cow::ValuePtr Database::get_member(const std::string &name)
         else
         {
             return make_value<Function>(mem, [&mem, this](const std::vector<ValuePtr> &args) -> ValuePtr {
-                if(!args.empty())
+                if(!(args.empty() || (args.size() == 1 && args[0]->type() == ValueType::Bool)))
                 {
                     throw std::runtime_error("Invalid number of arguments");
                 }
+
+                // Optionally, the program is run again if the transaction fails to commit because of a conflict
+                bool retry_on_conflict = false;
+
+                if(!args.empty())
+                {
+                    retry_on_conflict = unpack_bool(args[0]);
+                }
                 
-                return cow::make_value<Transaction>(mem, m_ledger, m_enclave, *m_runner, m_lock_handle);
+                return cow::make_value<Transaction>(mem, m_ledger, m_enclave, *m_runner, m_lock_handle, retry_on_conflict);
             });
         }
     }
@@ -22,8 +22,9 @@ Transaction::Transaction(cow::MemoryManager &mem,
                 credb::trusted::Ledger &ledger,
                 credb::trusted::Enclave &enclave,
                 credb::trusted::ProgramRunner &runner,
-                LockHandle &lock_handle_)
-    : Database(mem, runner.op_context(), ledger, enclave, &runner, lock_handle_)
+                LockHandle &lock_handle_,
+                bool retry_on_conflict)
+    : Database(mem, runner.op_context(), ledger, enclave, &runner, lock_handle_), m_retry_on_conflict(retry_on_conflict)
 {
     if(!has_program_runner())
     {
@@ -34,6 +35,9 @@ Transaction::Transaction(cow::MemoryManager &mem,
     m_transaction = tx_mgr.init_local_transaction(IsolationLevel::Serializable);
 
     m_transaction->init_task(runner.identifier(), runner.op_context());
+
+    // Programs that keep losing conflicts lock as they go
+    m_transaction->set_pessimistic(retry_on_conflict && ContentionManager::is_pessimistic(runner.attempt()));
 }
 
 Transaction::Transaction(cow::MemoryManager &mem,
@@ -195,6 +199,12 @@ cow::ValuePtr Transaction::get_member(const std::string &name)
 
             if(!exec.phase_one(generate_witness))
             {
+                if(m_retry_on_conflict && m_transaction->is_conflict())
+                {
+                    // The program runner will start over
+                    throw transaction_conflict_error(m_transaction->error());
+                }
+
                 // commit failed...
                 t->append(mem.create_boolean(false));
                 t->append(mem.create_string(m_transaction->error()));
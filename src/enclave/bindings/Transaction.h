@@ -19,12 +19,16 @@ class Transaction : public credb::trusted::bindings::Database
 public:
     /**
      * Constructor for a local transaction
+     *
+     * @param retry_on_conflict
+     *     If set, a commit that fails because of a conflict will run the entire program again
      */
     Transaction(cow::MemoryManager &mem,
                 credb::trusted::Ledger &ledger,
                 credb::trusted::Enclave &enclave,
                 credb::trusted::ProgramRunner &runner,
-                LockHandle &lock_handle_);
+                LockHandle &lock_handle_,
+                bool retry_on_conflict = false);
 
     /**
      * Constructor for a remote transaction
@@ -49,6 +53,8 @@ private:
     void abort();
 
     credb::trusted::TransactionPtr m_transaction;
+
+    const bool m_retry_on_conflict = false;
 };
 
 } // namespace bindings
@@ -41,7 +41,8 @@ cow::ValuePtr TransactionCollection::get_member(const std::string &name)
 
             auto &full_path = value_cast<StringVal>(args[0])->get();
             auto [key, path] = parse_path(full_path);
-            
+
+            m_transaction->lock_before_read(m_name, key);
             auto it = m_ledger.iterate(m_runner.op_context(), m_name, key, path, &m_lock_handle);
 
             auto [eid, value] = it.next();
@@ -53,13 +54,60 @@ cow::ValuePtr TransactionCollection::get_member(const std::string &name)
 
             auto res = mem.create_from_document(value);
 
-            auto op = new get_info_t(*m_transaction, m_name, full_path, eid, m_runner.identifier());
+            auto op = m_transaction->new_operation<get_info_t>(m_name, full_path, eid, m_runner.identifier());
 
             m_transaction->register_operation(op);
 
             return res;
         });
     }
+    else if(name == "get_many")
+    {
+        return make_value<Function>(mem, [&](const std::vector<ValuePtr> &args) -> ValuePtr {
+            if(args.size() != 1 || args[0]->type() != ValueType::List)
+            {
+                throw std::runtime_error("Invalid arguments");
+            }
+
+            std::vector<std::string> keys;
+            for(auto arg : value_cast<List>(args[0])->elements())
+            {
+                keys.push_back(unpack_string(arg));
+            }
+
+            for(auto &key : keys)
+            {
+                m_transaction->lock_before_read(m_name, key);
+            }
+
+            auto objects = m_ledger.get_many(m_runner.op_context(), m_name, keys, "", &m_lock_handle);
+
+            // Only objects that exist are returned, as (key, value) tuples
+            auto list = mem.create_list();
+
+            for(auto &obj : objects)
+            {
+                if(obj.eid)
+                {
+                    auto t = mem.create_tuple();
+                    t->append(mem.create_string(obj.key));
+                    t->append(mem.create_from_document(obj.value));
+                    list->append(t);
+
+                    auto op = m_transaction->new_operation<get_info_t>(m_name, obj.key, obj.eid, m_runner.identifier());
+                    m_transaction->register_operation(op);
+                }
+                else
+                {
+                    // Make sure the object still doesn't exist on commit
+                    auto op = m_transaction->new_operation<has_obj_info_t>(m_name, obj.key, false, m_runner.identifier());
+                    m_transaction->register_operation(op);
+                }
+            }
+
+            return list;
+        });
+    }
     else if(name == "check")
     {
         return make_value<Function>(mem, [&](const std::vector<ValuePtr> &args) -> ValuePtr {
@@ -71,9 +119,10 @@ cow::ValuePtr TransactionCollection::get_member(const std::string &name)
             auto key = unpack_string(args[0]);
             auto predicates = cow::value_to_document(args[1]);
 
+            m_transaction->lock_before_read(m_name, key);
             auto res = m_ledger.check(m_runner.op_context(), m_name, key, "", predicates);
 
-            auto op = new check_obj_info_t(*m_transaction, m_name, key, predicates, res, m_runner.identifier());
+            auto op = m_transaction->new_operation<check_obj_info_t>(m_name, key, predicates, res, m_runner.identifier());
             m_transaction->register_operation(op);
 
             return mem.create_boolean(res);
@@ -88,9 +137,11 @@ cow::ValuePtr TransactionCollection::get_member(const std::string &name)
             }
 
             auto key = unpack_string(args[0]);
+
+            m_transaction->lock_before_read(m_name, key);
             auto res = m_ledger.has_object(m_name, key, &m_lock_handle);
 
-            auto op = new has_obj_info_t(*m_transaction, m_name, key, res, m_runner.identifier());
+            auto op = m_transaction->new_operation<has_obj_info_t>(m_name, key, res, m_runner.identifier());
             m_transaction->register_operation(op);
 
             return mem.create_boolean(res);
@@ -158,12 +209,12 @@ cow::ValuePtr TransactionCollection::get_member(const std::string &name)
 
             if(name == "put")
             {
-                auto op = new put_info_t(*m_transaction, m_name, full_path, doc.duplicate(), m_runner.identifier());
+                auto op = m_transaction->new_operation<put_info_t>(m_name, full_path, doc.duplicate(), m_runner.identifier());
                 m_transaction->register_operation(op);
             }
             else
             {
-                auto op = new add_info_t(*m_transaction, m_name, full_path, doc.duplicate(), m_runner.identifier());
+                auto op = m_transaction->new_operation<add_info_t>(m_name, full_path, doc.duplicate(), m_runner.identifier());
                 m_transaction->register_operation(op);
             }
 
@@ -30,9 +30,9 @@ check_obj_info_t::check_obj_info_t(Transaction &tx, std::string collection, std:
       m_sid(get_shard(m_collection, m_key))
 {}
 
-void check_obj_info_t::collect_shard_lock_type()
+void check_obj_info_t::collect_locks()
 {
-    transaction().set_read_lock(m_sid);
+    transaction().set_read_lock(m_collection, m_key, m_sid);
 }
 
 void check_obj_info_t::extract_reads(std::set<event_id_t> &read_set)
@@ -48,7 +48,7 @@ bool check_obj_info_t::validate(bool generate_witness)
         
         if(res != m_result)
         {
-            transaction().set_error("check object [" + m_key + "] reads outdated value");
+            transaction().set_conflict("check object [" + m_key + "] reads outdated value", m_collection, m_key);
             return false;
         }
     }
@@ -85,9 +85,9 @@ void has_obj_info_t::extract_reads(std::set<event_id_t> &read_set)
     (void)read_set;
 }
 
-void has_obj_info_t::collect_shard_lock_type()
+void has_obj_info_t::collect_locks()
 {
-    transaction().set_read_lock(m_sid);
+    transaction().set_read_lock(m_collection, m_key, m_sid);
 }
 
 bool has_obj_info_t::validate(bool generate_witness)
@@ -96,7 +96,7 @@ bool has_obj_info_t::validate(bool generate_witness)
     
     if(res != m_result)
     {
-        transaction().set_error("has object [" + m_key + "] reads outdated value");
+        transaction().set_conflict("has object [" + m_key + "] reads outdated value", m_collection, m_key);
         return false;
     }
 
@@ -131,9 +131,9 @@ void get_info_t::extract_reads(std::set<event_id_t> &read_set)
     read_set.insert(m_eid);
 }
 
-void get_info_t::collect_shard_lock_type()
+void get_info_t::collect_locks()
 {
-    transaction().set_read_lock(m_sid);
+    transaction().set_read_lock(m_collection, m_key, m_sid);
 }
 
 bool get_info_t::validate(bool generate_witness)
@@ -141,7 +141,7 @@ bool get_info_t::validate(bool generate_witness)
     ObjectEventHandle obj;
     if(transaction().isolation_level() != IsolationLevel::ReadCommitted)
     {
-        if(!transaction().check_repeatable_read(obj, m_collection, m_key, m_sid, m_eid, task()))
+        if(!transaction().check_repeatable_read(obj, m_collection, m_key, m_eid, task()))
         {
             return false;
         }
@@ -192,9 +192,9 @@ void put_info_t::extract_writes(std::array<uint16_t, NUM_SHARDS> &write_set)
     write_set[m_sid] += 1;
 }
 
-void put_info_t::collect_shard_lock_type()
+void put_info_t::collect_locks()
 {
-    transaction().set_write_lock(m_sid);
+    transaction().set_write_lock(m_collection, m_key, m_sid);
 }
 
 bool put_info_t::validate(bool generate_witness)
@@ -268,9 +268,9 @@ void add_info_t::extract_writes(std::array<uint16_t, NUM_SHARDS> &write_set)
     write_set[m_sid] += 1;
 }
 
-void add_info_t::collect_shard_lock_type()
+void add_info_t::collect_locks()
 {
-    transaction().set_write_lock(m_sid);
+    transaction().set_write_lock(m_collection, m_key, m_sid);
 }
 
 void add_info_t::do_write(ledger_pos_t transaction_ref,
@@ -322,9 +322,9 @@ void remove_info_t::extract_writes(std::array<uint16_t, NUM_SHARDS> &write_set)
     write_set[m_sid] += 1;
 }
 
-void remove_info_t::collect_shard_lock_type()
+void remove_info_t::collect_locks()
 {
-    transaction().set_write_lock(m_sid);
+    transaction().set_write_lock(m_collection, m_key, m_sid);
 }
 
 void remove_info_t::do_write(ledger_pos_t  transaction_ref, bool generate_witness)
@@ -374,22 +374,23 @@ void find_info_t::extract_reads(std::set<event_id_t> &read_set)
     }
 }
 
-void find_info_t::collect_shard_lock_type()
+void find_info_t::collect_locks()
 {
     if(transaction().isolation_level() == IsolationLevel::Serializable)
     {
-        // Lock all shards to avoid phantom reads
+        // The predicate might match objects in any shard, so lock all of them to avoid phantom reads
         for(shard_id_t i = 0; i < NUM_SHARDS; ++i)
         {
-            transaction().set_read_lock(i);
+            transaction().set_predicate_lock(i);
         }
     }
     else
     {
         // Only lock what we read
-        for(const auto &it : m_result)
+        for(const auto &[key, sid, eid] : m_result)
         {
-            transaction().set_read_lock(std::get<1>(it));
+            (void)eid;
+            transaction().set_read_lock(collection, key, sid);
         }
     }
 }
@@ -421,7 +422,7 @@ bool find_info_t::validate_no_dirty_read(bool generate_witness)
         
         if(!hdl.valid())
         {
-            transaction().set_error("Dirty read: key [" + key + "] reads outdated value");
+            transaction().set_conflict("Dirty read: key [" + key + "] reads outdated value", collection, key);
             return false;
         }
 
@@ -437,8 +438,9 @@ bool find_info_t::validate_repeatable_read(bool generate_witness)
 {
     for(const auto &[key, sid, eid] : m_result)
     {
+        (void)sid;
         ObjectEventHandle obj;
-        if(!transaction().check_repeatable_read(obj, collection, key, sid, eid, task()))
+        if(!transaction().check_repeatable_read(obj, collection, key, eid, task()))
         {
             return false;
         }
@@ -470,7 +472,7 @@ bool find_info_t::validate_no_phantom(bool generate_witness)
         auto cnt = eids.erase(eid);
         if(!cnt)
         {
-            transaction().set_error("Phantom read: key=" + key);
+            transaction().set_conflict("Phantom read: key=" + key, collection, key);
             return false;
         }
 
@@ -491,7 +493,7 @@ bool find_info_t::validate_no_phantom(bool generate_witness)
 
     if(!eids.empty())
     {
-        transaction().set_error("Phantom read: too few results");
+        transaction().set_conflict("Phantom read: too few results");
         return false;
     }
 
@@ -29,7 +29,7 @@ struct operation_info_t
 public:
     virtual OperationType type() const = 0;
     
-    virtual void collect_shard_lock_type() = 0;
+    virtual void collect_locks() = 0;
 
     virtual void extract_reads(std::set<event_id_t> &read_set) = 0;
 
@@ -133,7 +133,7 @@ public:
 
     void extract_reads(std::set<event_id_t> &read_set) override;
 
-    void collect_shard_lock_type() override;
+    void collect_locks() override;
 
     bool validate(bool generate_witness) override;
 
@@ -159,7 +159,7 @@ public:
 
     void extract_reads(std::set<event_id_t> &read_set) override;
 
-    void collect_shard_lock_type() override;
+    void collect_locks() override;
 
     bool validate(bool generate_witness) override;
 
@@ -184,7 +184,7 @@ public:
 
     void extract_reads(std::set<event_id_t> &read_set) override;
 
-    void collect_shard_lock_type() override;
+    void collect_locks() override;
 
     bool validate(bool generate_witness) override;
 
@@ -212,7 +212,7 @@ public:
     void extract_writes(std::array<uint16_t, NUM_SHARDS> &write_set) override;
 
 
-    void collect_shard_lock_type() override;
+    void collect_locks() override;
 
     void do_write(ledger_pos_t transaction_ref,
                   bool generate_witness) override;
@@ -240,7 +240,7 @@ public:
 
     void extract_writes(std::array<uint16_t, NUM_SHARDS> &write_set) override;
     
-    void collect_shard_lock_type() override;
+    void collect_locks() override;
 
     void do_write(ledger_pos_t transaction_ref,
                   bool generate_witness) override;
@@ -266,7 +266,7 @@ public:
 
     void extract_writes(std::array<uint16_t, NUM_SHARDS> &write_set) override;
  
-    void collect_shard_lock_type() override;
+    void collect_locks() override;
 
     void do_write(ledger_pos_t transaction_ref, 
                   bool generate_witness) override;
@@ -287,7 +287,7 @@ public:
         return OperationType::FindObjects;
     }
 
-    void collect_shard_lock_type() override;
+    void collect_locks() override;
 
     bool validate(bool generate_witness) override;
    
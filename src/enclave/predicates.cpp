@@ -0,0 +1,140 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#include "predicates.h"
+
+namespace credb::trusted
+{
+
+inline bool contains(const json::Document &value, const json::Document &element)
+{
+    if(value.empty())
+    {
+        return false;
+    }
+
+    if(value.get_type() != json::ObjectType::Array)
+    {
+        return value == element;
+    }
+
+    for(uint32_t i = 0; i < value.get_size(); ++i)
+    {
+        if(json::Document(value, std::to_string(i)) == element)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline json::Document make_clause(const std::string &path, const json::Document &operand)
+{
+    json::Writer writer;
+    writer.start_map();
+    writer.write_document(path, operand);
+    writer.end_map();
+
+    return writer.make_document();
+}
+
+CompiledPredicates::CompiledPredicates(const json::Document &predicates)
+{
+    if(predicates.empty())
+    {
+        return;
+    }
+
+    if(predicates.get_type() != json::ObjectType::Map)
+    {
+        m_has_residual = true;
+        m_residual = predicates.duplicate();
+        return;
+    }
+
+    json::Writer writer;
+    writer.start_map();
+
+    for(uint32_t pos = 0; pos < predicates.get_size(); ++pos)
+    {
+        auto key = predicates.get_key(pos);
+        json::Document operand(predicates, key);
+        json::Document element(predicates, key + "." + CONTAINS_OPERATOR);
+
+        if(!element.empty())
+        {
+            m_contains.push_back(contains_t{key, element.duplicate()});
+            continue;
+        }
+
+        auto value = ScalarValue::read(operand);
+
+        if(key.empty() || key[0] == '$' || value.type == ScalarValue::Type::None)
+        {
+            // Operators, nested predicates, etc.
+            writer.write_document(key, operand);
+            m_has_residual = true;
+            continue;
+        }
+
+        m_equalities.push_back(equality_t{key, std::move(value), make_clause(key, operand)});
+    }
+
+    writer.end_map();
+
+    if(m_has_residual)
+    {
+        m_residual = writer.make_document();
+    }
+}
+
+bool CompiledPredicates::empty() const
+{
+    return !m_has_residual && m_equalities.empty() && m_contains.empty();
+}
+
+bool CompiledPredicates::matches(const json::Document &document) const
+{
+    for(auto &equality : m_equalities)
+    {
+        json::Document view(document, equality.path);
+
+        if(view.empty())
+        {
+            return false;
+        }
+
+        auto value = ScalarValue::read(view);
+
+        if(value.type == equality.value.type)
+        {
+            if(!(value == equality.value))
+            {
+                return false;
+            }
+        }
+        else if(!document.matches_predicates(equality.clause))
+        {
+            return false;
+        }
+    }
+
+    for(auto &test : m_contains)
+    {
+        if(!contains(json::Document(document, test.path), test.element))
+        {
+            return false;
+        }
+    }
+
+    return !m_has_residual || document.matches_predicates(m_residual);
+}
+
+bool matches_predicates(const json::Document &document, const json::Document &predicates)
+{
+    CompiledPredicates compiled(predicates);
+    return compiled.matches(document);
+}
+
+} // namespace credb::trusted
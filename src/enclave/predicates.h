@@ -0,0 +1,77 @@
+/// (c) 2018 Cornell University
+/// This file is part of the CreDB Project. See LICENSE for more information.
+
+#pragma once
+
+#include <json/json.h>
+#include <string>
+#include <vector>
+
+#include "ScalarValue.h"
+
+namespace credb::trusted
+{
+
+/**
+ * Membership test: {"tags": {"$contains": "foo"}} matches if tags is an array holding "foo" (or is equal to "foo")
+ */
+const std::string CONTAINS_OPERATOR = "$contains";
+
+/**
+ * A set of predicates prepared for being checked against many documents
+ *
+ * The predicate document is only looked at once. Equality tests with numbers or strings
+ * are compared directly to the value in the document, membership tests are evaluated
+ * without building any documents, and only the remaining operators are passed on to
+ * json::Document::matches_predicates.
+ */
+class CompiledPredicates
+{
+public:
+    explicit CompiledPredicates(const json::Document &predicates);
+
+    /**
+     * Does the document match all predicates?
+     */
+    bool matches(const json::Document &document) const;
+
+    /**
+     * True if there is nothing to check, i.e. all documents match
+     */
+    bool empty() const;
+
+private:
+    struct equality_t
+    {
+        std::string path;
+        ScalarValue value;
+
+        /// The original predicate, for values that can't be compared directly (e.g. arrays)
+        json::Document clause;
+    };
+
+    struct contains_t
+    {
+        std::string path;
+        json::Document element;
+    };
+
+    std::vector<equality_t> m_equalities;
+    std::vector<contains_t> m_contains;
+
+    bool m_has_residual = false;
+
+    /// All predicates that are evaluated by json::Document::matches_predicates
+    json::Document m_residual;
+};
+
+/**
+ * Check whether a document matches all predicates
+ *
+ * Supports everything json::Document::matches_predicates does plus the $contains operator
+ *
+ * @note Use CompiledPredicates when checking many documents against the same predicates
+ */
+bool matches_predicates(const json::Document &document, const json::Document &predicates);
+
+} // namespace credb::trusted
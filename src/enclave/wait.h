@@ -11,28 +11,36 @@ namespace credb
 namespace trusted
 {
 
-inline bool wait_for(std::vector<PendingBooleanResponse> &responses, Task &task)
+/**
+ * Suspend the task until the response has arrived
+ */
+inline void wait_for(PendingMessage &pending, Task &task)
 {
-    bool result = true;
+    auto &peer = pending.peer();
+    peer.lock();
 
-    for(auto &pending: responses)
+    // check before we suspend
+    pending.wait(false);
+    
+    while(!pending.has_message())
     {
-        auto &peer = pending.peer();
+        peer.unlock();
+        task.suspend();
         peer.lock();
 
-        // check before we suspend
         pending.wait(false);
-        
-        while(!pending.has_message())
-        {
-            peer.unlock();
-            task.suspend();
-            peer.lock();
+    }
 
-            pending.wait(false);
-        }
+    peer.unlock();
+}
 
-        peer.unlock();
+inline bool wait_for(std::vector<PendingBooleanResponse> &responses, Task &task)
+{
+    bool result = true;
+
+    for(auto &pending: responses)
+    {
+        wait_for(pending, task);
 
         if(!pending.result())
         {
@@ -50,22 +58,7 @@ inline bool wait_for(std::vector<PendingWitnessResponse> &responses, Task &task)
 
     for(auto &pending: responses)
     {
-        auto &peer = pending.peer();
-        peer.lock();
-
-        // check before we suspend
-        pending.wait(false);
-        
-        while(!pending.has_message())
-        {
-            peer.unlock();
-            task.suspend();
-            peer.lock();
-
-            pending.wait(false);
-        }
-
-        peer.unlock();
+        wait_for(pending, task);
 
         if(!pending.success())
         {
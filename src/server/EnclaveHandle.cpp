@@ -134,6 +134,21 @@ void EnclaveHandle::peer_insert_response(remote_party_id peer_id, uint32_t op_id
     }
 }
 
+void EnclaveHandle::run_worker()
+{
+    credb::trusted::g_enclave->worker_pool().run_worker();
+}
+
+void EnclaveHandle::stop_workers()
+{
+    credb::trusted::g_enclave->worker_pool().stop();
+}
+
+bool EnclaveHandle::run_maintenance()
+{
+    return credb::trusted::g_enclave->run_maintenance();
+}
+
 #else
 
 EnclaveHandle::EnclaveHandle(std::string name, Disk &disk)
@@ -318,6 +333,37 @@ void EnclaveHandle::peer_insert_response(remote_party_id peer_id, uint32_t op_id
         LOG(ERROR) << "Failed to credb_peer_insert_response" << to_string(ret);    }
 }
 
+void EnclaveHandle::run_worker()
+{
+    sgx_status_t ret = credb_run_worker(m_enclave_id);
+    if(ret != SGX_SUCCESS)
+    {
+        LOG(ERROR) << "Failed to credb_run_worker: " << to_string(ret);
+    }
+}
+
+void EnclaveHandle::stop_workers()
+{
+    sgx_status_t ret = credb_stop_workers(m_enclave_id);
+    if(ret != SGX_SUCCESS)
+    {
+        LOG(ERROR) << "Failed to credb_stop_workers: " << to_string(ret);
+    }
+}
+
+bool EnclaveHandle::run_maintenance()
+{
+    bool result = false;
+    sgx_status_t ret = credb_run_maintenance(m_enclave_id, &result);
+    if(ret != SGX_SUCCESS)
+    {
+        LOG(ERROR) << "Failed to credb_run_maintenance: " << to_string(ret);
+        return false;
+    }
+
+    return result;
+}
+
 #endif
 
 } // namespace credb
@@ -56,6 +56,21 @@ public:
     void set_upstream(remote_party_id upstream_id);
     void peer_insert_response(remote_party_id peer_id, uint32_t op_id, const uint8_t *data, uint32_t length);
 
+    /**
+     * Let the calling thread execute jobs for the enclave (e.g. parts of a parallel scan)
+     *
+     * @note blocks until stop_workers() is called
+     */
+    void run_worker();
+    void stop_workers();
+
+    /**
+     * Do a slice of background work inside the enclave
+     *
+     * @return true if there is more work to do right away
+     */
+    bool run_maintenance();
+
     Disk &disk()
     {
         return m_disk;
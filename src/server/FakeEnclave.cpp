@@ -4,6 +4,21 @@
 #include "FakeEnclave.h"
 
 #ifdef FAKE_ENCLAVE
+#include <chrono>
+#include <thread>
+
+int get_current_time(uint64_t *out)
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    *out = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    return 0;
+}
+
+void sleep_for_micros(uint32_t micros)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(micros));
+}
+
 int get_file_size(int32_t *out, const char *filename)
 {
     *out = get_file_size(filename);
@@ -37,6 +37,8 @@ int get_file_size(int32_t *out, const char *filename);
 int read_from_disk(bool *result, const char *filename, uint8_t *data, uint32_t length);
 int get_num_files(size_t *out);
 int get_total_file_size(size_t *out);
+int get_current_time(uint64_t *out);
+void sleep_for_micros(uint32_t micros);
 
 // for debug purposes
 bool dump_everything(const char *filename, const uint8_t *disk_key, size_t length);
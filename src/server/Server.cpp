@@ -4,6 +4,7 @@
 #include "Server.h"
 
 #include <glog/logging.h>
+#include <chrono>
 #include <iostream>
 
 #include "Attestation.h"
@@ -25,9 +26,27 @@ using namespace yael;
 namespace credb::untrusted
 {
 
-Server::Server(const std::string &name, const std::string &addr, uint16_t port, const std::string &disk_path)
+/// How long the maintenance thread sleeps when there is no background work
+constexpr uint32_t MAINTENANCE_INTERVAL_MS = 100;
+
+Server::Server(const std::string &name, const std::string &addr, uint16_t port, const std::string &disk_path, uint32_t num_workers)
     : m_disk(disk_path), m_enclave(name, m_disk)
 {
+    for(uint32_t i = 0; i < num_workers; ++i)
+    {
+        m_workers.emplace_back([this]() { m_enclave.run_worker(); });
+    }
+
+    m_maintenance = std::thread([this]() {
+        while(!m_stopped)
+        {
+            if(!m_enclave.run_maintenance())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(MAINTENANCE_INTERVAL_MS));
+            }
+        }
+    });
+
     auto &el = EventLoop::get_instance();
 
     m_peer_acceptor = el.allocate_event_listener<PeerAcceptor>(m_enclave, m_remote_parties);
@@ -37,7 +56,18 @@ Server::Server(const std::string &name, const std::string &addr, uint16_t port,
     EventLoop::get_instance().register_event_listener(m_client_acceptor);
 }
 
-Server::~Server() = default;
+Server::~Server()
+{
+    m_stopped = true;
+    m_maintenance.join();
+
+    m_enclave.stop_workers();
+
+    for(auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
 
 void Server::listen(uint16_t port) noexcept
 {
@@ -67,3 +97,17 @@ void Server::set_upstream(const std::string &addr) noexcept
 void print_info(const char *str) { LOG(INFO) << "ENCLAVE: " << str; }
 
 void print_error(const char *str) { LOG(ERROR) << "ENCLAVE: " << str; }
+
+/// Milliseconds since an arbitrary point in time (only used to measure durations)
+uint64_t get_current_time()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+#ifndef FAKE_ENCLAVE
+void sleep_for_micros(uint32_t micros)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(micros));
+}
+#endif
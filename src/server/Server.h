@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <string>
+#include <thread>
+#include <vector>
 #include <yael/EventListener.h>
 #include <bitstream.h>
 
@@ -24,7 +27,11 @@ namespace untrusted
 class Server
 {
 public:
-    Server(const std::string &name, const std::string &addr, uint16_t port, const std::string &disk_path);
+    /**
+     * @param num_workers
+     *      Number of threads that execute parts of large queries inside the enclave
+     */
+    Server(const std::string &name, const std::string &addr, uint16_t port, const std::string &disk_path, uint32_t num_workers = 0);
     ~Server();
 
     void listen(uint16_t port) noexcept;
@@ -39,6 +46,12 @@ private:
 
     std::shared_ptr<ClientAcceptor> m_client_acceptor = nullptr;
     std::shared_ptr<PeerAcceptor> m_peer_acceptor = nullptr;
+
+    std::vector<std::thread> m_workers;
+
+    /// Drives background work inside the enclave (e.g. index builds)
+    std::thread m_maintenance;
+    std::atomic<bool> m_stopped = false;
 };
 
 } // namespace untrusted
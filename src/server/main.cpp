@@ -27,6 +27,10 @@
 namespace po = boost::program_options;
 using namespace yael;
 
+constexpr uint32_t NUM_EVENT_THREADS = 50;
+constexpr uint32_t MAX_NUM_WORKERS = 16;
+constexpr uint32_t DEFAULT_NUM_WORKERS = 4;
+
 void stop_handler(int i)
 {
     (void)i;
@@ -67,7 +71,9 @@ int main(int ac, char *av[])
                                 "should be listen for peers?")("help,h", "produce help message")(
     "connect,c", po::value<std::string>())(
     "upstream", po::value<std::string>(),
-    "upstream server address")("dbpath", po::value<std::string>(), "path to data storage. in-memory if not set.");
+    "upstream server address")("dbpath", po::value<std::string>(), "path to data storage. in-memory if not set.")(
+    "workers", po::value<uint32_t>()->default_value(DEFAULT_NUM_WORKERS),
+    "number of threads used to parallelize large queries");
 
     po::variables_map vm;
     try {
@@ -116,8 +122,16 @@ int main(int ac, char *av[])
         hostname = vm["hostname"].as<std::string>();
     }
 
-    // set this to match TCSnum in Enclave.config.xml
-    EventLoop::initialize(50);
+    uint32_t num_workers = vm["workers"].as<uint32_t>();
+
+    if(num_workers > MAX_NUM_WORKERS)
+    {
+        std::cerr << "Can use at most " << MAX_NUM_WORKERS << " worker threads" << std::endl;
+        return -1;
+    }
+
+    // NUM_EVENT_THREADS + MAX_NUM_WORKERS must match TCSnum in Enclave.config.xml
+    EventLoop::initialize(NUM_EVENT_THREADS);
 
     uint16_t port = 0;
 
@@ -126,7 +140,7 @@ int main(int ac, char *av[])
         port = vm["port"].as<uint16_t>();
     }
 
-    credb::untrusted::Server db(vm["name"].as<std::string>(), hostname, port, dbpath);
+    credb::untrusted::Server db(vm["name"].as<std::string>(), hostname, port, dbpath, num_workers);
 
     if(vm.count("listen") > 0)
     {
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../src/enclave/Arena.h"
+
+using namespace credb::trusted;
+
+TEST(ArenaTest, alignment)
+{
+    Arena arena;
+
+    arena.allocate(1, 1);
+    auto ptr = arena.allocate(sizeof(uint64_t), alignof(uint64_t));
+
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignof(uint64_t), 0u);
+    EXPECT_EQ(arena.num_chunks(), size_t(0));
+}
+
+TEST(ArenaTest, grow_and_clear)
+{
+    Arena arena;
+    std::vector<std::string*> strings;
+
+    for(size_t i = 0; i < 1000; ++i)
+    {
+        strings.push_back(arena.create<std::string>(std::to_string(i)));
+    }
+
+    EXPECT_GT(arena.num_chunks(), size_t(0));
+
+    for(size_t i = 0; i < strings.size(); ++i)
+    {
+        EXPECT_EQ(*strings[i], std::to_string(i));
+
+        using std::string;
+        strings[i]->~string();
+    }
+
+    // larger than a chunk
+    auto big = arena.allocate(2 * Arena::CHUNK_SIZE);
+    EXPECT_TRUE(big != nullptr);
+
+    arena.clear();
+    EXPECT_EQ(arena.num_chunks(), size_t(0));
+}
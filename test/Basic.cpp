@@ -6,6 +6,7 @@
 #include <assert.h>
 #include <iostream>
 #include <mutex>
+#include <set>
 #include <condition_variable>
 #include <sstream>
 #include <gtest/gtest.h>
@@ -113,6 +114,32 @@ TEST_F(Basic, get_is_set)
     ASSERT_EQ(c->size(), NUM_OBJECTS);
 }
 
+TEST_F(Basic, get_many)
+{
+    const size_t NUM_OBJECTS = 200;
+
+    std::vector<std::string> keys;
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        keys.push_back(credb::random_object_key(10));
+        c->put(keys.back(), value(i));
+    }
+
+    keys.push_back("does_not_exist");
+
+    auto res = c->get_many(keys);
+    ASSERT_EQ(res.size(), NUM_OBJECTS + 1);
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        EXPECT_TRUE(res[i].second.is_valid());
+        EXPECT_EQ(res[i].first, value(i));
+    }
+
+    EXPECT_FALSE(res[NUM_OBJECTS].second.is_valid());
+}
+
 TEST_F(Basic, count_objects)
 {
     const size_t NUM_OBJECTS = 1337;
@@ -128,6 +155,47 @@ TEST_F(Basic, count_objects)
     EXPECT_EQ(c->count(), NUM_OBJECTS);
 }
 
+TEST_F(Basic, find_cursor)
+{
+    const size_t NUM_OBJECTS = 250;
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        c->put(credb::random_object_key(10), value(i));
+    }
+
+    auto cursor = c->find_cursor(json::Document(""), {"id"}, -1, 32);
+    std::set<int32_t> ids;
+
+    while(cursor->has_next())
+    {
+        auto [key, doc] = cursor->next();
+        EXPECT_FALSE(key.empty());
+        ids.insert(json::Document(doc, "id").as_integer());
+    }
+
+    EXPECT_EQ(ids.size(), NUM_OBJECTS);
+    EXPECT_THROW(cursor->next(), std::runtime_error);
+
+    // the limit applies to the whole cursor, not to a single batch
+    auto limited = c->find_cursor(json::Document(""), {}, 50, 32);
+    size_t count = 0;
+
+    while(limited->has_next())
+    {
+        limited->next();
+        count += 1;
+    }
+
+    EXPECT_EQ(count, 50u);
+
+    // closing early releases the cursor
+    auto closed = c->find_cursor(json::Document(""), {}, -1, 10);
+    EXPECT_TRUE(closed->has_next());
+    closed->close();
+    EXPECT_FALSE(closed->has_next());
+}
+
 TEST_F(Basic, search_with_predicates)
 {
     json::Document doc1("{\"city\":\"ithaca\", \"flag\":3}");
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "../src/enclave/CommitTracker.h"
+
+using namespace credb;
+using namespace credb::trusted;
+
+TEST(CommitTrackerTest, key_dependencies)
+{
+    CommitTracker tracker;
+
+    auto seq1 = tracker.start({1}, {{"test", "foo"}});
+    auto seq2 = tracker.start({2}, {{"test", "bar"}});
+
+    EXPECT_NE(seq1, seq2);
+    EXPECT_EQ(tracker.num_pending(), size_t(2));
+
+    std::set<commit_seq_t> deps;
+    tracker.get_dependencies("test", "foo", deps);
+    tracker.get_dependencies("other", "foo", deps);
+
+    EXPECT_EQ(deps, std::set<commit_seq_t>{seq1});
+
+    // A later writer of the same key replaces the earlier one
+    auto seq3 = tracker.start({1}, {{"test", "foo"}});
+    tracker.finish(seq1);
+
+    deps.clear();
+    tracker.get_dependencies("test", "foo", deps);
+    EXPECT_EQ(deps, std::set<commit_seq_t>{seq3});
+
+    tracker.finish(seq2);
+    tracker.finish(seq3);
+
+    deps.clear();
+    tracker.get_dependencies("test", "foo", deps);
+    EXPECT_TRUE(deps.empty());
+    EXPECT_EQ(tracker.num_pending(), size_t(0));
+}
+
+TEST(CommitTrackerTest, shard_dependencies)
+{
+    CommitTracker tracker;
+
+    auto seq1 = tracker.start({1, 2}, {{"test", "foo"}, {"test", "bar"}});
+    auto seq2 = tracker.start({2}, {{"test", "xyz"}});
+
+    std::set<commit_seq_t> deps;
+    tracker.get_dependencies(1, deps);
+    EXPECT_EQ(deps, std::set<commit_seq_t>{seq1});
+
+    deps.clear();
+    tracker.get_dependencies(2, deps);
+    EXPECT_EQ(deps, (std::set<commit_seq_t>{seq1, seq2}));
+
+    deps.clear();
+    tracker.get_dependencies(3, deps);
+    EXPECT_TRUE(deps.empty());
+
+    tracker.finish(seq1);
+    tracker.finish(seq2);
+}
+
+TEST(CommitTrackerTest, wait_for_predecessor)
+{
+    CommitTracker tracker;
+    std::atomic<bool> finished = false;
+
+    auto seq = tracker.start({1}, {{"test", "foo"}});
+
+    std::thread predecessor([&]() {
+        finished = true;
+        tracker.finish(seq);
+    });
+
+    tracker.wait({seq});
+    EXPECT_TRUE(finished);
+
+    predecessor.join();
+
+    // Waiting for finished transactions returns right away
+    tracker.wait({seq});
+}
+
+TEST(CommitTrackerTest, guard_finishes_on_error)
+{
+    CommitTracker tracker;
+
+    try
+    {
+        CommitGuard guard(tracker, tracker.start({1}, {{"test", "foo"}}));
+        EXPECT_EQ(tracker.num_pending(), size_t(1));
+
+        throw std::runtime_error("failed to sign witness");
+    }
+    catch(const std::runtime_error &e)
+    {
+    }
+
+    EXPECT_EQ(tracker.num_pending(), size_t(0));
+
+    CommitGuard guard(tracker, tracker.start({1}, {{"test", "foo"}}));
+    guard.finish();
+    EXPECT_EQ(tracker.num_pending(), size_t(0));
+}
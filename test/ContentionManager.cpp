@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "../src/enclave/ContentionManager.h"
+
+using namespace credb;
+using namespace credb::trusted;
+
+TEST(ContentionManagerTest, abort_statistics)
+{
+    ContentionManager contention;
+
+    contention.record_commit();
+    contention.record_commit();
+    contention.record_abort(true);
+    contention.record_abort(false);
+
+    contention.record_retry(1);
+    contention.record_retry(ContentionManager::NUM_OPTIMISTIC_ATTEMPTS);
+
+    json::Writer writer;
+    writer.start_map();
+    contention.write(writer, "transactions");
+    writer.end_map();
+
+    auto doc = writer.make_document();
+
+    EXPECT_EQ(json::Document(doc, "transactions.num_commits").as_integer(), 2);
+    EXPECT_EQ(json::Document(doc, "transactions.num_aborts").as_integer(), 2);
+    EXPECT_EQ(json::Document(doc, "transactions.num_conflicts").as_integer(), 1);
+    EXPECT_EQ(json::Document(doc, "transactions.num_retries").as_integer(), 2);
+    EXPECT_EQ(json::Document(doc, "transactions.num_escalations").as_integer(), 1);
+}
+
+TEST(ContentionManagerTest, hot_keys)
+{
+    ContentionManager contention;
+
+    for(size_t i = 0; i < 3; ++i)
+    {
+        contention.record_conflict(1, "test", "foo");
+    }
+
+    contention.record_conflict(2, "test", "bar");
+    contention.record_conflict(2);
+
+    // Fill up the summary with keys that only conflicted once
+    for(size_t i = 0; i < ContentionManager::NUM_HOT_KEYS; ++i)
+    {
+        contention.record_conflict(3, "other", "key" + std::to_string(i));
+    }
+
+    json::Writer writer;
+    writer.start_map();
+    contention.write(writer, "transactions");
+    writer.end_map();
+
+    auto doc = writer.make_document();
+
+    EXPECT_EQ(json::Document(doc, "transactions.shard_conflicts.1").as_integer(), 3);
+    EXPECT_EQ(json::Document(doc, "transactions.shard_conflicts.2").as_integer(), 2);
+
+    // The most contended key is always kept and listed first
+    EXPECT_EQ(json::Document(doc, "transactions.hot_keys.0.collection").as_string(), "test");
+    EXPECT_EQ(json::Document(doc, "transactions.hot_keys.0.key").as_string(), "foo");
+    EXPECT_EQ(json::Document(doc, "transactions.hot_keys.0.conflicts").as_integer(), 3);
+    EXPECT_EQ(json::Document(doc, "transactions.hot_keys.0.error").as_integer(), 0);
+}
+
+TEST(ContentionManagerTest, escalation)
+{
+    EXPECT_FALSE(ContentionManager::is_pessimistic(0));
+    EXPECT_FALSE(ContentionManager::is_pessimistic(ContentionManager::NUM_OPTIMISTIC_ATTEMPTS - 1));
+    EXPECT_TRUE(ContentionManager::is_pessimistic(ContentionManager::NUM_OPTIMISTIC_ATTEMPTS));
+}
@@ -237,3 +237,133 @@ TEST_F(HashMapTest, serialize_node)
 
     EXPECT_EQ(3, node2->version_no());
 }
+
+TEST_F(HashMapTest, filter_skips_missing_keys)
+{
+    string_index_t index(*buffer, "test_string_index");
+
+    for(uint16_t i = 0; i < 100; ++i)
+    {
+        index.insert("key" + to_string(i), {0, i, i});
+    }
+
+    for(uint16_t i = 0; i < 1000; ++i)
+    {
+        event_id_t out;
+        EXPECT_FALSE(index.get("missing" + to_string(i), out));
+    }
+
+    EXPECT_EQ(1000u, index.num_filter_negatives() + index.num_filter_false_positives());
+    EXPECT_GT(index.num_filter_negatives(), 0u);
+
+    for(uint16_t i = 0; i < 100; ++i)
+    {
+        event_id_t out;
+        event_id_t expected = {0, i, i};
+
+        EXPECT_TRUE(index.get("key" + to_string(i), out));
+        EXPECT_EQ(expected, out);
+    }
+}
+
+TEST_F(HashMapTest, filter_is_rebuilt_on_load)
+{
+    bitstream root;
+
+    {
+        string_index_t index(*buffer, "test_string_index");
+        index.insert("foo", {0, 1, 2});
+        index.serialize_root(root);
+    }
+
+    root.move_to(0);
+
+    string_index_t index(*buffer, "test_string_index");
+
+    // Must also work when called through the base class
+    AbstractMap<string_index_t::node_t, std::string> &base = index;
+    base.load_root(root);
+
+    // The root only contains the buckets
+    EXPECT_TRUE(root.at_end());
+
+    event_id_t out;
+    event_id_t expected = {0, 1, 2};
+
+    EXPECT_TRUE(index.get("foo", out));
+    EXPECT_EQ(expected, out);
+
+    for(uint16_t i = 0; i < 100; ++i)
+    {
+        EXPECT_FALSE(index.get("missing" + to_string(i), out));
+    }
+
+    EXPECT_GT(index.num_filter_negatives(), 0u);
+}
+
+TEST_F(HashMapTest, filter_grows_with_bucket)
+{
+    string_index_t index(*buffer, "test_string_index");
+
+    // Collect keys that all end up in the same bucket
+    // 300 keys per bucket correspond to about 2.5M keys in the map
+    const size_t NUM_KEYS = 300;
+    const size_t NUM_MISSING = 2000;
+
+    std::vector<std::string> keys, missing;
+
+    for(uint32_t i = 0; keys.size() < NUM_KEYS || missing.size() < NUM_MISSING; ++i)
+    {
+        auto key = "key" + to_string(i);
+
+        if(::hash<std::string>(key) % string_index_t::NUM_BUCKETS != 0)
+        {
+            continue;
+        }
+
+        if(keys.size() < NUM_KEYS)
+        {
+            keys.push_back(key);
+        }
+        else
+        {
+            missing.push_back(key);
+        }
+    }
+
+    for(uint16_t i = 0; i < NUM_KEYS; ++i)
+    {
+        index.insert(keys[i], {0, i, i});
+    }
+
+    // Updates do not count as new keys
+    for(uint16_t i = 0; i < NUM_KEYS; ++i)
+    {
+        index.insert(keys[i], {1, i, i});
+    }
+
+    EXPECT_GE(index.filter_size(0), NUM_KEYS * string_index_t::FILTER_BITS_PER_KEY);
+    EXPECT_LE(index.filter_size(0), 4 * NUM_KEYS * string_index_t::FILTER_BITS_PER_KEY);
+    EXPECT_EQ(string_index_t::FILTER_MIN_BITS, index.filter_size(1));
+
+    for(uint16_t i = 0; i < NUM_KEYS; ++i)
+    {
+        event_id_t out;
+        event_id_t expected = {1, i, i};
+
+        EXPECT_TRUE(index.get(keys[i], out));
+        EXPECT_EQ(expected, out);
+    }
+
+    for(auto &key : missing)
+    {
+        event_id_t out;
+        EXPECT_FALSE(index.get(key, out));
+    }
+
+    EXPECT_EQ(NUM_MISSING, index.num_filter_negatives() + index.num_filter_false_positives());
+
+    // A saturated filter would let almost all of these through
+    const double false_positive_rate = static_cast<double>(index.num_filter_false_positives()) / NUM_MISSING;
+    EXPECT_LT(false_positive_rate, 0.05);
+}
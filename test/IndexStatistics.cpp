@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include "../src/enclave/IndexStatistics.h"
+
+using namespace credb;
+using namespace credb::trusted;
+
+TEST(IndexStatisticsTest, empty)
+{
+    IndexStatistics stats;
+
+    EXPECT_EQ(stats.num_entries(), 0u);
+    EXPECT_EQ(stats.num_distinct_values(), 0u);
+    EXPECT_EQ(stats.estimate_count(42), 0u);
+}
+
+TEST(IndexStatisticsTest, frequent_values)
+{
+    IndexStatistics stats;
+
+    for(int64_t i = 0; i < 1000; ++i)
+    {
+        stats.insert(42);
+        stats.insert(i);
+    }
+
+    EXPECT_EQ(stats.num_entries(), 2000u);
+    EXPECT_GE(stats.estimate_count(42), 1000u);
+    EXPECT_LE(stats.estimate_count(1337), 2u);
+
+    for(int64_t i = 0; i < 500; ++i)
+    {
+        stats.remove(42);
+    }
+
+    EXPECT_EQ(stats.num_entries(), 1500u);
+    EXPECT_GE(stats.estimate_count(42), 500u);
+    EXPECT_LT(stats.estimate_count(42), 1000u);
+}
+
+TEST(IndexStatisticsTest, distinct_values)
+{
+    IndexStatistics stats;
+    const size_t NUM_VALUES = 10000;
+
+    for(size_t i = 0; i < NUM_VALUES; ++i)
+    {
+        stats.insert(static_cast<int64_t>(i % (NUM_VALUES / 10)));
+    }
+
+    // a sketch with 256 registers should be within ~20% most of the time
+    auto distinct = stats.num_distinct_values();
+    EXPECT_GT(distinct, NUM_VALUES / 10 * 8 / 10);
+    EXPECT_LT(distinct, NUM_VALUES / 10 * 12 / 10);
+
+    // uniform distribution: every value exists 10 times
+    auto estimate = stats.estimate_count(12);
+    EXPECT_GE(estimate, 5u);
+    EXPECT_LE(estimate, 20u);
+}
+
+TEST(IndexStatisticsTest, validity)
+{
+    IndexStatistics stats;
+    EXPECT_TRUE(stats.is_valid());
+
+    stats.set_valid(false);
+    EXPECT_FALSE(stats.is_valid());
+
+    stats.clear();
+    EXPECT_TRUE(stats.is_valid());
+}
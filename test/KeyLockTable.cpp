@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../src/enclave/KeyLockTable.h"
+
+using namespace credb;
+using namespace credb::trusted;
+
+TEST(KeyLockTableTest, readers_and_writers)
+{
+    KeyLockTable locks;
+    int a, b;
+
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Read));
+    EXPECT_TRUE(locks.try_lock_key(&b, 1, "test", "foo", LockType::Read));
+    EXPECT_FALSE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Write));
+
+    // different key or collection in the same shard
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "bar", LockType::Write));
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "other", "foo", LockType::Write));
+    EXPECT_FALSE(locks.try_lock_key(&b, 1, "test", "bar", LockType::Read));
+
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Read);
+    locks.unlock_key(&b, 1, "test", "foo", LockType::Read);
+    EXPECT_TRUE(locks.try_lock_key(&b, 1, "test", "foo", LockType::Write));
+
+    locks.unlock_key(&b, 1, "test", "foo", LockType::Write);
+    locks.unlock_key(&a, 1, "test", "bar", LockType::Write);
+    locks.unlock_key(&a, 1, "other", "foo", LockType::Write);
+
+    EXPECT_EQ(locks.num_locked_keys(), size_t(0));
+}
+
+TEST(KeyLockTableTest, predicate_locks)
+{
+    KeyLockTable locks;
+    int a, b, c;
+
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Write));
+
+    EXPECT_FALSE(locks.try_lock_shard(&b, 1));
+    EXPECT_TRUE(locks.try_lock_shard(&a, 1));
+    EXPECT_TRUE(locks.try_lock_shard(&b, 2));
+
+    // key reads don't conflict with predicates
+    EXPECT_TRUE(locks.try_lock_key(&c, 2, "test", "bar", LockType::Read));
+    EXPECT_FALSE(locks.try_lock_key(&c, 2, "test", "xyz", LockType::Write));
+
+    locks.unlock_shard(&b, 2);
+    EXPECT_TRUE(locks.try_lock_key(&c, 2, "test", "xyz", LockType::Write));
+
+    locks.unlock_shard(&a, 1);
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Write);
+    locks.unlock_key(&c, 2, "test", "bar", LockType::Read);
+    locks.unlock_key(&c, 2, "test", "xyz", LockType::Write);
+
+    EXPECT_EQ(locks.num_locked_keys(), size_t(0));
+}
+
+TEST(KeyLockTableTest, own_locks_do_not_conflict)
+{
+    KeyLockTable locks;
+    int a, b;
+
+    // A transaction that scans a shard and then writes to it
+    EXPECT_TRUE(locks.try_lock_shard(&a, 1));
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Write));
+    EXPECT_FALSE(locks.try_lock_key(&b, 1, "test", "bar", LockType::Write));
+
+    // ...and reads what it wrote
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Read));
+    EXPECT_FALSE(locks.try_lock_key(&b, 1, "test", "foo", LockType::Read));
+
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Read);
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Write);
+    locks.unlock_shard(&a, 1);
+
+    EXPECT_TRUE(locks.try_lock_key(&b, 1, "test", "bar", LockType::Write));
+    locks.unlock_key(&b, 1, "test", "bar", LockType::Write);
+
+    EXPECT_EQ(locks.num_locked_keys(), size_t(0));
+}
+
+TEST(KeyLockTableTest, key_write_locks)
+{
+    KeyLockTable locks;
+    int a;
+
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Read));
+
+    {
+        KeyWriteLocks write_locks(locks);
+        EXPECT_FALSE(write_locks.try_lock(1, "test", "foo"));
+        EXPECT_TRUE(write_locks.try_lock(1, "test", "bar"));
+
+        EXPECT_FALSE(locks.try_lock_shard(&a, 1));
+    }
+
+    EXPECT_TRUE(locks.try_lock_shard(&a, 1));
+    locks.unlock_shard(&a, 1);
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Read);
+
+    EXPECT_EQ(locks.num_locked_keys(), size_t(0));
+}
+
+TEST(KeyLockTableTest, writer_waits_for_transaction)
+{
+    KeyLockTable locks;
+    int a;
+    std::atomic<bool> written = false;
+
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Read));
+
+    std::thread writer([&] {
+        KeyWriteLocks write_locks(locks);
+        EXPECT_TRUE(write_locks.lock(1, "test", "foo", {}));
+        written = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(written);
+
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Read);
+    writer.join();
+
+    EXPECT_TRUE(written);
+    EXPECT_EQ(locks.num_locked_keys(), size_t(0));
+}
+
+TEST(KeyLockTableTest, writer_holding_shards_does_not_deadlock)
+{
+    KeyLockTable locks;
+    int a;
+
+    // The transaction will need shard 2 to commit
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Read));
+    EXPECT_TRUE(locks.try_lock_key(&a, 2, "test", "bar", LockType::Write));
+
+    KeyWriteLocks write_locks(locks);
+    EXPECT_FALSE(write_locks.lock(1, "test", "foo", {2}));
+
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Read);
+    locks.unlock_key(&a, 2, "test", "bar", LockType::Write);
+
+    // Nobody else holds the object
+    EXPECT_TRUE(write_locks.lock(1, "test", "foo", {2}));
+}
+
+TEST(KeyLockTableTest, repeated_write_locks)
+{
+    KeyLockTable locks;
+    int a, b;
+
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Write));
+    EXPECT_TRUE(locks.try_lock_key(&a, 1, "test", "foo", LockType::Write));
+
+    // Still held after the first unlock
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Write);
+    EXPECT_FALSE(locks.try_lock_key(&b, 1, "test", "foo", LockType::Read));
+    EXPECT_TRUE(locks.has_key_writes(&a, 1));
+
+    locks.unlock_key(&a, 1, "test", "foo", LockType::Write);
+    EXPECT_FALSE(locks.has_key_writes(&a, 1));
+    EXPECT_TRUE(locks.try_lock_key(&b, 1, "test", "foo", LockType::Read));
+
+    locks.unlock_key(&b, 1, "test", "foo", LockType::Read);
+    EXPECT_EQ(locks.num_locked_keys(), size_t(0));
+}
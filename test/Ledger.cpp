@@ -1,6 +1,7 @@
 #include "../src/enclave/Ledger.h"
 
 #include <gtest/gtest.h>
+#include <thread>
 
 #include <cowlang/cow.h>
 #include <cowlang/unpack.h>
@@ -8,7 +9,12 @@
 #include "credb/defines.h"
 
 #include "../src/server/Disk.h"
+#include "../src/enclave/Aggregation.h"
 #include "../src/enclave/Enclave.h"
+#include "../src/enclave/Index.h"
+#include "../src/enclave/LockHandle.h"
+#include "../src/enclave/OrderedKeyIndex.h"
+#include "../src/enclave/QueryPlanner.h"
 
 using namespace credb;
 using namespace credb::trusted;
@@ -751,6 +757,720 @@ TEST_F(LedgerTest, find_with_index4)
     EXPECT_FALSE(it.next(key_, hdl));
 }
 
+TEST_F(LedgerTest, build_index_in_background)
+{
+    const size_t NUM_OBJECTS = 5000;
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        json::Document doc("{\"a\":" + std::to_string(i % 10) + "}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    ledger->create_index(COLLECTION, "xyz", {"a"});
+
+    auto index = ledger->get_collection(COLLECTION).get_secondary_index("xyz");
+    ASSERT_NE(index, nullptr);
+    EXPECT_FALSE(index->is_ready());
+
+    // Writes that happen during the build must be reflected in the index
+    for(size_t i = 0; i < NUM_OBJECTS; i += 10)
+    {
+        json::Document doc("{\"a\":42}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    while(!index->is_ready())
+    {
+        enclave.task_manager().run_background_task();
+    }
+
+    EXPECT_EQ(index->estimate_value_count(json::Document("{\"a\":0}")), 0u);
+    EXPECT_EQ(index->estimate_value_count(json::Document("{\"a\":42}")), NUM_OBJECTS / 10);
+    EXPECT_EQ(index->estimate_value_count(json::Document("{\"a\":1}")), NUM_OBJECTS / 10);
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, json::Document("{\"a\":42}")), NUM_OBJECTS / 10);
+}
+
+TEST_F(LedgerTest, recreate_index_while_building)
+{
+    const size_t NUM_OBJECTS = 5000;
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        json::Document doc("{\"a\":" + std::to_string(i % 10) + "}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    ledger->create_index(COLLECTION, "xyz", {"a"});
+    auto old_index = ledger->get_collection(COLLECTION).get_secondary_index("xyz");
+
+    EXPECT_TRUE(enclave.task_manager().run_background_task());
+    EXPECT_TRUE(ledger->drop_index(COLLECTION, "xyz"));
+
+    ledger->create_index(COLLECTION, "xyz", {"a"});
+    auto index = ledger->get_collection(COLLECTION).get_secondary_index("xyz");
+    ASSERT_NE(index, old_index);
+
+    while(enclave.task_manager().run_background_task())
+    {
+    }
+
+    // The stale builder must not have touched the new index
+    EXPECT_TRUE(index->is_ready());
+    EXPECT_FALSE(old_index->is_ready());
+    EXPECT_EQ(index->estimate_value_count(json::Document("{\"a\":1}")), NUM_OBJECTS / 10);
+}
+
+TEST_F(LedgerTest, explain)
+{
+    for(size_t i = 0; i < 1000; ++i)
+    {
+        const int b = (i % 3 == 0) ? 0 : 1;
+        json::Document doc("{\"a\":" + std::to_string(i % 100) + ",\"b\":" + std::to_string(b) + "}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    json::Document predicates("{\"a\":3,\"b\":1}");
+
+    auto plan1 = ledger->explain(COLLECTION, predicates);
+    EXPECT_EQ(json::Document(plan1, "strategy").as_string(), "linear_scan");
+
+    ledger->create_index(COLLECTION, "index_a", {"a"});
+    ledger->create_index(COLLECTION, "index_b", {"b"});
+
+    while(!ledger->get_collection(COLLECTION).get_secondary_index("index_a")->is_ready()
+          || !ledger->get_collection(COLLECTION).get_secondary_index("index_b")->is_ready())
+    {
+        enclave.task_manager().run_background_task();
+    }
+
+    // b is not selective, so it should not be used
+    auto plan2 = ledger->explain(COLLECTION, predicates);
+    EXPECT_EQ(json::Document(plan2, "strategy").as_string(), "index_lookup");
+    EXPECT_EQ(json::Document(plan2, "indexes.0.name").as_string(), "index_a");
+    EXPECT_EQ(json::Document(plan2, "residual_predicates.0").as_string(), "b");
+
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, predicates), 6u);
+}
+
+TEST_F(LedgerTest, covering_index)
+{
+    for(size_t i = 0; i < 100; ++i)
+    {
+        json::Document doc("{\"a\":" + std::to_string(i % 10) + ",\"b\":" + std::to_string(i) + ",\"c\":\"foo\"}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    ledger->create_index(COLLECTION, "index_a", {"a"}, {"b"});
+
+    while(!ledger->get_collection(COLLECTION).get_secondary_index("index_a")->is_ready())
+    {
+        enclave.task_manager().run_background_task();
+    }
+
+    // Update and remove objects after the index has been built
+    json::Document updated("{\"a\":3,\"b\":1000,\"c\":\"bar\"}");
+    ledger->put(TESTSRC, COLLECTION, "key3", updated);
+    ledger->remove(TESTSRC, COLLECTION, "key13");
+
+    json::Document predicates("{\"a\":3}");
+
+    auto plan = ledger->plan_query(COLLECTION, predicates, {"a", "b"});
+    EXPECT_TRUE(plan.covering);
+
+    auto entries = ledger->find_covered(TESTSRC, COLLECTION, predicates, plan);
+    EXPECT_EQ(entries.size(), 9u);
+
+    for(auto &entry : entries)
+    {
+        event_id_t eid;
+        LockHandle lock_handle(*ledger);
+        auto hdl = ledger->get_latest_version(TESTSRC, COLLECTION, entry.key, "", eid, lock_handle, LockType::Read);
+
+        ASSERT_TRUE(hdl.valid());
+        EXPECT_EQ(entry.eid, eid);
+        EXPECT_EQ(json::Document(entry.value, "b"), json::Document(hdl.value(), "b"));
+        EXPECT_TRUE(json::Document(entry.value, "c").empty());
+    }
+
+    // c is not stored in the index
+    auto plan2 = ledger->plan_query(COLLECTION, predicates, {"a", "c"});
+    EXPECT_FALSE(plan2.covering);
+}
+
+TEST_F(LedgerTest, multikey_index)
+{
+    for(size_t i = 0; i < 100; ++i)
+    {
+        const std::string tags = (i % 2 == 0) ? "[\"even\",\"all\"]" : "[\"odd\",\"all\"]";
+        json::Document doc("{\"id\":" + std::to_string(i) + ",\"tags\":" + tags + "}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    json::Document predicates("{\"tags\":{\"$contains\":\"odd\"}}");
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, predicates), 50u);
+
+    ledger->create_index(COLLECTION, "tags", {"tags"});
+
+    while(!ledger->get_collection(COLLECTION).get_secondary_index("tags")->is_ready())
+    {
+        enclave.task_manager().run_background_task();
+    }
+
+    auto plan = ledger->explain(COLLECTION, predicates);
+    EXPECT_EQ(json::Document(plan, "strategy").as_string(), "index_lookup");
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, predicates), 50u);
+
+    // Removing an element must remove the corresponding entry
+    json::Document updated("{\"id\":1,\"tags\":[\"all\"]}");
+    ledger->put(TESTSRC, COLLECTION, "key1", updated);
+
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, predicates), 49u);
+    EXPECT_EQ(ledger->get_collection(COLLECTION).get_secondary_index("tags")->estimate_value_count(
+                  json::Document("{\"tags\":{\"$contains\":\"odd\"}}")), 49u);
+
+    // Whole arrays can still be looked up by equality
+    json::Document equality("{\"tags\":[\"all\"]}");
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, equality), 1u);
+}
+
+TEST_F(LedgerTest, scan_prefix)
+{
+    const std::vector<std::string> keys = {"b/2/x", "a/1/x", "b/1/y", "a/2/x", "b/1/x", "c/1/x", "bb/1/x"};
+
+    for(auto &key : keys)
+    {
+        json::Document doc("{\"a\":1}");
+        ledger->put(TESTSRC, COLLECTION, key, doc);
+    }
+
+    const std::vector<std::string> expected = {"b/1/x", "b/1/y", "b/2/x"};
+
+    auto collect = [&](ObjectListIterator &&it) {
+        std::vector<std::string> result;
+        std::string key;
+        ObjectEventHandle hdl;
+
+        while(it.next(key, hdl))
+        {
+            result.push_back(key);
+        }
+
+        return result;
+    };
+
+    // Without an ordered index
+    EXPECT_EQ(collect(ledger->scan_prefix(TESTSRC, COLLECTION, "b/")), expected);
+
+    EXPECT_TRUE(ledger->create_ordered_index(COLLECTION));
+    EXPECT_FALSE(ledger->create_ordered_index(COLLECTION));
+
+    EXPECT_EQ(collect(ledger->scan_prefix(TESTSRC, COLLECTION, "b/")), expected);
+
+    // Updates are reflected
+    json::Document doc("{\"a\":2}");
+    ledger->put(TESTSRC, COLLECTION, "b/1/z", doc);
+    ledger->remove(TESTSRC, COLLECTION, "b/1/x");
+
+    EXPECT_EQ(collect(ledger->scan(TESTSRC, COLLECTION, "b/1/", "b/2/")), std::vector<std::string>({"b/1/y", "b/1/z"}));
+    EXPECT_EQ(collect(ledger->scan(TESTSRC, COLLECTION, "bb", "")), std::vector<std::string>({"bb/1/x", "c/1/x"}));
+}
+
+TEST_F(LedgerTest, build_ordered_index_in_background)
+{
+    const size_t NUM_OBJECTS = 5000;
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        json::Document doc("{\"i\":" + std::to_string(i) + "}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    auto count = [&]() {
+        auto it = ledger->scan_prefix(TESTSRC, COLLECTION, "key");
+        size_t result = 0;
+        std::string key;
+        ObjectEventHandle hdl;
+
+        while(it.next(key, hdl))
+        {
+            ++result;
+        }
+
+        return result;
+    };
+
+    EXPECT_TRUE(ledger->create_ordered_index(COLLECTION));
+
+    auto index = ledger->get_collection(COLLECTION).ordered_index();
+    ASSERT_NE(index, nullptr);
+    EXPECT_FALSE(index->is_ready());
+
+    // Scans must not use the incomplete index
+    EXPECT_EQ(count(), NUM_OBJECTS);
+
+    // Writes during the build are reflected
+    json::Document doc("{\"i\":-1}");
+    ledger->put(TESTSRC, COLLECTION, "key_new", doc);
+    ledger->remove(TESTSRC, COLLECTION, "key0");
+
+    while(!index->is_ready())
+    {
+        enclave.task_manager().run_background_task();
+    }
+
+    EXPECT_EQ(index->size(), NUM_OBJECTS);
+    EXPECT_EQ(count(), NUM_OBJECTS);
+}
+
+TEST(OrderedKeyIndexTest, disabled_when_full)
+{
+    OrderedKeyIndex index;
+    index.finish_build();
+
+    for(size_t i = 0; i < OrderedKeyIndex::MAX_KEYS; ++i)
+    {
+        ASSERT_TRUE(index.insert("key" + std::to_string(i)));
+    }
+
+    EXPECT_TRUE(index.is_ready());
+
+    // Existing keys don't count
+    EXPECT_TRUE(index.insert("key0"));
+
+    EXPECT_FALSE(index.insert("one_too_many"));
+    EXPECT_TRUE(index.is_full());
+    EXPECT_FALSE(index.is_ready());
+    EXPECT_EQ(index.size(), 0u);
+}
+
+TEST_F(LedgerTest, parallel_scan)
+{
+    for(int i = 0; i < 500; ++i)
+    {
+        json::Document doc("{\"i\":" + std::to_string(i) + ", \"even\":" + (i % 2 == 0 ? "true" : "false") + "}");
+        ledger->put(TESTSRC, COLLECTION, "obj" + std::to_string(i), doc);
+    }
+
+    std::vector<std::thread> workers;
+
+    for(int i = 0; i < 2; ++i)
+    {
+        workers.emplace_back([&]() { enclave.worker_pool().run_worker(); });
+    }
+
+    json::Document predicates("{\"even\":true}");
+
+    std::vector<std::string> expected;
+    std::string key;
+    ObjectEventHandle hdl;
+
+    auto it = ledger->find(TESTSRC, COLLECTION, predicates);
+
+    while(it.next(key, hdl))
+    {
+        expected.push_back(key);
+    }
+
+    auto keys_of = [](const std::vector<ScanResult> &objects) {
+        std::vector<std::string> result;
+
+        for(auto &obj : objects)
+        {
+            result.push_back(obj.key);
+        }
+
+        return result;
+    };
+
+    EXPECT_EQ(expected.size(), 250u);
+    EXPECT_EQ(keys_of(ledger->find_parallel(TESTSRC, COLLECTION, predicates)), expected);
+
+    auto limited = ledger->find_parallel(TESTSRC, COLLECTION, predicates, {"i"}, 10);
+    EXPECT_EQ(keys_of(limited), std::vector<std::string>(expected.begin(), expected.begin() + 10));
+    EXPECT_EQ(limited[0].value.get_size(), 1u);
+
+    EXPECT_EQ(ledger->count_parallel(TESTSRC, COLLECTION, predicates), 250u);
+    EXPECT_EQ(ledger->count_parallel(TESTSRC, COLLECTION, json::Document("{}")), 500u);
+
+    enclave.worker_pool().stop();
+
+    for(auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+TEST_F(LedgerTest, suspend_iterator)
+{
+    for(int i = 0; i < 100; ++i)
+    {
+        json::Document doc("{\"i\":" + std::to_string(i) + "}");
+        ledger->put(TESTSRC, COLLECTION, "obj" + std::to_string(i), doc);
+    }
+
+    std::set<std::string> keys;
+    std::string key;
+    ObjectEventHandle hdl;
+
+    auto it = ledger->find(TESTSRC, COLLECTION);
+
+    for(int i = 0; i < 10 && it.next(key, hdl); ++i)
+    {
+        keys.insert(key);
+    }
+
+    hdl.clear();
+    it.suspend();
+
+    // would block if the iterator still held any locks
+    json::Document doc("{\"i\":1000}");
+    ledger->put(TESTSRC, COLLECTION, "obj0", doc);
+
+    while(it.next(key, hdl))
+    {
+        EXPECT_EQ(keys.count(key), 0u);
+        keys.insert(key);
+    }
+
+    EXPECT_EQ(keys.size(), 100u);
+}
+
+TEST_F(LedgerTest, aggregate)
+{
+    const std::vector<std::string> cities = {"ithaca", "nyc", "ithaca", "boston", "nyc", "ithaca"};
+
+    for(size_t i = 0; i < cities.size(); ++i)
+    {
+        json::Document doc("{\"city\":\"" + cities[i] + "\", \"price\":" + std::to_string(i + 1) + "}");
+        ledger->put(TESTSRC, COLLECTION, "order" + std::to_string(i), doc);
+    }
+
+    json::Document no_price("{\"city\":\"nyc\"}");
+    ledger->put(TESTSRC, COLLECTION, "order_no_price", no_price);
+
+    json::Document aggregates("{\"num\":{\"$count\":\"\"}, \"priced\":{\"$count\":\"price\"}, \"total\":{\"$sum\":\"price\"},"
+                              "\"min\":{\"$min\":\"price\"}, \"max\":{\"$max\":\"price\"}, \"avg\":{\"$avg\":\"price\"}}");
+
+    Aggregation all(aggregates);
+    ledger->aggregate(TESTSRC, COLLECTION, json::Document(""), all);
+    EXPECT_EQ(all.result(), json::Document("{\"num\":7, \"priced\":6, \"total\":21, \"min\":1, \"max\":6, \"avg\":3.5}"));
+
+    Aggregation ithaca(aggregates);
+    ledger->aggregate(TESTSRC, COLLECTION, json::Document("{\"city\":\"ithaca\"}"), ithaca);
+    EXPECT_EQ(json::Document(ithaca.result(), "total").str(), "10");
+
+    Aggregation by_city(json::Document("{\"num\":{\"$count\":\"\"}, \"total\":{\"$sum\":\"price\"}}"), "city");
+    ledger->aggregate(TESTSRC, COLLECTION, json::Document(""), by_city);
+    EXPECT_EQ(by_city.result(), json::Document("[{\"group\":\"boston\",\"num\":1,\"total\":4},"
+                                                "{\"group\":\"ithaca\",\"num\":3,\"total\":10},"
+                                                "{\"group\":\"nyc\",\"num\":3,\"total\":7}]"));
+
+    // Answered from a covering index
+    EXPECT_TRUE(ledger->create_index(COLLECTION, "city_price", {"city"}, {"price"}));
+
+    while(!ledger->get_collection(COLLECTION).get_secondary_index("city_price")->is_ready())
+    {
+        enclave.task_manager().run_background_task();
+    }
+
+    EXPECT_TRUE(ledger->plan_query(COLLECTION, json::Document("{\"city\":\"ithaca\"}"), {"city", "price"}).covering);
+
+    Aggregation covered(aggregates);
+    ledger->aggregate(TESTSRC, COLLECTION, json::Document("{\"city\":\"ithaca\"}"), covered);
+    EXPECT_EQ(covered.result(), ithaca.result());
+
+    EXPECT_THROW(Aggregation(json::Document("{\"x\":{\"$median\":\"price\"}}")), std::runtime_error);
+}
+
+TEST_F(LedgerTest, find_sorted)
+{
+    const std::vector<int> prices = {5, 3, 9, 1, 7, 3};
+
+    for(size_t i = 0; i < prices.size(); ++i)
+    {
+        json::Document doc("{\"price\":" + std::to_string(prices[i]) + ", \"pos\":" + std::to_string(i) + "}");
+        ledger->put(TESTSRC, COLLECTION, "item" + std::to_string(i), doc);
+    }
+
+    json::Document no_price("{\"pos\":6}");
+    ledger->put(TESTSRC, COLLECTION, "item6", no_price);
+
+    auto keys = [](const std::vector<ScanResult> &objects) {
+        std::vector<std::string> result;
+
+        for(auto &obj : objects)
+        {
+            result.push_back(obj.key);
+        }
+
+        return result;
+    };
+
+    // Objects without the path come first, ties are broken by key
+    auto all = ledger->find_sorted(TESTSRC, COLLECTION, json::Document(""), {}, "price");
+    EXPECT_EQ(keys(all), std::vector<std::string>({"item6", "item3", "item1", "item5", "item0", "item4", "item2"}));
+
+    auto top = ledger->find_sorted(TESTSRC, COLLECTION, json::Document(""), {"price"}, "-price", 2);
+    EXPECT_EQ(keys(top), std::vector<std::string>({"item2", "item4"}));
+    EXPECT_EQ(top[0].value, json::Document("{\"price\":9}"));
+
+    auto filtered = ledger->find_sorted(TESTSRC, COLLECTION, json::Document("{\"price\":3}"), {}, "-$key");
+    EXPECT_EQ(keys(filtered), std::vector<std::string>({"item5", "item1"}));
+
+    // Ordered index returns keys in order without sorting
+    EXPECT_TRUE(ledger->create_ordered_index(COLLECTION));
+    auto first = ledger->find_sorted(TESTSRC, COLLECTION, json::Document(""), {}, "$key", 3);
+    EXPECT_EQ(keys(first), std::vector<std::string>({"item0", "item1", "item2"}));
+
+    EXPECT_THROW(ledger->find_sorted(TESTSRC, COLLECTION, json::Document(""), {}, "-"), std::runtime_error);
+}
+
+TEST_F(LedgerTest, put_many)
+{
+    const size_t NUM_OBJECTS = 500;
+
+    std::vector<std::pair<std::string, json::Document>> objects;
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        objects.emplace_back("obj" + std::to_string(i), json::Document("{\"i\":" + std::to_string(i) + "}"));
+    }
+
+    objects.emplace_back("invalid.key", json::Document("{\"i\":-1}"));
+
+    auto eids = ledger->put_many(TESTSRC, COLLECTION, objects);
+    ASSERT_EQ(eids.size(), NUM_OBJECTS + 1);
+    EXPECT_EQ(eids.back(), INVALID_EVENT);
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        ASSERT_NE(eids[i], INVALID_EVENT);
+
+        auto it = ledger->iterate(TESTSRC, COLLECTION, "obj" + std::to_string(i));
+        auto [eid, value] = it.next();
+
+        EXPECT_EQ(eid, eids[i]);
+        EXPECT_EQ(value, objects[i].second);
+    }
+
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION), NUM_OBJECTS);
+
+    // Updates create new versions
+    std::vector<std::pair<std::string, json::Document>> updates;
+    updates.emplace_back("obj0", json::Document("{\"i\":1000}"));
+
+    auto update_eids = ledger->put_many(TESTSRC, COLLECTION, updates);
+    ASSERT_EQ(update_eids.size(), 1u);
+
+    auto it = ledger->iterate(TESTSRC, COLLECTION, "obj0");
+    auto [eid, value] = it.next();
+    EXPECT_EQ(eid, update_eids[0]);
+    EXPECT_EQ(value, json::Document("{\"i\":1000}"));
+}
+
+TEST_F(LedgerTest, put_many_repeated_key)
+{
+    std::vector<std::pair<std::string, json::Document>> objects;
+    objects.emplace_back("foo", json::Document("{\"i\":1}"));
+    objects.emplace_back("bar", json::Document("{\"i\":2}"));
+    objects.emplace_back("foo", json::Document("{\"i\":3}"));
+
+    auto eids = ledger->put_many(TESTSRC, COLLECTION, objects);
+    ASSERT_EQ(eids.size(), 3u);
+
+    for(auto &eid : eids)
+    {
+        EXPECT_NE(eid, INVALID_EVENT);
+    }
+
+    // Both writes to foo happened, in order
+    auto it = ledger->iterate(TESTSRC, COLLECTION, "foo");
+
+    auto [eid1, value1] = it.next();
+    EXPECT_EQ(eid1, eids[2]);
+    EXPECT_EQ(value1, json::Document("{\"i\":3}"));
+
+    auto [eid2, value2] = it.next();
+    EXPECT_EQ(eid2, eids[0]);
+    EXPECT_EQ(value2, json::Document("{\"i\":1}"));
+
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION), 2u);
+
+    // All key locks are gone again
+    EXPECT_EQ(enclave.transaction_manager().key_locks().num_locked_keys(), 0u);
+}
+
+TEST_F(LedgerTest, bulk_load)
+{
+    const size_t NUM_OBJECTS = 2000;
+
+    ledger->create_index(COLLECTION, "xyz", {"a"});
+
+    std::vector<std::pair<std::string, json::Document>> objects;
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        objects.emplace_back("key" + std::to_string(i), json::Document("{\"a\":" + std::to_string(i % 10) + "}"));
+    }
+
+    auto eids = ledger->bulk_load(TESTSRC, COLLECTION, objects);
+    ASSERT_EQ(eids.size(), NUM_OBJECTS);
+
+    for(size_t i = 0; i < NUM_OBJECTS; ++i)
+    {
+        auto it = ledger->iterate(TESTSRC, COLLECTION, objects[i].first);
+        auto [eid, value] = it.next();
+
+        EXPECT_EQ(eid, eids[i]);
+        EXPECT_EQ(value, objects[i].second);
+    }
+
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION), NUM_OBJECTS);
+
+    auto index = ledger->get_collection(COLLECTION).get_secondary_index("xyz");
+    ASSERT_NE(index, nullptr);
+
+    while(!index->is_ready())
+    {
+        enclave.task_manager().run_background_task();
+    }
+
+    EXPECT_EQ(index->estimate_value_count(json::Document("{\"a\":1}")), NUM_OBJECTS / 10);
+
+    // Objects are regular versions and can be updated as usual
+    json::Document update("{\"a\":42}");
+    ledger->put(TESTSRC, COLLECTION, objects[0].first, update);
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, json::Document("{\"a\":42}")), 1u);
+
+    // Later batches can be appended and keep the (now ready) index up to date
+    std::vector<std::pair<std::string, json::Document>> more;
+    more.emplace_back("zzz", json::Document("{\"a\":1}"));
+    more.emplace_back("aaa", json::Document("{\"a\":1}"));
+
+    auto more_eids = ledger->bulk_load(TESTSRC, COLLECTION, more);
+    ASSERT_EQ(more_eids.size(), 2u);
+    EXPECT_TRUE(index->is_ready());
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION), NUM_OBJECTS + 2);
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, json::Document("{\"a\":1}")), NUM_OBJECTS / 10 + 2);
+
+    // Existing keys are rejected without writing anything
+    std::vector<std::pair<std::string, json::Document>> existing;
+    existing.emplace_back("new_key", json::Document("{\"a\":1}"));
+    existing.emplace_back("zzz", json::Document("{\"a\":2}"));
+    EXPECT_THROW(ledger->bulk_load(TESTSRC, COLLECTION, existing), std::runtime_error);
+    EXPECT_FALSE(ledger->has_object(COLLECTION, "new_key"));
+
+    // So are duplicates
+    const std::string OTHER = "other";
+    std::vector<std::pair<std::string, json::Document>> duplicates;
+    duplicates.emplace_back("b", json::Document("{\"a\":1}"));
+    duplicates.emplace_back("b", json::Document("{\"a\":2}"));
+    EXPECT_THROW(ledger->bulk_load(TESTSRC, OTHER, duplicates), std::runtime_error);
+    EXPECT_FALSE(ledger->has_object(OTHER, "b"));
+}
+
+TEST_F(LedgerTest, snapshot_reads)
+{
+    json::Document v1("{\"a\":1}");
+    json::Document v2("{\"a\":2}");
+
+    ledger->put(TESTSRC, COLLECTION, "foo", v1);
+    ledger->put(TESTSRC, COLLECTION, "bar", v1);
+
+    auto snapshot = ledger->get_snapshot();
+
+    ledger->put(TESTSRC, COLLECTION, "foo", v2);
+    ledger->remove(TESTSRC, COLLECTION, "bar");
+    ledger->put(TESTSRC, COLLECTION, "xyz", v2);
+
+    auto res = ledger->get_many(TESTSRC, COLLECTION, {"foo", "bar", "xyz"}, "", nullptr, &snapshot);
+    ASSERT_EQ(res.size(), 3u);
+
+    EXPECT_TRUE(res[0].eid.is_valid());
+    EXPECT_EQ(res[0].value, v1);
+    EXPECT_TRUE(res[1].eid.is_valid());
+    EXPECT_EQ(res[1].value, v1);
+    EXPECT_FALSE(res[2].eid.is_valid());
+
+    // A new snapshot sees all changes
+    auto latest = ledger->get_snapshot();
+    res = ledger->get_many(TESTSRC, COLLECTION, {"foo", "bar", "xyz"}, "", nullptr, &latest);
+
+    EXPECT_EQ(res[0].value, v2);
+    EXPECT_FALSE(res[1].eid.is_valid());
+    EXPECT_EQ(res[2].value, v2);
+}
+
+TEST_F(LedgerTest, find_join)
+{
+    const std::string CUSTOMERS = "customers";
+
+    const std::vector<std::pair<std::string, std::string>> customers = {
+        {"alice", "{\"name\":\"Alice\", \"city\":\"ithaca\"}"},
+        {"bob", "{\"name\":\"Bob\", \"city\":\"nyc\"}"}};
+
+    const std::vector<std::pair<std::string, std::string>> orders = {
+        {"order1", "{\"customer\":\"alice\", \"city\":\"ithaca\", \"price\":1}"},
+        {"order2", "{\"customer\":\"bob\", \"city\":\"nyc\", \"price\":2}"},
+        {"order3", "{\"customer\":\"alice\", \"city\":\"ithaca\", \"price\":3}"},
+        {"order4", "{\"customer\":\"carol\", \"city\":\"boston\", \"price\":4}"}};
+
+    for(auto &[key, value] : customers)
+    {
+        json::Document doc(value);
+        ledger->put(TESTSRC, CUSTOMERS, key, doc);
+    }
+
+    for(auto &[key, value] : orders)
+    {
+        json::Document doc(value);
+        ledger->put(TESTSRC, COLLECTION, key, doc);
+    }
+
+    auto objects = ledger->get_many(TESTSRC, CUSTOMERS, {"bob", "carol", "alice"}, "name");
+    ASSERT_EQ(objects.size(), 3u);
+    EXPECT_EQ(objects[0].value, json::Document("\"Bob\""));
+    EXPECT_EQ(objects[1].eid, INVALID_EVENT);
+    EXPECT_EQ(objects[2].value, json::Document("\"Alice\""));
+
+    // By key
+    LookupJoin by_key{"customer", CUSTOMERS, "", "buyer"};
+    auto result = ledger->find_join(TESTSRC, COLLECTION, json::Document("{\"price\":{\"$in\":[3,4]}}"), {"price"}, -1, by_key);
+    ASSERT_EQ(result.size(), 2u);
+
+    for(auto &obj : result)
+    {
+        if(obj.key == "order3")
+        {
+            EXPECT_EQ(obj.value, json::Document("{\"price\":3, \"buyer\":[{\"name\":\"Alice\", \"city\":\"ithaca\"}]}"));
+        }
+        else
+        {
+            EXPECT_EQ(obj.key, "order4");
+            EXPECT_EQ(obj.value, json::Document("{\"price\":4, \"buyer\":[]}"));
+        }
+    }
+
+    // By a field of the foreign objects
+    LookupJoin by_city{"city", COLLECTION, "city", "orders"};
+    auto alice = ledger->find_join(TESTSRC, CUSTOMERS, json::Document("{\"name\":\"Alice\"}"), {"name"}, -1, by_city);
+    ASSERT_EQ(alice.size(), 1u);
+    EXPECT_EQ(json::Document(alice[0].value, "orders").get_size(), 2u);
+
+    // Several distinct references are resolved together
+    auto everyone = ledger->find_join(TESTSRC, CUSTOMERS, json::Document(""), {"name"}, -1, by_city);
+    ASSERT_EQ(everyone.size(), 2u);
+
+    for(auto &obj : everyone)
+    {
+        const size_t expected = (obj.key == "alice") ? 2 : 1;
+        EXPECT_EQ(json::Document(obj.value, "orders").get_size(), expected);
+    }
+
+    EXPECT_THROW(ledger->find_join(TESTSRC, COLLECTION, json::Document(""), {}, -1, LookupJoin{"", CUSTOMERS, "", "x"}), std::runtime_error);
+}
+
 TEST_F(LedgerTest, block_reference_counting)
 {
     json::Document doc("{\"a\":42, \"b\":23}");
@@ -78,6 +78,21 @@ TEST_F(MultiMapTest, iterate_one)
     EXPECT_TRUE(it == map.end());
 }
 
+TEST_F(MultiMapTest, insert_duplicate)
+{
+    MultiMap map(*buffer, "foo");
+    const int value = 42;
+    const std::string key = "foobar";
+
+    EXPECT_TRUE(map.insert(value, key));
+    EXPECT_FALSE(map.insert(value, key));
+    EXPECT_EQ(map.size(), static_cast<size_t>(1));
+
+    // Without the check the caller has to make sure entries are unique
+    EXPECT_TRUE(map.insert(value, "other", false));
+    EXPECT_EQ(map.size(), static_cast<size_t>(2));
+}
+
 TEST_F(MultiMapTest, clear)
 {
     MultiMap map(*buffer, "foo");
@@ -272,6 +272,41 @@ TEST_F(ProgramsTest, security_policy)
     EXPECT_EQ(value, expected);
 }
 
+TEST_F(ProgramsTest, count_respects_security_policy)
+{
+    for(size_t i = 0; i < 10; ++i)
+    {
+        json::Document doc("{\"a\":1}");
+        ledger->put(TESTSRC, COLLECTION, "key" + std::to_string(i), doc);
+    }
+
+    ledger->create_index(COLLECTION, "index_a", {"a"});
+
+    json::Document predicates("{\"a\":1}");
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, predicates), 10u);
+
+    const std::string code = "from op_info import type\n"
+                       "return type != 'get'";
+
+    bitstream data = cow::compile_string(code);
+
+    json::Writer writer;
+    writer.start_map("");
+    writer.write_integer("a", 1);
+    writer.write_binary("policy", data);
+    writer.end_map();
+
+    auto doc = writer.make_document();
+    ledger->put(TESTSRC, COLLECTION, "hidden", doc);
+
+    // The index contains the hidden object, so it must not be used for counting
+    EXPECT_EQ(ledger->count_objects(TESTSRC, COLLECTION, predicates), 10u);
+    EXPECT_EQ(ledger->get_collection(COLLECTION).num_objects_with_policy(), 1u);
+
+    ledger->remove(TESTSRC, COLLECTION, "hidden");
+    EXPECT_EQ(ledger->get_collection(COLLECTION).num_objects_with_policy(), 0u);
+}
+
 TEST_F(ProgramsTest, run_buggy_security_policy)
 {
     const Identity _jondoe = {IdentityType::Client, "jondoe", INVALID_PUBLIC_KEY};
@@ -467,6 +502,40 @@ TEST_F(ProgramsTest, run_program_with_get)
     EXPECT_FALSE(cow::unpack_bool(runner2->get_result()));
 }
 
+TEST_F(ProgramsTest, run_program_with_get_many)
+{
+    const std::string program_name = "foo";
+    const std::string code = "import db\n"
+                       "tx = db.init_transaction()\n"
+                       "c = tx.get_collection('test')\n"
+                       "sum = 0\n"
+                       "for k,v in c.get_many(['x', 'missing', 'y']):\n"
+                       "   sum += v\n"
+                       "res, _ = tx.commit()\n"
+                       "if not res:\n"
+                       "   return False\n"
+                       "return sum == 6";
+
+    bitstream data = cow::compile_string(code);
+    json::Binary bin(data);
+
+    json::Integer x(5), y(1);
+
+    ledger->put(TESTSRC, COLLECTION, "x", x);
+    ledger->put(TESTSRC, COLLECTION, "y", y);
+
+    std::vector<std::string> args = {};
+
+    auto runner = std::make_shared<ProgramRunner>(enclave, bin.as_bitstream(), COLLECTION, program_name, args);
+
+    task_manager->register_task(runner);
+
+    runner->run();
+
+    EXPECT_FALSE(runner->has_errors());
+    EXPECT_TRUE(cow::unpack_bool(runner->get_result()));
+}
+
 TEST_F(ProgramsTest, run_buggy_program)
 {
     // Make sure the execption isn't propagated
@@ -548,6 +617,38 @@ TEST_F(ProgramsTest, run_program_with_find)
     EXPECT_TRUE(runner->get_result());
 }
 
+TEST_F(ProgramsTest, run_program_with_sorted_find)
+{
+    const std::string program_name = "foo";
+    const std::string code = "import db\n"
+                       "c = db.get_collection('test')\n"
+                       "keys = ''\n"
+                       "sum = 0\n"
+                       "for k,v in c.find({}, ['val'], 2, '-val'):\n"
+                       "    keys += k\n"
+                       "    sum += v['val']\n"
+                       "if sum != 9:\n"
+                       "    return False\n"
+                       "return keys == 'foo3foo2'";
+
+    bitstream data = cow::compile_string(code);
+    json::Binary binary(data);
+
+    ledger->put(TESTSRC, COLLECTION, "foo1", json::Document("{\"val\":3,\"other\":1}"));
+    ledger->put(TESTSRC, COLLECTION, "foo2", json::Document("{\"val\":4,\"other\":2}"));
+    ledger->put(TESTSRC, COLLECTION, "foo3", json::Document("{\"val\":5,\"other\":3}"));
+
+    std::vector<std::string> args = {};
+
+    auto runner = std::make_shared<ProgramRunner>(enclave, binary.as_bitstream(), COLLECTION, program_name, args);
+
+    task_manager->register_task(runner);
+
+    runner->run();
+
+    EXPECT_TRUE(runner->get_result());
+}
+
 TEST_F(ProgramsTest, run_program_with_put)
 {
     const std::string program_name = "xyzbla";
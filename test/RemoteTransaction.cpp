@@ -49,7 +49,7 @@ TEST_F(RemoteTransactionTest, failed_validation)
     auto key = "foobar";
     auto res = true;
 
-    auto op = new has_obj_info_t(*tx, collection, key, res, 1);
+    auto op = tx->new_operation<has_obj_info_t>(collection, key, res, 1);
     tx->register_operation(op);
 
     auto success = tx->prepare(false);
@@ -66,7 +66,7 @@ TEST_F(RemoteTransactionTest, abort)
     auto key = "foobar";
     auto res = false;
 
-    auto op = new has_obj_info_t(*tx, collection, key, res, 1);
+    auto op = tx->new_operation<has_obj_info_t>(collection, key, res, 1);
     tx->register_operation(op);
 
     auto success = tx->prepare(false);
@@ -88,7 +88,7 @@ TEST_F(RemoteTransactionTest, commit)
     auto key = "foobar";
     auto res = false;
 
-    auto op = new has_obj_info_t(*tx, collection, key, res, 1);
+    auto op = tx->new_operation<has_obj_info_t>(collection, key, res, 1);
     tx->register_operation(op);
 
     auto success = tx->prepare(false);
@@ -71,6 +71,31 @@ TEST_F(TransactionTest, read_only_tx)
     conn->close();
 }
 
+TEST_F(TransactionTest, snapshot_tx)
+{
+    auto conn = create_client("test", "testserver", "localhost");
+    auto c = conn->get_collection("default");
+    c->put("food", json::String("apple"));
+
+    auto t = conn->init_transaction(IsolationLevel::Snapshot);
+    auto tc = t->get_collection("default");
+
+    // Changes made after the transaction began are not visible
+    c->put("food", json::String("banana"));
+    c->put("drink", json::String("water"));
+
+    EXPECT_EQ(tc->get("food"), json::String("apple"));
+    EXPECT_FALSE(tc->has_object("drink"));
+    EXPECT_THROW(tc->put("food", json::String("cherry")), std::runtime_error);
+
+    auto res = t->commit(false);
+    EXPECT_TRUE(res.success);
+
+    EXPECT_EQ(c->get("food"), json::String("banana"));
+
+    conn->close();
+}
+
 TEST_F(TransactionTest, update_value)
 {
     auto conn = create_client("test", "testserver", "localhost");
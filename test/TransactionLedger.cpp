@@ -1,5 +1,6 @@
 #include "../src/enclave/Ledger.h"
 
+#include <thread>
 #include <gtest/gtest.h>
 
 #include "credb/defines.h"
@@ -94,3 +95,41 @@ TEST_F(TransactionLedgerTest, set_remote_ops)
 
     EXPECT_EQ(remote_ops, hdl.remote_ops());
 }
+
+TEST_F(TransactionLedgerTest, concurrent_inserts)
+{
+    const size_t NUM_THREADS = 4;
+    const size_t NUM_INSERTS = 500;
+
+    std::vector<std::vector<ledger_pos_t>> positions(NUM_THREADS);
+    std::vector<std::thread> threads;
+
+    for(size_t t = 0; t < NUM_THREADS; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for(size_t i = 0; i < NUM_INSERTS; ++i)
+            {
+                std::map<taskid_t, OpContext> op_contexts;
+                op_contexts.emplace(1, TESTSRC.duplicate());
+
+                transaction_id_t tx_id = t * NUM_INSERTS + i;
+                positions[t].push_back(ledger->insert(op_contexts, idty->get_unique_id(), tx_id, op_set_t(), {}));
+            }
+        });
+    }
+
+    for(auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // Every committer gets back the position of its own record
+    for(size_t t = 0; t < NUM_THREADS; ++t)
+    {
+        for(size_t i = 0; i < NUM_INSERTS; ++i)
+        {
+            auto hdl = ledger->get(positions[t][i]);
+            EXPECT_EQ(hdl.transaction_id(), t * NUM_INSERTS + i);
+        }
+    }
+}
@@ -1,10 +1,12 @@
 #include "../src/enclave/Ledger.h"
 
 #include <gtest/gtest.h>
+#include <thread>
 
 #include "credb/defines.h"
 
 #include "../src/enclave/TransactionManager.h"
+#include "../src/enclave/op_info.h"
 #include "../src/enclave/Enclave.h"
 #include "../src/server/Disk.h"
 
@@ -53,3 +55,141 @@ TEST_F(TransactionManagerTest, abort)
     EXPECT_EQ(tx_mgr->num_pending_transactions(), size_t(0));
 }
 
+
+TEST_F(TransactionManagerTest, concurrent_transactions)
+{
+    const size_t NUM_THREADS = 8;
+    const size_t NUM_TRANSACTIONS = 100;
+
+    std::vector<std::thread> threads;
+
+    for(size_t i = 0; i < NUM_THREADS; ++i)
+    {
+        threads.emplace_back([this, NUM_TRANSACTIONS]() {
+            for(size_t j = 0; j < NUM_TRANSACTIONS; ++j)
+            {
+                auto tx = tx_mgr->init_local_transaction(IsolationLevel::Serializable);
+                EXPECT_EQ(tx_mgr->get(tx->get_root(), tx->identifier()), tx);
+                tx->abort();
+            }
+        });
+    }
+
+    for(auto &t : threads)
+    {
+        t.join();
+    }
+
+    EXPECT_EQ(tx_mgr->num_pending_transactions(), size_t(0));
+}
+
+TEST_F(TransactionManagerTest, disjoint_keys_same_shard)
+{
+    auto &ledger = enclave.ledger();
+    const taskid_t task = 1;
+
+    const std::string key1 = "foo";
+    std::string key2;
+
+    // find a different key that lives in the same shard
+    for(int i = 0; key2.empty(); ++i)
+    {
+        auto candidate = "bar" + std::to_string(i);
+
+        if(ledger.get_shard(COLLECTION, candidate) == ledger.get_shard(COLLECTION, key1))
+        {
+            key2 = candidate;
+        }
+    }
+
+    auto tx1 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx1->init_task(task, TESTSRC);
+    tx1->register_operation(tx1->new_operation<put_info_t>(COLLECTION, key1, json::Integer(1), task));
+
+    auto tx2 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx2->init_task(task, TESTSRC);
+    tx2->register_operation(tx2->new_operation<put_info_t>(COLLECTION, key2, json::Integer(2), task));
+
+    EXPECT_TRUE(tx1->prepare(false));
+    EXPECT_TRUE(tx2->prepare(false));
+
+    tx1->commit(false);
+    tx2->commit(false);
+
+    EXPECT_EQ(tx_mgr->key_locks().num_locked_keys(), size_t(0));
+
+    event_id_t eid;
+    LockHandle lock_handle(ledger);
+
+    auto hdl1 = ledger.get_latest_version(TESTSRC, COLLECTION, key1, "", eid, lock_handle, LockType::Read);
+    ASSERT_TRUE(hdl1.valid());
+    EXPECT_EQ(hdl1.value(), json::Integer(1));
+
+    auto hdl2 = ledger.get_latest_version(TESTSRC, COLLECTION, key2, "", eid, lock_handle, LockType::Read);
+    ASSERT_TRUE(hdl2.valid());
+    EXPECT_EQ(hdl2.value(), json::Integer(2));
+}
+
+TEST_F(TransactionManagerTest, same_key_conflicts)
+{
+    const taskid_t task = 1;
+
+    auto tx1 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx1->init_task(task, TESTSRC);
+    tx1->register_operation(tx1->new_operation<put_info_t>(COLLECTION, "foo", json::Integer(1), task));
+
+    auto tx2 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx2->init_task(task, TESTSRC);
+    tx2->register_operation(tx2->new_operation<put_info_t>(COLLECTION, "foo", json::Integer(2), task));
+
+    EXPECT_TRUE(tx1->prepare(false));
+    EXPECT_FALSE(tx2->prepare(false));
+    EXPECT_EQ(tx2->error(), "Lock contention");
+
+    tx1->commit(false);
+
+    EXPECT_EQ(tx_mgr->key_locks().num_locked_keys(), size_t(0));
+    EXPECT_EQ(tx_mgr->commit_tracker().num_pending(), size_t(0));
+
+    // The key is free again
+    auto tx3 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx3->init_task(task, TESTSRC);
+    tx3->register_operation(tx3->new_operation<put_info_t>(COLLECTION, "foo", json::Integer(3), task));
+
+    EXPECT_TRUE(tx3->prepare(false));
+    tx3->commit(false);
+
+    EXPECT_EQ(tx_mgr->commit_tracker().num_pending(), size_t(0));
+}
+
+TEST_F(TransactionManagerTest, pessimistic_lock_before_read)
+{
+    const taskid_t task = 1;
+
+    // Optimistic transactions only lock during prepare
+    auto tx1 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx1->init_task(task, TESTSRC);
+    tx1->lock_before_read(COLLECTION, "foo");
+
+    EXPECT_EQ(tx_mgr->key_locks().num_locked_keys(), size_t(0));
+    tx1->abort();
+
+    auto tx2 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx2->init_task(task, TESTSRC);
+    tx2->set_pessimistic(true);
+    tx2->lock_before_read(COLLECTION, "foo.bar");
+
+    // The lock is held before anything was read or registered
+    EXPECT_EQ(tx_mgr->key_locks().num_locked_keys(), size_t(1));
+
+    auto tx3 = tx_mgr->init_local_transaction(IsolationLevel::RepeatableRead);
+    tx3->init_task(task, TESTSRC);
+    tx3->register_operation(tx3->new_operation<put_info_t>(COLLECTION, "foo", json::Integer(1), task));
+
+    EXPECT_FALSE(tx3->prepare(false));
+    EXPECT_EQ(tx3->error(), "Lock contention");
+
+    tx2->abort();
+
+    EXPECT_EQ(tx_mgr->key_locks().num_locked_keys(), size_t(0));
+}
@@ -6,6 +6,7 @@
 #include "../src/enclave/Index.h"
 #include "../src/server/Disk.h"
 #include "../src/enclave/version_number.h"
+#include "../src/enclave/predicates.h"
 
 #include "credb/base64.h"
 
@@ -66,4 +67,31 @@ TEST(PrimitivesTest, version_number)
     EXPECT_FALSE(version_number(5) < version_number(4));
 }
 
+TEST(PrimitivesTest, compiled_predicates)
+{
+    using trusted::CompiledPredicates;
+
+    json::Document doc("{\"a\":1, \"b\":\"foo\", \"c\":2.5, \"tags\":[\"x\",\"y\"], \"nested\":{\"d\":3}}");
+
+    EXPECT_TRUE(CompiledPredicates(json::Document("")).empty());
+    EXPECT_TRUE(CompiledPredicates(json::Document("")).matches(doc));
+
+    CompiledPredicates equal(json::Document("{\"a\":1, \"b\":\"foo\", \"nested.d\":3}"));
+    EXPECT_TRUE(equal.matches(doc));
+
+    EXPECT_FALSE(CompiledPredicates(json::Document("{\"a\":2}")).matches(doc));
+    EXPECT_FALSE(CompiledPredicates(json::Document("{\"b\":\"bar\"}")).matches(doc));
+    EXPECT_FALSE(CompiledPredicates(json::Document("{\"missing\":1}")).matches(doc));
+    EXPECT_TRUE(CompiledPredicates(json::Document("{\"c\":2.5}")).matches(doc));
+
+    EXPECT_TRUE(CompiledPredicates(json::Document("{\"tags\":{\"$contains\":\"y\"}, \"a\":1}")).matches(doc));
+    EXPECT_FALSE(CompiledPredicates(json::Document("{\"tags\":{\"$contains\":\"z\"}}")).matches(doc));
+
+    // Operators are evaluated like before
+    CompiledPredicates in(json::Document("{\"a\":{\"$in\":[1,2]}, \"b\":\"foo\"}"));
+    EXPECT_FALSE(in.empty());
+    EXPECT_TRUE(in.matches(doc));
+    EXPECT_EQ(in.matches(doc), doc.matches_predicates(json::Document("{\"a\":{\"$in\":[1,2]}, \"b\":\"foo\"}")));
+}
+
 }